@@ -148,6 +148,9 @@ bool auto_shield = 1; /* shield drops for fire */
 
 int maxFPS; /* Client's own FPS */
 int oldMaxFPS;
+int jitterBuffer; /* Frames held back to smooth out arrival */
+int displayFPS;   /* Interpolated redraws per second, 0 for none */
+bool predictSelf; /* Draw our ship where our keys will take it */
 double clientFPS = 1.0; /* FPS client is drawing at */
 // double timePerFrame = 0.0; /* Time a frame is shown, unit seconds */
 int clientLag = 0;
@@ -1683,10 +1686,168 @@ static void update_timing(void)
     }
 }
 
+/*
+ * With a jitter buffer the frames come at a steady rate and can be
+ * redrawn in between with the ships and our view moved part of the
+ * way from where they were in the previous frame.  This draws ships
+ * one frame behind the rest, which is not noticed, where ships
+ * jumping once a frame is.
+ */
+typedef struct
+{
+    short id;
+    ipos_t pos;   /* in this frame */
+    ipos_t delta; /* since the previous one */
+} interp_ship_t;
+
+static interp_ship_t *interp_ship_ptr, *interp_prev_ptr;
+static int num_interp_ship, max_interp_ship;
+static int num_interp_prev, max_interp_prev;
+static ipos_t interp_self, interp_self_delta;
+
+static void Set_world(void)
+{
+    world.x = selfPos.x - (ext_view_width / 2);
+    world.y = selfPos.y - (ext_view_height / 2);
+    realWorld = world;
+    if (BIT(Setup->mode, WRAP_PLAY))
+    {
+        if (world.x < 0 && world.x + ext_view_width < Setup->width)
+            world.x += Setup->width;
+        else if (world.x > 0 && world.x + ext_view_width >= Setup->width)
+            realWorld.x -= Setup->width;
+        if (world.y < 0 && world.y + ext_view_height < Setup->height)
+            world.y += Setup->height;
+        else if (world.y > 0 && world.y + ext_view_height >= Setup->height)
+            realWorld.y -= Setup->height;
+    }
+}
+
+/*
+ * Distance moved along one axis, taking wrapping into account.
+ * Jumps of more than half the view are warps or new lives
+ * and are not interpolated.
+ */
+static int Interp_delta(int from, int to, int size, int view)
+{
+    int d = to - from;
+
+    if (BIT(Setup->mode, WRAP_PLAY))
+    {
+        if (d > size / 2)
+            d -= size;
+        else if (d < -size / 2)
+            d += size;
+    }
+    if (ABS(d) > view / 2)
+        d = 0;
+    return d;
+}
+
+static int Interp_pos(int pos, int delta, double back, int size)
+{
+    pos -= (int)(delta * back + 0.5);
+    if (BIT(Setup->mode, WRAP_PLAY))
+    {
+        if (pos < 0)
+            pos += size;
+        else if (pos >= size)
+            pos -= size;
+    }
+    return pos;
+}
+
+static void Interpolate_start(void)
+{
+    int i, j;
+    interp_ship_t t;
+
+    num_interp_prev = 0;
+    EXPAND(interp_prev_ptr, num_interp_prev, max_interp_prev,
+           interp_ship_t, num_interp_ship);
+    if (num_interp_ship > 0)
+        memcpy(interp_prev_ptr, interp_ship_ptr,
+               num_interp_ship * sizeof(interp_ship_t));
+    num_interp_prev = num_interp_ship;
+
+    num_interp_ship = 0;
+    for (i = 0; i < num_ship; i++)
+    {
+        t.id = ship_ptr[i].id;
+        t.pos.x = ship_ptr[i].x;
+        t.pos.y = ship_ptr[i].y;
+        t.delta.x = t.delta.y = 0;
+        for (j = 0; j < num_interp_prev; j++)
+        {
+            if (interp_prev_ptr[j].id == t.id)
+            {
+                t.delta.x = Interp_delta(interp_prev_ptr[j].pos.x, t.pos.x,
+                                         Setup->width, ext_view_width);
+                t.delta.y = Interp_delta(interp_prev_ptr[j].pos.y, t.pos.y,
+                                         Setup->height, ext_view_height);
+                break;
+            }
+        }
+        STORE(interp_ship_t, interp_ship_ptr, num_interp_ship, max_interp_ship, t);
+    }
+
+    interp_self_delta.x = Interp_delta(interp_self.x, selfPos.x,
+                                       Setup->width, ext_view_width);
+    interp_self_delta.y = Interp_delta(interp_self.y, selfPos.y,
+                                       Setup->height, ext_view_height);
+    interp_self = selfPos;
+}
+
+/*
+ * Draw the current frame as it looks a fraction of a frame
+ * after the previous one.
+ */
+void Client_interpolate(double alpha)
+{
+    int i;
+    double back;
+
+    LIMIT(alpha, 0.0, 1.0);
+    back = 1.0 - alpha;
+    for (i = 0; i < num_ship && i < num_interp_ship; i++)
+    {
+        ship_ptr[i].x = Interp_pos(interp_ship_ptr[i].pos.x,
+                                   interp_ship_ptr[i].delta.x, back,
+                                   Setup->width);
+        ship_ptr[i].y = Interp_pos(interp_ship_ptr[i].pos.y,
+                                   interp_ship_ptr[i].delta.y, back,
+                                   Setup->height);
+    }
+    selfPos.x = Interp_pos(interp_self.x, interp_self_delta.x, back,
+                           Setup->width);
+    selfPos.y = Interp_pos(interp_self.y, interp_self_delta.y, back,
+                           Setup->height);
+    Set_world();
+
+    update_timing();
+    Paint_frame();
+
+    for (i = 0; i < num_ship && i < num_interp_ship; i++)
+    {
+        ship_ptr[i].x = interp_ship_ptr[i].pos.x;
+        ship_ptr[i].y = interp_ship_ptr[i].pos.y;
+    }
+    selfPos = interp_self;
+    Set_world();
+}
+
 int Handle_end(long server_loops)
 {
     end_loops = server_loops;
     snooping = self && (eyesId != self->id);
+    if (Predict_frame(server_loops))
+        Set_world();
+    if (Net_interpolating())
+    {
+        Interpolate_start();
+        Client_interpolate(0.0);
+        return 0;
+    }
     update_timing();
     Paint_frame();
     return 0;
@@ -1730,20 +1891,7 @@ int Handle_self(int x, int y, int vx, int vy, int newHeading,
     else
         packet_size = newPacketSize;
 
-    world.x = selfPos.x - (ext_view_width / 2);
-    world.y = selfPos.y - (ext_view_height / 2);
-    realWorld = world;
-    if (BIT(Setup->mode, WRAP_PLAY))
-    {
-        if (world.x < 0 && world.x + ext_view_width < Setup->width)
-            world.x += Setup->width;
-        else if (world.x > 0 && world.x + ext_view_width >= Setup->width)
-            realWorld.x -= Setup->width;
-        if (world.y < 0 && world.y + ext_view_height < Setup->height)
-            world.y += Setup->height;
-        else if (world.y > 0 && world.y + ext_view_height >= Setup->height)
-            realWorld.y -= Setup->height;
-    }
+    Set_world();
     return 0;
 }
 
@@ -2483,6 +2631,17 @@ static void clientCleanup(void)
         max_ship = 0;
         XFREE(ship_ptr);
     }
+    if (max_interp_ship > 0 && interp_ship_ptr)
+    {
+        max_interp_ship = 0;
+        num_interp_ship = 0;
+        XFREE(interp_ship_ptr);
+    }
+    if (max_interp_prev > 0 && interp_prev_ptr)
+    {
+        max_interp_prev = 0;
+        XFREE(interp_prev_ptr);
+    }
     if (max_mine > 0 && mine_ptr)
     {
         max_mine = 0;
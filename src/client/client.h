@@ -531,6 +531,9 @@ extern bool pointerControl;        /* current state of mouse ship flying */
 
 extern int maxFPS; /* Client's own FPS */
 extern int oldMaxFPS;
+extern int jitterBuffer; /* Frames held back to smooth out arrival */
+extern int displayFPS;   /* Interpolated redraws per second */
+extern bool predictSelf; /* Draw our ship where our keys will take it */
 
 extern double clientFPS;    /* FPS client is drawing at */
 extern double timePerFrame; /* Time a frame is shown, unit s */
@@ -708,6 +711,7 @@ int Client_setup(void);
 void Client_cleanup(void);
 int Client_start(void);
 int Client_fps_request(void);
+void Client_interpolate(double alpha);
 int Client_power(void);
 int Client_wrap_mode(void);
 void Reset_shields(void);
@@ -740,4 +744,12 @@ extern void Colors_init_style_colors(void);
  */
 extern int Mapdata_setup(const char *);
 
+/*
+ * predict.cpp
+ */
+void Predict_keyboard(long change, uint8_t *keyboard_vector);
+void Predict_pointer_move(int movement);
+void Predict_reset(void);
+bool Predict_frame(long loops);
+
 #endif
@@ -731,6 +731,40 @@ xp_option_t default_options[] = {
         "Set maximum FPS supported by the client. The server will try to\n"
         "send at most this many frames per second to the client.\n"),
 
+    XP_INT_OPTION(
+        "jitterBuffer",
+        0,
+        0,
+        MAX_JITTER_BUFFER,
+        &jitterBuffer,
+        NULL,
+        XP_OPTFLAG_CONFIG_DEFAULT,
+        "Number of frames to hold back before drawing them, so that frames\n"
+        "arriving at uneven intervals are still drawn at a steady rate.\n"
+        "Each frame adds one server frame of delay.  0 draws frames as\n"
+        "soon as they arrive.  Takes effect on the next connection.\n"),
+
+    XP_INT_OPTION(
+        "displayFPS",
+        0,
+        0,
+        MAX_DISPLAY_FPS,
+        &displayFPS,
+        NULL,
+        XP_OPTFLAG_CONFIG_DEFAULT,
+        "With a jitterBuffer, redraw the screen this many times per second\n"
+        "with ships and the view interpolated between server frames.\n"
+        "0 draws each server frame once.\n"),
+
+    XP_BOOL_OPTION(
+        "predictSelf",
+        false,
+        &predictSelf,
+        NULL,
+        XP_OPTFLAG_CONFIG_DEFAULT,
+        "Draw your ship where the keys you are pressing will take it once\n"
+        "the server has seen them, instead of a round trip behind.\n"),
+
     XP_INT_OPTION(
         "maxMouseTurnsPS",
         0,
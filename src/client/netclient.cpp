@@ -35,6 +35,12 @@
 #include <netdb.h>
 #include <sys/param.h>
 #include <sys/time.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "commonmacros.h"
 #include "const.h"
@@ -47,6 +53,7 @@
 #include "netclient.h"
 #include "setup.h"
 #include "packet.h"
+#include "delta.h"
 #include "bit.h"
 #include "paint.h"
 #include "pack.h"
@@ -64,6 +71,8 @@
 #define TALK_RETRY 2
 #define MAX_MAP_ACK_LEN 500
 #define KEYBOARD_STORE 20
+#define PLAYOUT_RESYNC 1.0 /* seconds late before the jitter buffer resyncs */
+#define PLAYOUT_DRIFT 32   /* how slowly it follows later arrivals */
 
 /*
  * Type definitions.
@@ -71,6 +80,7 @@
 typedef struct
 {
     long loops;
+    double arrival; /* when it was read, for the jitter buffer */
     sockbuf_t sbuf;
 } frame_buf_t;
 
@@ -90,6 +100,7 @@ static sockbuf_t rbuf,
     cbuf,
     wbuf;
 static frame_buf_t *Frames;
+static int num_frames; /* receive_window_size plus jitterBuffer */
 static int (*receive_tbl[256])(void),
     (*reliable_tbl[256])(void);
 static int keyboard_delta;
@@ -107,6 +118,29 @@ static long keyboard_change[KEYBOARD_STORE],
     keyboard_acktime[KEYBOARD_STORE];
 static char talk_str[MAX_CHARS];
 
+/*
+ * Delta coded frames, see delta.h.
+ */
+static delta_frame_t delta_frames[DELTA_FRAMES];
+static delta_frame_t *delta_cur;  /* frame being received, if delta coded */
+static delta_frame_t *delta_base; /* frame it is coded against */
+static bool delta_broken;         /* a delta could not be decoded */
+static long last_frame_ack;
+
+/*
+ * Jitter buffer, see Net_playout().  Frames are drawn at the steady
+ * rate given by their loops numbers, jitterBuffer frames later than
+ * the earliest any frame has arrived relative to that rate.
+ */
+static int play_depth; /* jitterBuffer when we connected */
+static bool play_synced;
+static double play_offset;    /* arrival time minus loops / FPS */
+static long play_loops;       /* loops of the frame drawn last */
+static long play_prev_loops;  /* and of the one before that */
+static double play_time;      /* when the last frame was due */
+static double play_next_draw; /* next interpolated redraw */
+static bool play_caught_up;   /* redrawn where the last frame has them */
+
 /*
  * Initialize the function dispatch tables.
  * There are two tables.  One for the semi-important unreliable
@@ -135,6 +169,9 @@ static void Receive_init(void)
     receive_tbl[PKT_LASER] = Receive_laser;
     receive_tbl[PKT_REFUEL] = Receive_refuel;
     receive_tbl[PKT_SHIP] = Receive_ship;
+    receive_tbl[PKT_DELTA_BASE] = Receive_delta_base;
+    receive_tbl[PKT_SELF_DELTA] = Receive_self_delta;
+    receive_tbl[PKT_SHIP_DELTA] = Receive_ship_delta;
     receive_tbl[PKT_ECM] = Receive_ecm;
     receive_tbl[PKT_TRANS] = Receive_trans;
     receive_tbl[PKT_PAUSED] = Receive_paused;
@@ -260,6 +297,73 @@ static int Uncompress_map(void)
     return 0;
 }
 
+/*
+ * Map transfer methods this client can decode.
+ */
+static int Map_methods(void)
+{
+    int methods = SETUP_MAP_METHODS_OLD;
+
+#ifdef HAVE_ZLIB
+    methods |= SETUP_MAP_METHOD(SETUP_MAP_ZLIB);
+#endif
+#ifdef HAVE_ZSTD
+    methods |= SETUP_MAP_METHOD(SETUP_MAP_ZSTD);
+#endif
+    return methods;
+}
+
+/*
+ * Inflate a map compressed with zlib or zstd.
+ * Unlike the run length encoding this needs a scratch buffer.
+ */
+static int Inflate_map(void)
+{
+    uint8_t *map;
+    size_t size = Setup->x * Setup->y, len = 0;
+
+    if ((map = (uint8_t *)malloc(size)) == NULL)
+    {
+        error("No memory for map");
+        return -1;
+    }
+    switch (Setup->map_order)
+    {
+#ifdef HAVE_ZLIB
+    case SETUP_MAP_ZLIB:
+    {
+        uLongf zlen = size;
+
+        if (uncompress(map, &zlen, Setup->map_data,
+                       Setup->map_data_len) != Z_OK)
+            zlen = 0;
+        len = zlen;
+        break;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case SETUP_MAP_ZSTD:
+        len = ZSTD_decompress(map, size, Setup->map_data,
+                              Setup->map_data_len);
+        if (ZSTD_isError(len))
+            len = 0;
+        break;
+#endif
+    default:
+        break;
+    }
+    if (len != size)
+    {
+        warn("Map uncompression error (method %d)", Setup->map_order);
+        free(map);
+        return -1;
+    }
+    memcpy(Setup->map_data, map, size);
+    free(map);
+    Setup->map_order = SETUP_MAP_UNCOMPRESSED;
+    return 0;
+}
+
 /*
  * Receive the map data and some game parameters from
  * the server.  The map data may be in compressed form.
@@ -292,34 +396,32 @@ int Net_setup(void)
                 if (oldServer)
                 {
 
-                    n = Packet_scanf(&cbuf,
-                                     "%ld"
-                                     "%ld%hd"
-                                     "%hd%hd"
-                                     "%hd%hd"
-                                     "%s%s",
-                                     &Setup->map_data_len,
-                                     &Setup->mode, &Setup->lives,
-                                     &Setup->x, &Setup->y,
-                                     &Setup->frames_per_second, &Setup->map_order,
-                                     Setup->name, Setup->author);
+                    n = Packet_read<pkt_ld,
+                                    pkt_ld, pkt_hd,
+                                    pkt_hd, pkt_hd,
+                                    pkt_hd, pkt_hd,
+                                    pkt_s, pkt_s>(&cbuf,
+                                                  &Setup->map_data_len,
+                                                  &Setup->mode, &Setup->lives,
+                                                  &Setup->x, &Setup->y,
+                                                  &Setup->frames_per_second, &Setup->map_order,
+                                                  Setup->name, Setup->author);
                     Setup->width = Setup->x * BLOCK_SZ;
                     Setup->height = Setup->y * BLOCK_SZ;
                 }
                 else
                 {
-                    n = Packet_scanf(&cbuf,
-                                     "%ld"
-                                     "%ld%hd"
-                                     "%hd%hd"
-                                     "%hd%s"
-                                     "%s%S",
-                                     &Setup->map_data_len,
-                                     &Setup->mode, &Setup->lives,
-                                     &Setup->width, &Setup->height,
-                                     &Setup->frames_per_second,
-                                     Setup->name, Setup->author,
-                                     Setup->data_url);
+                    n = Packet_read<pkt_ld,
+                                    pkt_ld, pkt_hd,
+                                    pkt_hd, pkt_hd,
+                                    pkt_hd, pkt_s,
+                                    pkt_s, pkt_S>(&cbuf,
+                                                  &Setup->map_data_len,
+                                                  &Setup->mode, &Setup->lives,
+                                                  &Setup->width, &Setup->height,
+                                                  &Setup->frames_per_second,
+                                                  Setup->name, Setup->author,
+                                                  Setup->data_url);
                 }
                 if (n <= 0)
                 {
@@ -337,7 +439,7 @@ int Net_setup(void)
                 }
                 Setup->width = Setup->x * BLOCK_SZ;
                 Setup->height = Setup->y * BLOCK_SZ;
-                if (Setup->map_order != SETUP_MAP_ORDER_XY && Setup->map_order != SETUP_MAP_UNCOMPRESSED)
+                if (Setup->map_order < 0 || Setup->map_order > SETUP_MAP_ZSTD || !(Map_methods() & SETUP_MAP_METHOD(Setup->map_order)))
                 {
                     warn("Unknown map order type (%d)", Setup->map_order);
                     return -1;
@@ -420,11 +522,16 @@ int Net_setup(void)
             }
         }
     }
-    if (Setup->map_order != SETUP_MAP_UNCOMPRESSED)
+    if (Setup->map_order == SETUP_MAP_ORDER_XY)
     {
         if (Uncompress_map() == -1)
             return -1;
     }
+    else if (Setup->map_order != SETUP_MAP_UNCOMPRESSED)
+    {
+        if (Inflate_map() == -1)
+            return -1;
+    }
 
     return 0;
 }
@@ -454,7 +561,8 @@ int Net_verify(char *user_name, char *nick_name, char *disp, int my_team)
                 return -1;
             }
             Sockbuf_clear(&wbuf);
-            n = Packet_printf(&wbuf, "%c%s%s%s", PKT_VERIFY, user_name, nick_name, disp);
+            n = Packet_write<pkt_c, pkt_s, pkt_s, pkt_s, pkt_c>(&wbuf, PKT_VERIFY, user_name, nick_name, disp,
+                                                              Map_methods());
             if (n <= 0 || Sockbuf_flush(&wbuf) <= 0)
             {
                 error("Can't send verify packet");
@@ -594,15 +702,18 @@ int Net_init(char *server, int port)
     if (sock_set_receive_buffer_size(&sock, CLIENT_RECV_SIZE + 256) == -1)
         error("Can't set receive buffer size to %d", CLIENT_RECV_SIZE + 256);
 
-    size = receive_window_size * sizeof(frame_buf_t);
+    play_depth = jitterBuffer;
+    num_frames = receive_window_size + play_depth;
+    size = num_frames * sizeof(frame_buf_t);
     if ((Frames = (frame_buf_t *)malloc(size)) == NULL)
     {
         error("No memory (%u)", size);
         return -1;
     }
-    for (i = 0; i < receive_window_size; i++)
+    for (i = 0; i < num_frames; i++)
     {
         Frames[i].loops = 0;
+        Frames[i].arrival = 0.0;
         if (Sockbuf_init(&Frames[i].sbuf, &sock, CLIENT_RECV_SIZE,
                          SOCKBUF_READ | SOCKBUF_DGRAM) == -1)
         {
@@ -633,10 +744,25 @@ int Net_init(char *server, int port)
     /* reliable data byte stream offset */
     reliable_offset = 0;
 
+    /* no frames to make deltas against yet */
+    memset(delta_frames, 0, sizeof delta_frames);
+    delta_cur = delta_base = NULL;
+    last_frame_ack = 0;
+
+    play_synced = false;
+    play_loops = play_prev_loops = 0;
+    play_caught_up = true;
+
     /* reset talk status */
     talk_sequence_num = 0;
     talk_pending = 0;
 
+    /* a new server starts counting keyboard changes anew */
+    last_keyboard_change = 0;
+    last_keyboard_ack = 0;
+    last_keyboard_update = 0;
+    Predict_reset();
+
     return 0;
 }
 
@@ -664,7 +790,7 @@ void Net_cleanup(void)
     }
     if (Frames != NULL)
     {
-        for (i = 0; i < receive_window_size; i++)
+        for (i = 0; i < num_frames; i++)
         {
             if (Frames[i].sbuf.buf != NULL)
                 Sockbuf_cleanup(&Frames[i].sbuf);
@@ -764,7 +890,7 @@ int Net_start(void)
              * Therefore we don't transmit the shipshape when
              * we have had 5 unsuccesful attempts.
              */
-            if ((retries < 5 && Send_shape(shipShape) == -1) || Packet_printf(&wbuf, "%c", PKT_PLAY) <= 0 || Client_power() == -1
+            if ((retries < 5 && Send_shape(shipShape) == -1) || Packet_write<pkt_c>(&wbuf, PKT_PLAY) <= 0 || Client_power() == -1
 #ifdef SOUND
                 || Send_audio_request(1) == -1
 #endif
@@ -1125,6 +1251,111 @@ static void Net_lag_measurement(long key_ack)
         packet_lag = (int)(sum / num);
 }
 
+static double Net_clock(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/*
+ * Keep track of when frames arrive relative to the rate the server
+ * makes them at.  The earliest arrival had the least network delay
+ * and the others are held back to line up with it.  The offset
+ * creeps up to follow clock drift and route changes, and jumps
+ * after the server has been away for a while.
+ */
+static void Net_playout_arrival(frame_buf_t *frame)
+{
+    double offset;
+
+    offset = frame->arrival - (double)frame->loops / FPS;
+    if (!play_synced || offset < play_offset || offset > play_offset + PLAYOUT_RESYNC)
+    {
+        play_offset = offset;
+        play_synced = true;
+    }
+    else
+        play_offset += (offset - play_offset) / PLAYOUT_DRIFT;
+}
+
+/*
+ * Packets without a frame are held back as long as the frames are,
+ * so that the acks for their reliable data come back just as late
+ * and the server does not mistake the jitter buffer for congestion.
+ */
+static double Net_playout_due(frame_buf_t *frame)
+{
+    if (frame->loops == 0)
+        return frame->arrival + (double)play_depth / FPS;
+    return play_offset + (double)(frame->loops + play_depth) / FPS;
+}
+
+/*
+ * Redraw the last frame with the ships part of the way from where
+ * they were in the frame before, at most displayFPS times a second.
+ */
+static int Net_interpolate(void)
+{
+    double now, span;
+
+    if (play_depth == 0 || displayFPS <= 0 || play_prev_loops == 0 || play_caught_up)
+        return 0;
+    now = Net_clock();
+    if (now < play_next_draw)
+        return 0;
+    span = (double)(play_loops - play_prev_loops) / FPS;
+    if (now - play_time >= span)
+        play_caught_up = true;
+    play_next_draw = now + 1.0 / displayFPS;
+    Client_interpolate((now - play_time) / span);
+    return 1;
+}
+
+bool Net_interpolating(void)
+{
+    return play_depth > 0 && displayFPS > 0;
+}
+
+/*
+ * The newest keyboard change the server has told us it has seen.
+ */
+long Net_keyboard_ack(void)
+{
+    return last_keyboard_ack;
+}
+
+/*
+ * How many microseconds the main loop may wait for network input
+ * before it must call Net_input() anyway to draw a held back frame
+ * or an interpolated one.  -1 if there is nothing to wait for.
+ */
+long Net_playout_usec(void)
+{
+    int i;
+    double now, due, when = -1.0;
+
+    if (play_depth == 0)
+        return -1;
+    for (i = 0; i < num_frames; i++)
+    {
+        if (Frames[i].loops == 0 && Frames[i].sbuf.len <= 0)
+            continue;
+        due = Net_playout_due(&Frames[i]);
+        if (when < 0.0 || due < when)
+            when = due;
+    }
+    if (displayFPS > 0 && play_prev_loops != 0 && !play_caught_up && (when < 0.0 || play_next_draw < when))
+        when = play_next_draw;
+    if (when < 0.0)
+        return -1;
+    now = Net_clock();
+    if (when <= now)
+        return 0;
+    return (long)((when - now) * 1e6) + 1;
+}
+
 /*
  * Read a packet into one of the input buffers.
  * If it is a frame update then we check to see
@@ -1153,6 +1384,8 @@ static int Net_read(frame_buf_t *frame)
             Sockbuf_clear(&frame->sbuf);
             return 0;
         }
+        if (play_depth > 0)
+            frame->arrival = Net_clock();
         if (frame->sbuf.ptr[0] != PKT_START)
             /*
              * Don't know which type of packet this is
@@ -1162,7 +1395,7 @@ static int Net_read(frame_buf_t *frame)
             return 1;
 
         /* Peek at the frame loop number. */
-        n = Packet_scanf(&frame->sbuf, "%c%ld", &ch, &loop);
+        n = Packet_read<pkt_c, pkt_ld>(&frame->sbuf, &ch, &loop);
         frame->sbuf.ptr = frame->sbuf.buf;
         if (n <= 0)
         {
@@ -1176,6 +1409,8 @@ static int Net_read(frame_buf_t *frame)
         else if (loop > last_loops)
         {
             frame->loops = loop;
+            if (play_depth > 0)
+                Net_playout_arrival(frame);
             return 2;
         }
         else
@@ -1196,6 +1431,10 @@ static int Net_read(frame_buf_t *frame)
  * discard everything except the most recent ones.  The X server
  * may be too slow to keep up with the rate of the XPilot server
  * or there may have been a network hickup if the net is overloaded.
+ * With a jitter buffer frames are held back instead and handed out
+ * at the rate the server made them, with interpolated redraws of
+ * the last one in between.  Returns 0 if nothing was drawn, 2 if
+ * more frames are waiting.
  */
 int Net_input(void)
 {
@@ -1205,7 +1444,7 @@ int Net_input(void)
         *oldest_frame = &Frames[0],
         tmpframe;
 
-    for (i = 0; i < receive_window_size; i++)
+    for (i = 0; i < num_frames; i++)
     {
         frame = &Frames[i];
         if (!frame)
@@ -1219,11 +1458,16 @@ int Net_input(void)
                 oldest_frame = frame;
         }
         else if (frame->sbuf.len > 0 && frame->sbuf.ptr == frame->sbuf.buf)
+        {
             /*
              * Contains an unidentifiable packet.
-             * No more input until this one is processed.
+             * No more input until this one is processed,
+             * unless it is held back in the jitter buffer.
              */
+            if (play_depth > 0)
+                continue;
             break;
+        }
         else
         {
             /*
@@ -1240,18 +1484,23 @@ int Net_input(void)
                         /*
                          * No frames to be processed.
                          */
-                        return 0;
+                        return Net_interpolate();
                     break;
                 }
                 else
                     return n;
             }
             else if (n == 1)
+            {
                 /*
                  * Contains an unidentifiable packet.
-                 * No more input until this one is processed.
+                 * No more input until this one is processed,
+                 * unless it is held back in the jitter buffer.
                  */
+                if (play_depth > 0)
+                    continue;
                 break;
+            }
             else
             {
                 /*
@@ -1277,7 +1526,7 @@ int Net_input(void)
                     oldest_frame = frame;
             }
         }
-        if (i == receive_window_size - 1 && i > 0)
+        if (i == num_frames - 1 && i > 0)
         {
             /*
              * Drop oldest packet.
@@ -1307,7 +1556,7 @@ int Net_input(void)
      * Find oldest packet.
      */
     last_frame = oldest_frame = &Frames[0];
-    for (i = 1; i < receive_window_size; i++, last_frame++)
+    for (i = 1; i < num_frames; i++, last_frame++)
     {
         frame = &Frames[i];
         if (frame->loops == 0)
@@ -1339,7 +1588,38 @@ int Net_input(void)
             warn("bug %s,%d", __FILE__, __LINE__);
             oldest_frame->loops = 0;
         }
-        return 0;
+        return Net_interpolate();
+    }
+
+    /*
+     * With a jitter buffer the frame waits until it is due,
+     * meanwhile packets without a frame may be.
+     */
+    if (play_depth > 0)
+    {
+        double now = Net_clock();
+
+        if (oldest_frame->loops > 0 && now >= Net_playout_due(oldest_frame))
+        {
+            play_prev_loops = play_loops;
+            play_loops = oldest_frame->loops;
+            play_time = now;
+            if (displayFPS > 0)
+                play_next_draw = now + 1.0 / displayFPS;
+            play_caught_up = false;
+        }
+        else
+        {
+            frame = NULL;
+            for (i = 0; i < num_frames; i++)
+            {
+                if (Frames[i].loops == 0 && Frames[i].sbuf.len > 0 && (frame == NULL || Frames[i].arrival < frame->arrival))
+                    frame = &Frames[i];
+            }
+            if (frame == NULL || now < Net_playout_due(frame))
+                return Net_interpolate();
+            oldest_frame = frame;
+        }
     }
 
     /*
@@ -1353,7 +1633,7 @@ int Net_input(void)
      */
     n = Net_packet();
 
-    if (last_frame->loops > oldest_frame->loops)
+    if (last_frame != oldest_frame)
     {
         /*
          * Switch buffers to prevent gaps.
@@ -1404,9 +1684,8 @@ int Receive_start(void)
     uint8_t ch;
     long key_ack;
 
-    if ((n = Packet_scanf(&rbuf,
-                          "%c%ld%ld",
-                          &ch, &loops, &key_ack)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld, pkt_ld>(&rbuf,
+                                                &ch, &loops, &key_ack)) <= 0)
         return n;
 
     if (last_loops >= loops)
@@ -1419,6 +1698,8 @@ int Receive_start(void)
         return 0;
     }
     last_loops = loops;
+    delta_cur = delta_base = NULL;
+    delta_broken = false;
     if (key_ack > last_keyboard_ack)
     {
         if (key_ack > last_keyboard_change)
@@ -1452,9 +1733,16 @@ int Receive_end(void)
     long loops;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%ld", &ch, &loops)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld>(&rbuf, &ch, &loops)) <= 0)
         return n;
     Net_measurement(loops, PACKET_DRAW);
+    /*
+     * Let the server know which frames we have so it can send
+     * deltas against them, now and then to not send a packet
+     * every frame.
+     */
+    if (delta_cur != NULL && !delta_broken && delta_cur->loops == loops && (loops - last_frame_ack >= DELTA_ACK_FRAMES || wbuf.len > 0) && Packet_write<pkt_c, pkt_ld>(&wbuf, PKT_ACK_FRAME, loops) > 0)
+        last_frame_ack = loops;
     if ((n = Handle_end(loops)) == -1)
         return -1;
     return 1;
@@ -1470,7 +1758,7 @@ int Receive_message(void)
     uint8_t ch;
     char msg[MSG_LEN];
 
-    if ((n = Packet_scanf(&cbuf, "%c%S", &ch, msg)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_S>(&cbuf, &ch, msg)) <= 0)
         return n;
     if ((n = Handle_message(msg)) == -1)
         return -1;
@@ -1486,7 +1774,7 @@ int Receive_time_left(void)
     uint8_t ch;
     long sec;
 
-    if ((n = Packet_scanf(&rbuf, "%c%ld", &ch, &sec)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld>(&rbuf, &ch, &sec)) <= 0)
         return n;
     if ((n = Handle_time_left(sec)) == -1)
         return -1;
@@ -1498,10 +1786,11 @@ int Receive_time_left(void)
  */
 int Receive_eyes(void)
 {
-    int n, id;
+    int n;
+    short id;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd", &ch, &id)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd>(&rbuf, &ch, &id)) <= 0)
         return n;
     if ((n = Handle_eyes(id)) == -1)
         return -1;
@@ -1519,9 +1808,8 @@ int Receive_motd(void)
     int n;
     char *cbuf_ptr = cbuf.ptr;
 
-    if ((n = Packet_scanf(&cbuf,
-                          "%c%ld%hd%ld",
-                          &ch, &off, &len, &size)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld, pkt_hd, pkt_ld>(&cbuf,
+                                                        &ch, &off, &len, &size)) <= 0)
         return n;
     if (cbuf.ptr + len > &cbuf.buf[cbuf.len])
     {
@@ -1544,7 +1832,7 @@ int Net_ask_for_motd(long offset, long maxlen)
         warn("Bad motd request (%ld, %ld)", offset, maxlen);
         return -1;
     }
-    if (Packet_printf(&wbuf, "%c%ld%ld", PKT_MOTD, offset, maxlen) <= 0)
+    if (Packet_write<pkt_c, pkt_ld, pkt_ld>(&wbuf, PKT_MOTD, offset, maxlen) <= 0)
     {
         warn("Can't ask motd");
         return -1;
@@ -1565,7 +1853,7 @@ int Receive_self_items(void)
     char *rbuf_ptr_start = rbuf.ptr;
     uint8_t num_items[NUM_ITEMS];
 
-    n = Packet_scanf(&rbuf, "%c%u", &ch, &mask);
+    n = Packet_read<pkt_c, pkt_u>(&rbuf, &ch, &mask);
     if (n <= 0)
         return n;
     memset(num_items, 0, sizeof num_items);
@@ -1587,6 +1875,72 @@ int Receive_self_items(void)
     return (rbuf.ptr - rbuf_ptr_start);
 }
 
+/*
+ * Start a delta coded frame.  The deltas in it are against the frame
+ * diff frames ago, or there are none if diff is 0.
+ */
+int Receive_delta_base(void)
+{
+    int n;
+    uint8_t ch, diff;
+    long base;
+
+    if ((n = Packet_read<pkt_c, pkt_c>(&rbuf, &ch, &diff)) <= 0)
+        return n;
+    delta_cur = &delta_frames[last_loops % DELTA_FRAMES];
+    delta_cur->loops = last_loops;
+    delta_cur->has_self = false;
+    delta_cur->num_ships = 0;
+    delta_base = NULL;
+    if (diff > 0)
+    {
+        base = last_loops - diff;
+        if (delta_frames[base % DELTA_FRAMES].loops == base)
+            delta_base = &delta_frames[base % DELTA_FRAMES];
+        else
+            delta_broken = true;
+    }
+    return 1;
+}
+
+/*
+ * Act on the fields of a self packet, whether sent in full or as delta.
+ */
+static int Self_update(const short *self)
+{
+    uint8_t num_items[NUM_ITEMS];
+
+    if (delta_cur != NULL)
+    {
+        memcpy(delta_cur->self, self, sizeof(delta_cur->self));
+        delta_cur->has_self = true;
+    }
+
+    ext_view_width = self[SELF_VIEW_WIDTH];
+    ext_view_height = self[SELF_VIEW_HEIGHT];
+    debris_colors = self[SELF_DEBRIS_COLORS];
+    if (debris_colors > num_spark_colors)
+        debris_colors = num_spark_colors;
+
+    Check_view_dimensions();
+
+    memset(num_items, 0, sizeof num_items);
+    Game_over_action(self[SELF_STAT]);
+    Handle_self(self[SELF_X], self[SELF_Y],
+                self[SELF_VX], self[SELF_VY],
+                self[SELF_DIR],
+                (float)self[SELF_POWER],
+                (float)self[SELF_TURNSPEED],
+                (float)self[SELF_TURNRESISTANCE] / 255.0F,
+                self[SELF_LOCK_ID], self[SELF_LOCK_DIST], self[SELF_LOCK_DIR],
+                self[SELF_CHECK], self[SELF_AUTOPILOT],
+                num_items,
+                self[SELF_FUEL_CURRENT], self[SELF_FUEL_SUM], self[SELF_FUEL_MAX],
+                rbuf.len);
+
+    return 1;
+}
+
 /*
  * Receive the packet with all player information for the HUD.
  * If this packet is missing from the frame update then the player
@@ -1597,50 +1951,99 @@ int Receive_self(void)
 {
     int n;
     short x, y, vx, vy, lockId, lockDist,
-        fuelSum, fuelMax;
+        fuelSum, fuelMax, viewWidth, viewHeight;
     uint8_t ch, heading, power, turnspeed, turnresistance,
-        nextCheckPoint, lockDir, autopilotLight, currentTank, stat;
-    uint8_t num_items[NUM_ITEMS];
-
-    n = Packet_scanf(&rbuf,
-                     "%c"
-                     "%hd%hd%hd%hd%c"
-                     "%c%c%c"
-                     "%hd%hd%c%c",
-                     &ch,
-                     &x, &y, &vx, &vy, &heading,
-                     &power, &turnspeed, &turnresistance,
-                     &lockId, &lockDist, &lockDir, &nextCheckPoint);
+        nextCheckPoint, lockDir, autopilotLight, currentTank, stat,
+        debrisColors;
+    short self[NUM_SELF_FIELDS];
+
+    n = Packet_read<pkt_c,
+                    pkt_hd, pkt_hd, pkt_hd, pkt_hd, pkt_c,
+                    pkt_c, pkt_c, pkt_c,
+                    pkt_hd, pkt_hd, pkt_c, pkt_c>(&rbuf,
+                                                  &ch,
+                                                  &x, &y, &vx, &vy, &heading,
+                                                  &power, &turnspeed, &turnresistance,
+                                                  &lockId, &lockDist, &lockDir, &nextCheckPoint);
     if (n <= 0)
         return n;
 
-    memset(num_items, 0, sizeof num_items);
-    n = Packet_scanf(&rbuf,
-                     "%c%hd%hd"
-                     "%hd%hd%c"
-                     "%c%c",
-                     &currentTank, &fuelSum, &fuelMax,
-                     &ext_view_width, &ext_view_height, &debris_colors,
-                     &stat, &autopilotLight);
+    n = Packet_read<pkt_c, pkt_hd, pkt_hd,
+                    pkt_hd, pkt_hd, pkt_c,
+                    pkt_c, pkt_c>(&rbuf,
+                                  &currentTank, &fuelSum, &fuelMax,
+                                  &viewWidth, &viewHeight, &debrisColors,
+                                  &stat, &autopilotLight);
     if (n <= 0)
         return n;
 
-    if (debris_colors > num_spark_colors)
-        debris_colors = num_spark_colors;
+    self[SELF_X] = x;
+    self[SELF_Y] = y;
+    self[SELF_VX] = vx;
+    self[SELF_VY] = vy;
+    self[SELF_DIR] = heading;
+    self[SELF_POWER] = power;
+    self[SELF_TURNSPEED] = turnspeed;
+    self[SELF_TURNRESISTANCE] = turnresistance;
+    self[SELF_LOCK_ID] = lockId;
+    self[SELF_LOCK_DIST] = lockDist;
+    self[SELF_LOCK_DIR] = lockDir;
+    self[SELF_CHECK] = nextCheckPoint;
+    self[SELF_FUEL_CURRENT] = currentTank;
+    self[SELF_FUEL_SUM] = fuelSum;
+    self[SELF_FUEL_MAX] = fuelMax;
+    self[SELF_VIEW_WIDTH] = viewWidth;
+    self[SELF_VIEW_HEIGHT] = viewHeight;
+    self[SELF_DEBRIS_COLORS] = debrisColors;
+    self[SELF_STAT] = stat;
+    self[SELF_AUTOPILOT] = autopilotLight;
+
+    return Self_update(self);
+}
 
-    Check_view_dimensions();
+/*
+ * Receive the self fields which changed since the base frame.
+ */
+int Receive_self_delta(void)
+{
+    char *ptr = rbuf.ptr,
+         *end = rbuf.buf + rbuf.len;
+    unsigned mask;
+    int i, n, delta;
+    bool have_base = (delta_base != NULL && delta_base->has_self);
+    short self[NUM_SELF_FIELDS];
 
-    Game_over_action(stat);
-    Handle_self(x, y, vx, vy, heading,
-                (float)power,
-                (float)turnspeed,
-                (float)turnresistance / 255.0F,
-                lockId, lockDist, lockDir,
-                nextCheckPoint, autopilotLight,
-                num_items,
-                currentTank, fuelSum, fuelMax, rbuf.len);
+    if (end - ptr < 4)
+        return 0;
+    mask = (uint8_t)ptr[1] | ((uint8_t)ptr[2] << 8) | ((uint8_t)ptr[3] << 16);
+    ptr += 4;
+    for (i = 0; i < NUM_SELF_FIELDS; i++)
+    {
+        self[i] = have_base ? delta_base->self[i] : 0;
+        if (!(mask & (1 << i)))
+            continue;
+        if (SELF_SHORT_FIELDS & (1 << i))
+        {
+            if ((n = Packet_get_delta(ptr, end, &delta)) == 0)
+                return 0;
+            ptr += n;
+            self[i] = (short)(self[i] + delta);
+        }
+        else
+        {
+            if (ptr >= end)
+                return 0;
+            self[i] = (uint8_t)*ptr++;
+        }
+    }
+    rbuf.ptr = ptr;
 
-    return 1;
+    if (!have_base)
+    {
+        delta_broken = true;
+        return 1;
+    }
+    return Self_update(self);
 }
 
 int Receive_modifiers(void)
@@ -1649,7 +2052,7 @@ int Receive_modifiers(void)
     char mods[MAX_CHARS];
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%s", &ch, mods)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_s>(&rbuf, &ch, mods)) <= 0)
         return n;
     if ((n = Handle_modifiers(mods)) == -1)
         return -1;
@@ -1662,8 +2065,8 @@ int Receive_refuel(void)
     short x0, y0, x1, y1;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd%hd%hd",
-                          &ch, &x0, &y0, &x1, &y1)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_hd, pkt_hd>(&rbuf,
+                                                                &ch, &x0, &y0, &x1, &y1)) <= 0)
         return n;
     if ((n = Handle_refuel(x0, y0, x1, y1)) == -1)
         return -1;
@@ -1676,8 +2079,8 @@ int Receive_connector(void)
     short x0, y0, x1, y1;
     uint8_t ch, tractor;
 
-    n = Packet_scanf(&rbuf, "%c%hd%hd%hd%hd%c",
-                     &ch, &x0, &y0, &x1, &y1, &tractor);
+    n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_hd, pkt_hd, pkt_c>(&rbuf,
+                                                                  &ch, &x0, &y0, &x1, &y1, &tractor);
     if (n <= 0)
         return n;
     if ((n = Handle_connector(x0, y0, x1, y1, tractor)) == -1)
@@ -1691,8 +2094,8 @@ int Receive_laser(void)
     short x, y, len;
     uint8_t ch, color, dir;
 
-    if ((n = Packet_scanf(&rbuf, "%c%c%hd%hd%hd%c",
-                          &ch, &color, &x, &y, &len, &dir)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_c, pkt_hd, pkt_hd, pkt_hd, pkt_c>(&rbuf,
+                                                                      &ch, &color, &x, &y, &len, &dir)) <= 0)
         return n;
     if ((n = Handle_laser(color, x, y, len, dir)) == -1)
         return -1;
@@ -1705,7 +2108,7 @@ int Receive_missile(void)
     short x, y;
     uint8_t ch, dir, len;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd%c%c", &ch, &x, &y, &len, &dir)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_c, pkt_c>(&rbuf, &ch, &x, &y, &len, &dir)) <= 0)
         return n;
     if ((n = Handle_missile(x, y, len, dir)) == -1)
         return -1;
@@ -1718,25 +2121,30 @@ int Receive_ball(void)
     short x, y, id;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd%hd", &ch, &x, &y, &id)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_hd>(&rbuf, &ch, &x, &y, &id)) <= 0)
         return n;
     if ((n = Handle_ball(x, y, id)) == -1)
         return -1;
     return 1;
 }
 
-int Receive_ship(void)
+/*
+ * Act on a ship, whether sent in full or as delta.
+ */
+static int Ship_update(short x, short y, short id, uint8_t dir, uint8_t flags)
 {
-    int n, shield, cloak, eshield, phased, deflector;
-    short x, y, id;
-    uint8_t ch, dir, flags;
+    int shield, cloak, eshield, phased, deflector;
+    delta_ship_t *ship;
 
-    if ((n = Packet_scanf(&rbuf,
-                          "%c%hd%hd%hd"
-                          "%c%c",
-                          &ch, &x, &y, &id,
-                          &dir, &flags)) <= 0)
-        return n;
+    if (delta_cur != NULL && delta_cur->num_ships < DELTA_MAX_SHIPS)
+    {
+        ship = &delta_cur->ships[delta_cur->num_ships++];
+        ship->id = id;
+        ship->x = x;
+        ship->y = y;
+        ship->dir = dir;
+        ship->flags = flags;
+    }
 
     shield = ((flags & 1) != 0);
     cloak = ((flags & 2) != 0);
@@ -1744,18 +2152,106 @@ int Receive_ship(void)
     phased = ((flags & 8) != 0);
     deflector = ((flags & 0x10) != 0);
 
-    if ((n = Handle_ship(x, y, id, dir, shield, cloak, eshield, phased, deflector)) == -1)
+    if (Handle_ship(x, y, id, dir, shield, cloak, eshield, phased, deflector) == -1)
         return -1;
     return 1;
 }
 
+int Receive_ship(void)
+{
+    int n;
+    short x, y, id;
+    uint8_t ch, dir, flags;
+
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_hd,
+                         pkt_c, pkt_c>(&rbuf,
+                                       &ch, &x, &y, &id,
+                                       &dir, &flags)) <= 0)
+        return n;
+
+    return Ship_update(x, y, id, dir, flags);
+}
+
+/*
+ * Receive a ship which was in the base frame too.
+ */
+int Receive_ship_delta(void)
+{
+    char *ptr = rbuf.ptr,
+         *end = rbuf.buf + rbuf.len;
+    unsigned mask;
+    int i, n, value;
+    short id, x = 0, y = 0;
+    uint8_t dir = 0, flags = 0;
+    delta_ship_t *old = NULL;
+
+    if (end - ptr < 2)
+        return 0;
+    mask = (uint8_t)ptr[1];
+    ptr += 2;
+    if ((n = Packet_get_delta(ptr, end, &value)) == 0)
+        return 0;
+    ptr += n;
+    id = (short)value;
+
+    if (delta_base != NULL)
+    {
+        for (i = 0; i < delta_base->num_ships; i++)
+        {
+            if (delta_base->ships[i].id == id)
+            {
+                old = &delta_base->ships[i];
+                x = old->x;
+                y = old->y;
+                dir = old->dir;
+                flags = old->flags;
+                break;
+            }
+        }
+    }
+    if (mask & SHIP_DELTA_X)
+    {
+        if ((n = Packet_get_delta(ptr, end, &value)) == 0)
+            return 0;
+        ptr += n;
+        x = (short)(x + value);
+    }
+    if (mask & SHIP_DELTA_Y)
+    {
+        if ((n = Packet_get_delta(ptr, end, &value)) == 0)
+            return 0;
+        ptr += n;
+        y = (short)(y + value);
+    }
+    if (mask & SHIP_DELTA_DIR)
+    {
+        if (ptr >= end)
+            return 0;
+        dir = (uint8_t)*ptr++;
+    }
+    if (mask & SHIP_DELTA_FLAGS)
+    {
+        if (ptr >= end)
+            return 0;
+        flags = (uint8_t)*ptr++;
+    }
+    rbuf.ptr = ptr;
+
+    if (old == NULL)
+    {
+        delta_broken = true;
+        return 1;
+    }
+    return Ship_update(x, y, id, dir, flags);
+}
+
 int Receive_mine(void)
 {
     int n;
     short x, y, id;
     uint8_t ch, teammine;
 
-    n = Packet_scanf(&rbuf, "%c%hd%hd%c%hd", &ch, &x, &y, &teammine, &id);
+    n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_c, pkt_hd>(&rbuf, &ch, &x, &y, &teammine, &id);
     if (n <= 0)
         return n;
     if ((n = Handle_mine(x, y, teammine, id)) == -1)
@@ -1769,7 +2265,7 @@ int Receive_item(void)
     short x, y;
     uint8_t ch, type;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd%c", &ch, &x, &y, &type)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_c>(&rbuf, &ch, &x, &y, &type)) <= 0)
         return n;
     if (type < NUM_ITEMS)
     {
@@ -1785,7 +2281,7 @@ int Receive_destruct(void)
     short count;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd", &ch, &count)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd>(&rbuf, &ch, &count)) <= 0)
         return n;
     if ((n = Handle_destruct(count)) == -1)
         return -1;
@@ -1798,7 +2294,7 @@ int Receive_shutdown(void)
     short count, delay;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd", &ch, &count, &delay)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd>(&rbuf, &ch, &count, &delay)) <= 0)
         return n;
     if ((n = Handle_shutdown(count, delay)) == -1)
         return -1;
@@ -1811,7 +2307,7 @@ int Receive_thrusttime(void)
     short count, max;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd", &ch, &count, &max)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd>(&rbuf, &ch, &count, &max)) <= 0)
         return n;
     if ((n = Handle_thrusttime(count, max)) == -1)
         return -1;
@@ -1824,7 +2320,7 @@ int Receive_shieldtime(void)
     short count, max;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd", &ch, &count, &max)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd>(&rbuf, &ch, &count, &max)) <= 0)
         return n;
     if ((n = Handle_shieldtime(count, max)) == -1)
         return -1;
@@ -1837,7 +2333,7 @@ int Receive_phasingtime(void)
     short count, max;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd", &ch, &count, &max)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd>(&rbuf, &ch, &count, &max)) <= 0)
         return n;
     if ((n = Handle_phasingtime(count, max)) == -1)
         return -1;
@@ -1850,7 +2346,7 @@ int Receive_rounddelay(void)
     short count, max;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd", &ch, &count, &max)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd>(&rbuf, &ch, &count, &max)) <= 0)
         return n;
     if ((n = Handle_rounddelay(count, max)) == -1)
         return -1;
@@ -1897,8 +2393,8 @@ int Receive_wreckage(void) /* since 3.8.0 */
     short x, y;
     uint8_t ch, wrecktype, size, rot;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd%c%c%c", &ch, &x, &y,
-                          &wrecktype, &size, &rot)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_c, pkt_c, pkt_c>(&rbuf, &ch, &x, &y,
+                                                                     &wrecktype, &size, &rot)) <= 0)
         return n;
     if ((n = Handle_wreckage(x, y, wrecktype, size, rot)) == -1)
         return -1;
@@ -1911,8 +2407,8 @@ int Receive_asteroid(void) /* since 4.4.0 */
     short x, y;
     uint8_t ch, type_size, type, size, rot;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd%c%c", &ch, &x, &y,
-                          &type_size, &rot)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_c, pkt_c>(&rbuf, &ch, &x, &y,
+                                                              &type_size, &rot)) <= 0)
         return n;
 
     type = ((type_size >> 4) & 0x0F);
@@ -1929,7 +2425,7 @@ int Receive_wormhole(void) /* since 4.5.0 */
     short x, y;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd", &ch, &x, &y)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd>(&rbuf, &ch, &x, &y)) <= 0)
         return n;
     if ((n = Handle_wormhole(x, y)) == -1)
         return -1;
@@ -1942,7 +2438,7 @@ int Receive_ecm(void)
     short x, y, size;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd%hd", &ch, &x, &y, &size)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_hd>(&rbuf, &ch, &x, &y, &size)) <= 0)
         return n;
     if ((n = Handle_ecm(x, y, size)) == -1)
         return -1;
@@ -1955,8 +2451,8 @@ int Receive_trans(void)
     short x1, y1, x2, y2;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd%hd%hd",
-                          &ch, &x1, &y1, &x2, &y2)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_hd, pkt_hd>(&rbuf,
+                                                                &ch, &x1, &y1, &x2, &y2)) <= 0)
         return n;
     if ((n = Handle_trans(x1, y1, x2, y2)) == -1)
         return -1;
@@ -1969,7 +2465,7 @@ int Receive_paused(void)
     short x, y, count;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd%hd", &ch, &x, &y, &count)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_hd>(&rbuf, &ch, &x, &y, &count)) <= 0)
         return n;
     if ((n = Handle_paused(x, y, count)) == -1)
         return -1;
@@ -1981,8 +2477,8 @@ int Receive_appearing(void)
     int n;
     short x, y, id, count;
     uint8_t ch;
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd%hd%hd", &ch, &x, &y, &id,
-                          &count)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_hd, pkt_hd>(&rbuf, &ch, &x, &y, &id,
+                                                                &count)) <= 0)
         return n;
     if ((n = Handle_appearing(x, y, id, count)) == -1)
         return -1;
@@ -1995,7 +2491,7 @@ int Receive_radar(void)
     short x, y;
     uint8_t ch, size;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%hd%c", &ch, &x, &y, &size)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_c>(&rbuf, &ch, &x, &y, &size)) <= 0)
         return n;
 
     x = (int)((double)(x * 256) / Setup->width + 0.5);
@@ -2043,7 +2539,7 @@ int Receive_damaged(void)
     int n;
     uint8_t ch, damaged;
 
-    if ((n = Packet_scanf(&rbuf, "%c%c", &ch, &damaged)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_c>(&rbuf, &ch, &damaged)) <= 0)
         return n;
     if ((n = Handle_damaged(damaged)) == -1)
         return -1;
@@ -2056,7 +2552,7 @@ int Receive_leave(void)
     short id;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&cbuf, "%c%hd", &ch, &id)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd>(&cbuf, &ch, &id)) <= 0)
         return n;
     if ((n = Handle_leave(id)) == -1)
         return -1;
@@ -2069,8 +2565,8 @@ int Receive_war(void)
     short robot_id, killer_id;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&cbuf, "%c%hd%hd",
-                          &ch, &robot_id, &killer_id)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd>(&cbuf,
+                                                &ch, &robot_id, &killer_id)) <= 0)
         return n;
     if ((n = Handle_war(robot_id, killer_id)) == -1)
         return -1;
@@ -2083,8 +2579,8 @@ int Receive_seek(void)
     short programmer_id, robot_id, sought_id;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&cbuf, "%c%hd%hd%hd", &ch,
-                          &programmer_id, &robot_id, &sought_id)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_hd>(&cbuf, &ch,
+                                                        &programmer_id, &robot_id, &sought_id)) <= 0)
         return n;
     if ((n = Handle_seek(programmer_id, robot_id, sought_id)) == -1)
         return -1;
@@ -2102,20 +2598,19 @@ int Receive_player(void)
         shape[2 * MSG_LEN],
         *cbuf_ptr = cbuf.ptr;
 
-    if ((n = Packet_scanf(&cbuf,
-                          "%c%hd%c%c"
-                          "%s%s%s"
-                          "%S",
-                          &ch, &id, &myteam, &mychar,
-                          nick_name, user_name, host_name,
-                          shape)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_c, pkt_c,
+                         pkt_s, pkt_s, pkt_s,
+                         pkt_S>(&cbuf,
+                                &ch, &id, &myteam, &mychar,
+                                nick_name, user_name, host_name,
+                                shape)) <= 0)
         return n;
 
     nick_name[MAX_NAME_LEN - 1] = '\0';
     user_name[MAX_NAME_LEN - 1] = '\0';
     host_name[MAX_HOST_LEN - 1] = '\0';
 
-    if ((n = Packet_scanf(&cbuf, "%S", &shape[strlen(shape)])) <= 0)
+    if ((n = Packet_read<pkt_S>(&cbuf, &shape[strlen(shape)])) <= 0)
     {
         cbuf.ptr = cbuf_ptr;
         return n;
@@ -2135,8 +2630,8 @@ int Receive_score_object(void)
 
     /* newer servers send scores with two decimals */
     int rcv_score;
-    n = Packet_scanf(&cbuf, "%c%d%hu%hu%s",
-                     &ch, &rcv_score, &x, &y, msg);
+    n = Packet_read<pkt_c, pkt_d, pkt_hu, pkt_hu, pkt_s>(&cbuf,
+                                                         &ch, &rcv_score, &x, &y, msg);
     score = rcv_score / 100;
 
     if (n <= 0)
@@ -2156,8 +2651,8 @@ int Receive_score(void)
 
     /* newer servers send scores with two decimals */
     int rcv_score;
-    n = Packet_scanf(&cbuf, "%c%hd%d%hd%c%c", &ch,
-                     &id, &rcv_score, &life, &mychar, &alliance);
+    n = Packet_read<pkt_c, pkt_hd, pkt_d, pkt_hd, pkt_c, pkt_c>(&cbuf, &ch,
+                                                                &id, &rcv_score, &life, &mychar, &alliance);
     score = rcv_score / 100;
 
     if (n <= 0)
@@ -2174,7 +2669,7 @@ int Receive_team_score(void)
     short team;
     int rcv_score;
 
-    if ((n = Packet_scanf(&cbuf, "%c%hd%d", &ch, &team, &rcv_score)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_d>(&cbuf, &ch, &team, &rcv_score)) <= 0)
         return n;
     return 1;
 }
@@ -2186,7 +2681,7 @@ int Receive_timing(void)
     unsigned short timing;
     uint8_t ch;
 
-    n = Packet_scanf(&cbuf, "%c%hd%hu", &ch, &id, &timing);
+    n = Packet_read<pkt_c, pkt_hd, pkt_hu>(&cbuf, &ch, &id, &timing);
     if (n <= 0)
         return n;
     check = timing % MAX_CHECKS;
@@ -2202,12 +2697,12 @@ int Receive_fuel(void)
     unsigned short num, fuel;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hu%hu", &ch, &num, &fuel)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hu, pkt_hu>(&rbuf, &ch, &num, &fuel)) <= 0)
         return n;
     if ((n = Handle_fuel(num, fuel << FUEL_SCALE_BITS)) == -1)
         return -1;
     if (wbuf.len < MAX_MAP_ACK_LEN)
-        Packet_printf(&wbuf, "%c%ld%hu", PKT_ACK_FUEL, last_loops, num);
+        Packet_write<pkt_c, pkt_ld, pkt_hu>(&wbuf, PKT_ACK_FUEL, last_loops, num);
     return 1;
 }
 
@@ -2217,12 +2712,12 @@ int Receive_cannon(void)
     unsigned short num, dead_time;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hu%hu", &ch, &num, &dead_time)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hu, pkt_hu>(&rbuf, &ch, &num, &dead_time)) <= 0)
         return n;
     if ((n = Handle_cannon(num, dead_time)) == -1)
         return -1;
     if (wbuf.len < MAX_MAP_ACK_LEN)
-        Packet_printf(&wbuf, "%c%ld%hu", PKT_ACK_CANNON, last_loops, num);
+        Packet_write<pkt_c, pkt_ld, pkt_hu>(&wbuf, PKT_ACK_CANNON, last_loops, num);
     return 1;
 }
 
@@ -2232,13 +2727,13 @@ int Receive_target(void)
     unsigned short num, dead_time, damage;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hu%hu%hu", &ch,
-                          &num, &dead_time, &damage)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hu, pkt_hu, pkt_hu>(&rbuf, &ch,
+                                                        &num, &dead_time, &damage)) <= 0)
         return n;
     if ((n = Handle_target(num, dead_time, damage)) == -1)
         return -1;
     if (wbuf.len < MAX_MAP_ACK_LEN)
-        Packet_printf(&wbuf, "%c%ld%hu", PKT_ACK_TARGET, last_loops, num);
+        Packet_write<pkt_c, pkt_ld, pkt_hu>(&wbuf, PKT_ACK_TARGET, last_loops, num);
     return 1;
 }
 
@@ -2248,12 +2743,12 @@ int Receive_polystyle(void) /* since ng 4.7.0 */
     unsigned short num, newstyle;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hu%hu", &ch, &num, &newstyle)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hu, pkt_hu>(&rbuf, &ch, &num, &newstyle)) <= 0)
         return n;
     if ((n = Handle_polystyle(num, newstyle)) == -1)
         return -1;
     if (wbuf.len < MAX_MAP_ACK_LEN)
-        Packet_printf(&wbuf, "%c%ld%hu", PKT_ACK_POLYSTYLE, last_loops, num);
+        Packet_write<pkt_c, pkt_ld, pkt_hu>(&wbuf, PKT_ACK_POLYSTYLE, last_loops, num);
     return 1;
 }
 
@@ -2264,7 +2759,7 @@ int Receive_base(void)
     unsigned short num;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&cbuf, "%c%hd%hu", &ch, &id, &num)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hu>(&cbuf, &ch, &id, &num)) <= 0)
         return n;
     if ((n = Handle_base(id, num)) == -1)
         return -1;
@@ -2276,7 +2771,7 @@ int Receive_magic(void)
     int n;
     uint8_t ch;
 
-    if ((n = Packet_scanf(&cbuf, "%c%u", &ch, &magic)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_u>(&cbuf, &ch, &magic)) <= 0)
         return n;
     return 1;
 }
@@ -2287,8 +2782,8 @@ int Receive_string(void)
     uint8_t ch, type;
     unsigned short arg1, arg2;
 
-    if ((n = Packet_scanf(&cbuf, "%c%c%hu%hu",
-                          &ch, &type, &arg1, &arg2)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_c, pkt_hu, pkt_hu>(&cbuf,
+                                                       &ch, &type, &arg1, &arg2)) <= 0)
         return n;
     /*
      * Not implemented yet.
@@ -2303,7 +2798,7 @@ int Receive_loseitem(void)
     /* Most of the Receive_ funcs call a */
     /* Handle_ func but that seems */
     /* unecessary here */
-    if ((n = Packet_scanf(&rbuf, "%c%c", &pkt, &lose_item)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_c>(&rbuf, &pkt, &lose_item)) <= 0)
         return n;
     return 1;
 }
@@ -2312,8 +2807,8 @@ int Send_ack(long rel_loops)
 {
     int n;
 
-    if ((n = Packet_printf(&wbuf, "%c%ld%ld", PKT_ACK,
-                           reliable_offset, rel_loops)) <= 0)
+    if ((n = Packet_write<pkt_c, pkt_ld, pkt_ld>(&wbuf, PKT_ACK,
+                                                 reliable_offset, rel_loops)) <= 0)
     {
         if (n == 0)
             return 0;
@@ -2330,8 +2825,8 @@ int Receive_reliable(void)
     uint8_t ch;
     long rel, rel_loops;
 
-    if ((n = Packet_scanf(&rbuf, "%c%hd%ld%ld",
-                          &ch, &len, &rel, &rel_loops)) == -1)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_ld, pkt_ld>(&rbuf,
+                                                        &ch, &len, &rel, &rel_loops)) == -1)
         return -1;
     if (n == 0)
     {
@@ -2410,7 +2905,7 @@ int Receive_reply(int *replyto, int *result)
     int n;
     uint8_t type, ch1, ch2;
 
-    n = Packet_scanf(&cbuf, "%c%c%c", &type, &ch1, &ch2);
+    n = Packet_read<pkt_c, pkt_c, pkt_c>(&cbuf, &type, &ch1, &ch2);
     if (n <= 0)
         return n;
     if (n != 3 || type != PKT_REPLY)
@@ -2431,11 +2926,12 @@ int Send_keyboard(uint8_t *keyboard_vector)
         /* Not enough write buffer space for keyboard state */
         return 0;
 
-    Packet_printf(&wbuf, "%c%ld", PKT_KEYBOARD, last_keyboard_change);
+    Packet_write<pkt_c, pkt_ld>(&wbuf, PKT_KEYBOARD, last_keyboard_change);
     memcpy(&wbuf.buf[wbuf.len], keyboard_vector, size);
     wbuf.len += size;
     last_keyboard_update = last_loops;
     Net_keyboard_track();
+    Predict_keyboard(last_keyboard_change, keyboard_vector);
     Send_talk();
     if (Sockbuf_flush(&wbuf) == -1)
     {
@@ -2454,9 +2950,9 @@ int Send_shape(char *str)
     w = Convert_shape_str(str);
     Convert_ship_2_string(w, buf, ext, 0x3200);
     Free_ship_shape(w);
-    if (Packet_printf(&wbuf, "%c%S", PKT_SHAPE, buf) <= 0)
+    if (Packet_write<pkt_c, pkt_S>(&wbuf, PKT_SHAPE, buf) <= 0)
         return -1;
-    if (Packet_printf(&wbuf, "%S", ext) <= 0)
+    if (Packet_write<pkt_S>(&wbuf, ext) <= 0)
         return -1;
 
     return 0;
@@ -2464,48 +2960,48 @@ int Send_shape(char *str)
 
 int Send_power(double power)
 {
-    if (Packet_printf(&wbuf, "%c%hd", PKT_POWER,
-                      (int)(power * 256.0)) == -1)
+    if (Packet_write<pkt_c, pkt_hd>(&wbuf, PKT_POWER,
+                                    (int)(power * 256.0)) == -1)
         return -1;
     return 0;
 }
 
 int Send_power_s(double power_s)
 {
-    if (Packet_printf(&wbuf, "%c%hd", PKT_POWER_S,
-                      (int)(power_s * 256.0)) == -1)
+    if (Packet_write<pkt_c, pkt_hd>(&wbuf, PKT_POWER_S,
+                                    (int)(power_s * 256.0)) == -1)
         return -1;
     return 0;
 }
 
 int Send_turnspeed(double turnspeed)
 {
-    if (Packet_printf(&wbuf, "%c%hd", PKT_TURNSPEED,
-                      (int)(turnspeed * 256.0)) == -1)
+    if (Packet_write<pkt_c, pkt_hd>(&wbuf, PKT_TURNSPEED,
+                                    (int)(turnspeed * 256.0)) == -1)
         return -1;
     return 0;
 }
 
 int Send_turnspeed_s(double turnspeed_s)
 {
-    if (Packet_printf(&wbuf, "%c%hd", PKT_TURNSPEED_S,
-                      (int)(turnspeed_s * 256.0)) == -1)
+    if (Packet_write<pkt_c, pkt_hd>(&wbuf, PKT_TURNSPEED_S,
+                                    (int)(turnspeed_s * 256.0)) == -1)
         return -1;
     return 0;
 }
 
 int Send_turnresistance(double turnresistance)
 {
-    if (Packet_printf(&wbuf, "%c%hd", PKT_TURNRESISTANCE,
-                      (int)(turnresistance * 256.0)) == -1)
+    if (Packet_write<pkt_c, pkt_hd>(&wbuf, PKT_TURNRESISTANCE,
+                                    (int)(turnresistance * 256.0)) == -1)
         return -1;
     return 0;
 }
 
 int Send_turnresistance_s(double turnresistance_s)
 {
-    if (Packet_printf(&wbuf, "%c%hd", PKT_TURNRESISTANCE_S,
-                      (int)(turnresistance_s * 256.0)) == -1)
+    if (Packet_write<pkt_c, pkt_hd>(&wbuf, PKT_TURNRESISTANCE_S,
+                                    (int)(turnresistance_s * 256.0)) == -1)
         return -1;
     return 0;
 }
@@ -2520,11 +3016,11 @@ int Receive_quit(void)
         sbuf = &rbuf;
     else
         sbuf = &cbuf;
-    if (Packet_scanf(sbuf, "%c", &pkt) != 1)
+    if (Packet_read<pkt_c>(sbuf, &pkt) != 1)
         warn("Can't read quit packet");
     else
     {
-        if (Packet_scanf(sbuf, "%s", reason) <= 0)
+        if (Packet_read<pkt_s>(sbuf, reason) <= 0)
             strlcpy(reason, "unknown reason", MAX_CHARS);
         warn("Got quit packet: \"%s\"", reason);
     }
@@ -2536,7 +3032,7 @@ int Receive_audio(void)
     int n;
     uint8_t pkt, type, vol;
 
-    if ((n = Packet_scanf(&rbuf, "%c%c%c", &pkt, &type, &vol)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_c, pkt_c>(&rbuf, &pkt, &type, &vol)) <= 0)
         return n;
 #ifdef SOUND
     if ((n = Handle_audio(type, vol)) == -1)
@@ -2551,7 +3047,7 @@ int Receive_talk_ack(void)
     uint8_t pkt;
     long talk_ack;
 
-    if ((n = Packet_scanf(&cbuf, "%c%ld", &pkt, &talk_ack)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld>(&cbuf, &pkt, &talk_ack)) <= 0)
         return n;
     if (talk_ack >= talk_pending)
         talk_pending = 0;
@@ -2572,8 +3068,8 @@ int Send_talk(void)
         return 0;
     if (last_loops - talk_last_send < TALK_RETRY)
         return 0;
-    if (Packet_printf(&wbuf, "%c%ld%s", PKT_TALK,
-                      talk_pending, talk_str) == -1)
+    if (Packet_write<pkt_c, pkt_ld, pkt_s>(&wbuf, PKT_TALK,
+                                           talk_pending, talk_str) == -1)
         return -1;
     talk_last_send = last_loops;
     return 0;
@@ -2603,9 +3099,9 @@ int Send_display(void)
         ext_view_height = height_wanted;
         Check_view_dimensions();
     }
-    else if (Packet_printf(&wbuf, "%c%hd%hd%c%c", PKT_DISPLAY,
-                           width_wanted, height_wanted,
-                           num_spark_colors, spark_rand) == -1)
+    else if (Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_c, pkt_c>(&wbuf, PKT_DISPLAY,
+                                                               width_wanted, height_wanted,
+                                                               num_spark_colors, spark_rand) == -1)
         return -1;
 
     old_spark_rand = spark_rand;
@@ -2617,16 +3113,17 @@ int Send_modifier_bank(int bank)
 {
     if (bank < 0 || bank >= NUM_MODBANKS)
         return -1;
-    if (Packet_printf(&wbuf, "%c%c%s", PKT_MODIFIERBANK,
-                      bank, modBankStr[bank]) == -1)
+    if (Packet_write<pkt_c, pkt_c, pkt_s>(&wbuf, PKT_MODIFIERBANK,
+                                          bank, modBankStr[bank]) == -1)
         return -1;
     return 0;
 }
 
 int Send_pointer_move(int movement)
 {
-    if (Packet_printf(&wbuf, "%c%hd", PKT_POINTER_MOVE, movement) == -1)
+    if (Packet_write<pkt_c, pkt_hd>(&wbuf, PKT_POINTER_MOVE, movement) == -1)
         return -1;
+    Predict_pointer_move(movement);
 
     return 0;
 }
@@ -2640,14 +3137,14 @@ int Send_audio_request(bool on)
 #ifndef SOUND
     on = false;
 #endif
-    if (Packet_printf(&wbuf, "%c%c", PKT_REQUEST_AUDIO, (on ? 1 : 0)) == -1)
+    if (Packet_write<pkt_c, pkt_c>(&wbuf, PKT_REQUEST_AUDIO, (on ? 1 : 0)) == -1)
         return -1;
     return 0;
 }
 
 int Send_fps_request(int fps)
 {
-    if (Packet_printf(&wbuf, "%c%c", PKT_ASYNC_FPS, fps) == -1)
+    if (Packet_write<pkt_c, pkt_c>(&wbuf, PKT_ASYNC_FPS, fps) == -1)
         return -1;
     return 0;
 }
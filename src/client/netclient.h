@@ -30,6 +30,8 @@
 
 #define MIN_RECEIVE_WINDOW_SIZE 1
 #define MAX_RECEIVE_WINDOW_SIZE 4
+#define MAX_JITTER_BUFFER 8
+#define MAX_DISPLAY_FPS 250
 
 #define FPS (Setup->frames_per_second)
 #define MAX_SUPPORTED_FPS 255
@@ -59,11 +61,16 @@ int Net_start(void);
 void Net_init_measurement(void);
 void Net_init_lag_measurement(void);
 int Net_input(void);
+long Net_playout_usec(void);
+long Net_keyboard_ack(void);
+bool Net_interpolating(void);
 /* void Net_measurement(long loop, int status);*/
 int Receive_start(void);
 int Receive_end(void);
 int Receive_message(void);
 int Receive_self(void);
+int Receive_self_delta(void);
+int Receive_delta_base(void);
 int Receive_self_items(void);
 int Receive_modifiers(void);
 int Receive_refuel(void);
@@ -72,6 +79,7 @@ int Receive_laser(void);
 int Receive_missile(void);
 int Receive_ball(void);
 int Receive_ship(void);
+int Receive_ship_delta(void);
 int Receive_mine(void);
 int Receive_item(void);
 int Receive_destruct(void);
@@ -0,0 +1,444 @@
+/*
+ * XPilot, a multiplayer gravity war game.  Copyright (C) 1991-2001 by
+ *
+ *      Bjørn Stabell
+ *      Ken Ronny Schouten
+ *      Bert Gijsbers
+ *      Dick Balaska
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Client side prediction of our own ship.
+ *
+ * A key press only shows up in a frame from the server a round trip
+ * later.  To hide that, the ship is drawn where it will be when the
+ * keys we are pressing now have reached the server: the last frame's
+ * position, velocity and heading are run forward by packet_lag ticks
+ * with the same turn and thrust steps the server uses, applying each
+ * keyboard change at the tick it is expected to take effect.  Changes
+ * the server has acknowledged are already part of the frame.
+ *
+ * The client does not know the map's gravity, friction or the ship's
+ * exact mass, so the acceleration with the engine off and the thrust
+ * per unit of power are learnt from the frames themselves.
+ *
+ * Every frame the prediction is redone from the new server state.
+ * The difference to the old prediction is kept as an offset which is
+ * shrunk each frame, so mispredictions are smoothed out instead of
+ * making the ship jump.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+#include "bit.h"
+#include "commonmacros.h"
+#include "const.h"
+#include "item.h"
+#include "keys.h"
+#include "rules.h"
+#include "setup.h"
+#include "types.h"
+
+#include "client.h"
+#include "netclient.h"
+
+#define PREDICT_KEYS 32   /* keyboard changes remembered */
+#define PREDICT_TURNS 64  /* pointer movements remembered */
+
+#define PREDICT_THRUST (1 << 0)
+#define PREDICT_LEFT (1 << 1)
+#define PREDICT_RIGHT (1 << 2)
+
+#define PREDICT_SMOOTH 0.7 /* part of the error left after a frame */
+#define PREDICT_SNAP 64.0  /* errors bigger than this are not smoothed */
+#define PREDICT_LEARN 0.05 /* weight of a new sample */
+#define PREDICT_WILD 2.0   /* samples further off than this are bounces */
+
+typedef struct
+{
+    long change; /* keyboard change id */
+    long loops;  /* server tick it should take effect at */
+    int keys;
+} predict_key_t;
+
+typedef struct
+{
+    long loops;
+    double turn;
+} predict_turn_t;
+
+typedef struct
+{
+    double x, y;
+    double vx, vy;
+    double dir, turnvel;
+} predict_ship_t;
+
+static predict_key_t key_ring[PREDICT_KEYS];
+static int key_next, key_count;
+static predict_turn_t turn_ring[PREDICT_TURNS];
+static int turn_next, turn_count;
+
+static bool valid;
+static long srv_loops;       /* tick of the last server frame */
+static predict_ship_t srv;   /* our ship in that frame */
+static long pred_loops;      /* tick of the last prediction */
+static predict_ship_t pred;  /* our ship as last predicted */
+static double corr_x, corr_y; /* offset still to be smoothed out */
+static double grav_x, grav_y; /* learnt acceleration with no thrust */
+static double thrust_gain = 1.0;
+
+static long Predict_horizon(void)
+{
+    long h = packet_lag;
+
+    LIMIT(h, 0, (long)FPS);
+    return h;
+}
+
+void Predict_keyboard(long change, uint8_t *keyboard_vector)
+{
+    predict_key_t *k;
+    int keys = 0;
+
+    if (BITV_ISSET(keyboard_vector, KEY_THRUST))
+        keys |= PREDICT_THRUST;
+    if (BITV_ISSET(keyboard_vector, KEY_TURN_LEFT))
+        keys |= PREDICT_LEFT;
+    if (BITV_ISSET(keyboard_vector, KEY_TURN_RIGHT))
+        keys |= PREDICT_RIGHT;
+
+    /*
+     * Resends of the same change keep their first tick.  The changes
+     * count from zero again on a new connection.
+     */
+    if (key_count > 0)
+    {
+        k = &key_ring[(key_next + PREDICT_KEYS - 1) % PREDICT_KEYS];
+        if (k->change == change)
+            return;
+        if (k->change > change)
+            key_count = turn_count = 0;
+    }
+    k = &key_ring[key_next];
+    k->change = change;
+    k->loops = last_loops + Predict_horizon();
+    k->keys = keys;
+    key_next = (key_next + 1) % PREDICT_KEYS;
+    if (key_count < PREDICT_KEYS)
+        key_count++;
+}
+
+void Predict_pointer_move(int movement)
+{
+    predict_turn_t *t;
+    double turn = movement * displayedTurnspeed / MAX_PLAYER_TURNSPEED;
+
+    /* Same limits as the server's Receive_pointer_move(). */
+    if (displayedTurnresistance)
+    {
+        if (turn < 0)
+            turn = -MAX(MIN(-turn, MAX_PLAYER_TURNSPEED), MIN_PLAYER_TURNSPEED);
+        else
+            turn = MAX(MIN(turn, MAX_PLAYER_TURNSPEED), MIN_PLAYER_TURNSPEED);
+    }
+    else
+        LIMIT(turn, -5.0 * RES, 5.0 * RES);
+
+    t = &turn_ring[turn_next];
+    t->loops = last_loops + Predict_horizon();
+    t->turn = -turn;
+    turn_next = (turn_next + 1) % PREDICT_TURNS;
+    if (turn_count < PREDICT_TURNS)
+        turn_count++;
+}
+
+/*
+ * The keys held at server tick t: those of the newest change which
+ * has been acknowledged or should have arrived by then.
+ */
+static int Predict_keys(long t, long ack)
+{
+    int i;
+
+    for (i = 1; i <= key_count; i++)
+    {
+        predict_key_t *k = &key_ring[(key_next + PREDICT_KEYS - i) % PREDICT_KEYS];
+
+        if (k->change <= ack || k->loops <= t)
+            return k->keys;
+    }
+    return 0;
+}
+
+static double Predict_pointer_turn(long t)
+{
+    int i;
+    double turn = 0.0;
+
+    for (i = 1; i <= turn_count; i++)
+    {
+        predict_turn_t *p = &turn_ring[(turn_next + PREDICT_TURNS - i) % PREDICT_TURNS];
+
+        if (p->loops == t)
+            turn += p->turn;
+    }
+    return turn;
+}
+
+static double Predict_thrust(void)
+{
+    int a = numItems[ITEM_AFTERBURNER];
+    double mass = SHIP_MASS + FUEL_MASS((double)fuelSum * FUEL_SCALE_FACT) + numItems[ITEM_ARMOR] * SHIP_MASS / 14;
+    double power = displayedPower;
+
+    if (a)
+        power = AFTER_BURN_POWER(power, a);
+    return power / mass;
+}
+
+static void Predict_turn(predict_ship_t *s, long t, int keys)
+{
+    double turnacc = 0.0;
+
+    if (keys & PREDICT_LEFT)
+        turnacc += displayedTurnspeed;
+    if (keys & PREDICT_RIGHT)
+        turnacc -= displayedTurnspeed;
+
+    s->turnvel += turnacc + Predict_pointer_turn(t);
+    if (displayedTurnresistance)
+        s->turnvel *= displayedTurnresistance;
+    s->dir += s->turnvel;
+    while (s->dir < 0)
+        s->dir += RES;
+    while (s->dir >= RES)
+        s->dir -= RES;
+    if (!displayedTurnresistance)
+        s->turnvel = 0;
+}
+
+/*
+ * One server tick, in the order Update_objects() does it.
+ */
+static void Predict_tick(predict_ship_t *s, long t, long ack)
+{
+    int keys = Predict_keys(t, ack);
+
+    Predict_turn(s, t, keys);
+    if ((keys & PREDICT_THRUST) && fuelSum > 0)
+    {
+        int dir = MOD2((int)(s->dir + 0.5), RES);
+        double acc = Predict_thrust() * thrust_gain;
+
+        s->vx += acc * tcos(dir);
+        s->vy += acc * tsin(dir);
+    }
+    s->vx += grav_x;
+    s->vy += grav_y;
+    s->x += s->vx;
+    s->y += s->vy;
+}
+
+/*
+ * The server sends its velocity truncated towards zero.
+ */
+static double Predict_vel(int v)
+{
+    if (v > 0)
+        return v + 0.5;
+    if (v < 0)
+        return v - 0.5;
+    return 0.0;
+}
+
+static double Predict_wrap(double d, int size)
+{
+    if (BIT(Setup->mode, WRAP_PLAY))
+    {
+        if (d > size / 2)
+            d -= size;
+        else if (d < -size / 2)
+            d += size;
+    }
+    return d;
+}
+
+/*
+ * Learn gravity and thrust from how our velocity changed since the
+ * previous frame.  Only stretches with the engine either off or on
+ * all the time and no turning are used.
+ */
+static void Predict_learn(long loops, double vx, double vy, long ack)
+{
+    long t, n = loops - srv_loops;
+    int keys = -1;
+    double ax, ay, along, expect;
+
+    if (n <= 0 || n > FPS)
+        return;
+    for (t = srv_loops + 1; t <= loops; t++)
+    {
+        int k = Predict_keys(t, ack);
+
+        if (keys != -1 && k != keys)
+            return;
+        keys = k;
+    }
+    if (keys & (PREDICT_LEFT | PREDICT_RIGHT))
+        return;
+
+    ax = (vx - srv.vx) / n;
+    ay = (vy - srv.vy) / n;
+    if (!(keys & PREDICT_THRUST))
+    {
+        if (ABS(ax - grav_x) > PREDICT_WILD || ABS(ay - grav_y) > PREDICT_WILD)
+            return;
+        grav_x += (ax - grav_x) * PREDICT_LEARN;
+        grav_y += (ay - grav_y) * PREDICT_LEARN;
+        return;
+    }
+
+    expect = Predict_thrust();
+    if (heading != MOD2((int)(srv.dir + 0.5), RES) || expect <= 0 || fuelSum <= 0)
+        return;
+    along = (ax - grav_x) * tcos(heading) + (ay - grav_y) * tsin(heading);
+    if (ABS(along - expect * thrust_gain) > PREDICT_WILD)
+        return;
+    thrust_gain += (along / expect - thrust_gain) * PREDICT_LEARN;
+    LIMIT(thrust_gain, 0.5, 2.0);
+}
+
+/*
+ * Forget the ship and the keys and turns of a previous connection.
+ */
+void Predict_reset(void)
+{
+    key_next = key_count = 0;
+    turn_next = turn_count = 0;
+    valid = false;
+    corr_x = corr_y = 0.0;
+    grav_x = grav_y = 0.0;
+    thrust_gain = 1.0;
+}
+
+/*
+ * Called at the end of a frame with our ship in selfPos, selfVel and
+ * heading.  Replaces them and our entry in ship_ptr with the predicted
+ * ship.  Returns false when there was nothing to predict.
+ */
+bool Predict_frame(long loops)
+{
+    long t, h, ack = Net_keyboard_ack();
+    predict_ship_t s;
+    double ex, ey;
+    int i, dir;
+
+    if (!predictSelf || !selfVisible || snooping || autopilotLight || !self)
+    {
+        /* start over from the server's ship when it is back. */
+        valid = false;
+        corr_x = corr_y = 0.0;
+        return false;
+    }
+
+    s.x = selfPos.x;
+    s.y = selfPos.y;
+    s.vx = Predict_vel(selfVel.x);
+    s.vy = Predict_vel(selfVel.y);
+    s.dir = heading;
+    s.turnvel = 0.0;
+
+    if (valid && loops > srv_loops)
+    {
+        Predict_learn(loops, s.vx, s.vy, ack);
+
+        /*
+         * Keep turning speed and the part of a heading unit the server
+         * does not send by following the server's turning from the
+         * last frame.
+         */
+        for (t = srv_loops + 1; t <= loops; t++)
+            Predict_turn(&srv, t, Predict_keys(t, ack));
+        if (MOD2((int)(srv.dir + 0.5), RES) == heading)
+            s.dir = srv.dir;
+        s.turnvel = srv.turnvel;
+    }
+    else
+        valid = false;
+    srv_loops = loops;
+    srv = s;
+
+    h = Predict_horizon();
+    for (t = loops + 1; t <= loops + h; t++)
+        Predict_tick(&s, t, ack);
+
+    if (valid)
+    {
+        /* Where the old prediction would be by now. */
+        double dt = (loops + h) - pred_loops;
+
+        ex = Predict_wrap(pred.x + pred.vx * dt - s.x, Setup->width);
+        ey = Predict_wrap(pred.y + pred.vy * dt - s.y, Setup->height);
+        corr_x = (corr_x + ex) * PREDICT_SMOOTH;
+        corr_y = (corr_y + ey) * PREDICT_SMOOTH;
+        if (ABS(corr_x) > PREDICT_SNAP || ABS(corr_y) > PREDICT_SNAP)
+            corr_x = corr_y = 0.0;
+    }
+    valid = true;
+    pred_loops = loops + h;
+    pred = s;
+
+    s.x += corr_x;
+    s.y += corr_y;
+    if (BIT(Setup->mode, WRAP_PLAY))
+    {
+        s.x = fmod(s.x, Setup->width);
+        if (s.x < 0)
+            s.x += Setup->width;
+        s.y = fmod(s.y, Setup->height);
+        if (s.y < 0)
+            s.y += Setup->height;
+    }
+    else
+    {
+        LIMIT(s.x, 0, Setup->width - 1);
+        LIMIT(s.y, 0, Setup->height - 1);
+    }
+    selfPos.x = (int)(s.x + 0.5);
+    selfPos.y = (int)(s.y + 0.5);
+    if (selfPos.x >= Setup->width)
+        selfPos.x -= Setup->width;
+    if (selfPos.y >= Setup->height)
+        selfPos.y -= Setup->height;
+    dir = MOD2((int)(s.dir + 0.5), RES);
+    heading = dir;
+    for (i = 0; i < num_ship; i++)
+    {
+        if (ship_ptr[i].id == self->id)
+        {
+            ship_ptr[i].x = selfPos.x;
+            ship_ptr[i].y = selfPos.y;
+            ship_ptr[i].dir = dir;
+            break;
+        }
+    }
+    return true;
+}
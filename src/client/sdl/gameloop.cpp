@@ -56,7 +56,7 @@ void Game_loop(void)
             error("Select failed");
             return;
         }
-        if (n > 0)
+        if (n > 0 || Net_playout_usec() == 0)
         {
             if (Net_input() == -1)
             {
@@ -42,6 +42,7 @@ void Game_loop(void)
 {
     fd_set rfds, tfds;
     int max, n, netfd, result, clientfd;
+    long playout;
     struct timeval tv;
     SDL_SysWMinfo info;
 
@@ -93,6 +94,17 @@ void Game_loop(void)
             tv.tv_usec = t % 1000000;
         }
 
+        /*
+         * Wake up in time for frames held in the jitter buffer.
+         */
+        if ((playout = Net_playout_usec()) >= 0 && playout < tv.tv_sec * 1000000L + tv.tv_usec)
+        {
+            tv.tv_sec = playout / 1000000;
+            tv.tv_usec = playout % 1000000;
+        }
+        else
+            playout = -1;
+
         if ((n = select(max + 1, &rfds, NULL, NULL, &tv)) == -1)
         {
             if (errno == EINTR)
@@ -107,7 +119,7 @@ void Game_loop(void)
                 cumulativeMouseMovement != 0)
                 continue;
 
-            if (result <= 1)
+            if (result <= 1 && playout < 0)
             {
                 warn("No response from server");
                 continue;
@@ -123,7 +135,7 @@ void Game_loop(void)
                 return;
             }
         }
-        if (FD_ISSET(netfd, &rfds) || result > 1)
+        if (FD_ISSET(netfd, &rfds) || result > 1 || playout >= 0)
         {
             if ((result = Net_input()) == -1)
             {
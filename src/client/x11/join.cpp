@@ -71,6 +71,7 @@ static void Input_loop(void)
         netfd,
         result,
         clientfd;
+    long playout;
     struct timeval tv;
 
     if ((result = Net_input()) == -1)
@@ -122,6 +123,16 @@ static void Input_loop(void)
             tv.tv_sec = 10;
             tv.tv_usec = 0;
         }
+        /*
+         * Wake up in time for frames held in the jitter buffer.
+         */
+        if ((playout = Net_playout_usec()) >= 0 && playout < tv.tv_sec * 1000000L + tv.tv_usec)
+        {
+            tv.tv_sec = playout / 1000000;
+            tv.tv_usec = playout % 1000000;
+        }
+        else
+            playout = -1;
         if ((n = select(max + 1, &rfds, NULL, NULL, &tv)) == -1)
         {
             if (errno == EINTR)
@@ -142,7 +153,7 @@ static void Input_loop(void)
                 }
                 continue;
             }
-            else if (result <= 1)
+            else if (result <= 1 && playout < 0)
             {
                 errno = 0;
                 error("No response from server");
@@ -161,7 +172,7 @@ static void Input_loop(void)
                 return;
             }
         }
-        if (FD_ISSET(netfd, &rfds) || result > 1)
+        if (FD_ISSET(netfd, &rfds) || result > 1 || playout >= 0)
         {
             struct timeval tv1, tv2;
 
@@ -582,6 +582,27 @@ old_option_t oldOptions[] = {
      "3",
      KEY_DUMMY,
      "Too complicated.  Keep it on 3.\n"},
+    {"jitterBuffer",
+     NULL,
+     "0",
+     KEY_DUMMY,
+     "Number of frames to hold back before drawing them, so that frames\n"
+     "arriving at uneven intervals are still drawn at a steady rate.\n"
+     "Each frame adds one server frame of delay.  0 draws frames as\n"
+     "soon as they arrive.\n"},
+    {"displayFPS",
+     NULL,
+     "0",
+     KEY_DUMMY,
+     "With a jitterBuffer, redraw the screen this many times per second\n"
+     "with ships and the view interpolated between server frames.\n"
+     "0 draws each server frame once.\n"},
+    {"predictSelf",
+     NULL,
+     "No",
+     KEY_DUMMY,
+     "Draw your ship where the keys you are pressing will take it once\n"
+     "the server has seen them, instead of a round trip behind.\n"},
     {"visual",
      NULL,
      "",
@@ -2227,6 +2248,11 @@ void Parse_options(int *argcp, char **argvp, char *realName, int *port,
 
     Get_int_resource(rDB, "receiveWindowSize", &receive_window_size);
     LIMIT(receive_window_size, MIN_RECEIVE_WINDOW_SIZE, MAX_RECEIVE_WINDOW_SIZE);
+    Get_int_resource(rDB, "jitterBuffer", &jitterBuffer);
+    LIMIT(jitterBuffer, 0, MAX_JITTER_BUFFER);
+    Get_int_resource(rDB, "displayFPS", &displayFPS);
+    LIMIT(displayFPS, 0, MAX_DISPLAY_FPS);
+    Get_bool_resource(rDB, "predictSelf", &predictSelf);
 
     Get_resource(rDB, "recordFile", resValue, sizeof resValue);
     Record_init(resValue);
@@ -123,6 +123,16 @@ extern double tbl_cos[];
 #define MAX_PLAYER_TURNRESISTANCE 1.0
 #define MIN_PLAYER_TURNRESISTANCE 0.0
 
+#define SHIP_MASS 20.0 /* default of the server's shipMass */
+
+#define LG2_MAX_AFTERBURNER 4
+#define ALT_SPARK_MASS_FACT 4.2
+#define MAX_AFTERBURNER ((1 << LG2_MAX_AFTERBURNER) - 1)
+#define AFTER_BURN_POWER_FACTOR(n) \
+        (1.0 + (n) * ((ALT_SPARK_MASS_FACT - 1.0) / (MAX_AFTERBURNER + 1.0)))
+#define AFTER_BURN_POWER(p, n) \
+        ((p) * AFTER_BURN_POWER_FACTOR(n))
+
 #define FUEL_SCALE_BITS 8
 #define FUEL_SCALE_FACT (1 << FUEL_SCALE_BITS)
 #define FUEL_MASS(f) ((f) * 0.005 / FUEL_SCALE_FACT)
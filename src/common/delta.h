@@ -0,0 +1,101 @@
+/*
+ * XPilot, a multiplayer gravity war game.  Copyright (C) 1991-2001 by
+ *
+ *      Bjørn Stabell
+ *      Ken Ronny Schouten
+ *      Bert Gijsbers
+ *      Dick Balaska
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <cstdint>
+
+/*
+ * Delta coded frames, since pack version 4502.
+ *
+ * When the server starts a frame with PKT_DELTA_BASE it names an
+ * earlier frame which the client has acknowledged with
+ * PKT_ACK_FRAME.  PKT_SELF_DELTA and PKT_SHIP_DELTA in the frame only
+ * carry the fields which differ from that base frame.  Both sides
+ * remember what was in the last DELTA_FRAMES frames.  A base of 0
+ * means there is none and everything is sent in full (a key frame),
+ * which is also what happens when the acknowledgements stop coming.
+ */
+#define DELTA_FRAMES 64       /* frames remembered, a power of 2 */
+#define DELTA_MAX_SHIPS 32    /* ships per frame which are remembered */
+#define DELTA_ACK_FRAMES 4    /* frames between client acknowledgements */
+
+/* the fields of the self packet in the order they are sent. */
+enum self_field_e
+{
+    SELF_X,
+    SELF_Y,
+    SELF_VX,
+    SELF_VY,
+    SELF_DIR,
+    SELF_POWER,
+    SELF_TURNSPEED,
+    SELF_TURNRESISTANCE,
+    SELF_LOCK_ID,
+    SELF_LOCK_DIST,
+    SELF_LOCK_DIR,
+    SELF_CHECK,
+    SELF_FUEL_CURRENT,
+    SELF_FUEL_SUM,
+    SELF_FUEL_MAX,
+    SELF_VIEW_WIDTH,
+    SELF_VIEW_HEIGHT,
+    SELF_DEBRIS_COLORS,
+    SELF_STAT,
+    SELF_AUTOPILOT,
+    NUM_SELF_FIELDS
+};
+
+/* the self fields which are sent as shorts, the others are bytes. */
+#define SELF_SHORT_FIELDS                                           \
+    ((1 << SELF_X) | (1 << SELF_Y) | (1 << SELF_VX) | (1 << SELF_VY) | \
+     (1 << SELF_LOCK_ID) | (1 << SELF_LOCK_DIST) |                  \
+     (1 << SELF_FUEL_SUM) | (1 << SELF_FUEL_MAX) |                  \
+     (1 << SELF_VIEW_WIDTH) | (1 << SELF_VIEW_HEIGHT))
+
+/* bits in the mask of PKT_SHIP_DELTA. */
+#define SHIP_DELTA_X 0x01
+#define SHIP_DELTA_Y 0x02
+#define SHIP_DELTA_DIR 0x04
+#define SHIP_DELTA_FLAGS 0x08
+
+typedef struct
+{
+    short id, x, y;
+    uint8_t dir, flags;
+} delta_ship_t;
+
+/*
+ * What one frame told the client, as it appeared on the wire.
+ */
+typedef struct
+{
+    long loops;                 /* frame number or 0 */
+    bool has_self;              /* self holds a self packet */
+    short self[NUM_SELF_FIELDS];
+    int num_ships;
+    delta_ship_t ships[DELTA_MAX_SHIPS];
+} delta_frame_t;
+
+#endif
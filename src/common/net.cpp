@@ -47,6 +47,32 @@
 
 int last_packet_of_frame;
 
+/*
+ * Datagrams written while a batch is open are copied here by
+ * Sockbuf_flush() and sent together by Sockbuf_batch_flush(),
+ * all datagrams for one socket in one system call if possible.
+ */
+typedef struct
+{
+    sockbuf_t *sbuf; /* NULL if the socket buffer went away */
+    sock_t sock;
+    int off;         /* offset of the datagram in batch.data */
+    int len;
+} batch_dgram_t;
+
+static struct
+{
+    bool active;
+    batch_dgram_t *dgrams;
+    sock_msg_t *msgs;
+    int num, max;
+    char *data;
+    int data_len, data_size;
+    sockbuf_batch_stats_t stats;
+} batch;
+
+static sockbuf_recv_stats_t recv_stats;
+
 int Sockbuf_init(sockbuf_t *sbuf, sock_t *sock, int size, int state)
 {
     if ((sbuf->buf = sbuf->ptr = XMALLOC(char, size)) == NULL)
@@ -65,6 +91,13 @@ int Sockbuf_init(sockbuf_t *sbuf, sock_t *sock, int size, int state)
 
 int Sockbuf_cleanup(sockbuf_t *sbuf)
 {
+    int i;
+
+    for (i = 0; i < batch.num; i++)
+    {
+        if (batch.dgrams[i].sbuf == sbuf)
+            batch.dgrams[i].sbuf = NULL;
+    }
     XFREE(sbuf->buf);
     sbuf->buf = sbuf->ptr = NULL;
     sbuf->size = sbuf->len = 0;
@@ -128,9 +161,179 @@ int Sockbuf_advance(sockbuf_t *sbuf, int len)
     return 0;
 }
 
+/*
+ * Send one datagram.  Errors other than a full socket buffer are
+ * retried a few times.  Returns the number of bytes sent, 0 if the
+ * datagram was dropped or -1 if the socket does not work.
+ */
+static int Sockbuf_send_dgram(sock_t *sock, char *buf, int buflen)
+{
+    int len, i = 0;
+
+    errno = 0;
+#if 0
+    if (randomMT() % 12 == 0)        /* artificial packet loss */
+        return buflen;
+#endif
+    while ((len = sock_write(sock, buf, buflen)) <= 0)
+    {
+        if (len == 0 || errno == EWOULDBLOCK || errno == EAGAIN)
+            return 0;
+        if (errno == EINTR)
+        {
+            errno = 0;
+            continue;
+        }
+#if 0
+        if (errno == ECONNREFUSED) {
+            error("Send refused");
+            return -1;
+        }
+#endif
+        if (++i > MAX_SOCKBUF_RETRIES)
+        {
+            error("Can't send on socket (%d,%d)", sock->fd, buflen);
+            return -1;
+        }
+        {
+            static int send_err;
+            if ((send_err++ & 0x3F) == 0)
+            {
+                error("send (%d)", i);
+            }
+        }
+        if (sock_get_error(sock) == -1)
+        {
+            error("sock_get_error send");
+            return -1;
+        }
+        errno = 0;
+    }
+    if (len != buflen)
+        warn("Can't write complete datagram (%d,%d)", len, buflen);
+    return len;
+}
+
+static int Sockbuf_batch_add(sockbuf_t *sbuf)
+{
+    batch_dgram_t *d;
+    int len = sbuf->len;
+
+    if (batch.num >= batch.max)
+    {
+        batch.max = batch.max ? 2 * batch.max : 64;
+        batch.dgrams = XREALLOC(batch_dgram_t, batch.dgrams, batch.max);
+        batch.msgs = XREALLOC(sock_msg_t, batch.msgs, batch.max);
+        if (batch.dgrams == NULL || batch.msgs == NULL)
+        {
+            error("No memory for datagram batch");
+            exit(1);
+        }
+    }
+    if (batch.data_len + len > batch.data_size)
+    {
+        while (batch.data_len + len > batch.data_size)
+            batch.data_size = batch.data_size ? 2 * batch.data_size : 64 * 1024;
+        if ((batch.data = XREALLOC(char, batch.data, batch.data_size)) == NULL)
+        {
+            error("No memory for datagram batch");
+            exit(1);
+        }
+    }
+    d = &batch.dgrams[batch.num++];
+    d->sbuf = sbuf;
+    d->sock = sbuf->sock;
+    d->off = batch.data_len;
+    d->len = len;
+    memcpy(batch.data + batch.data_len, sbuf->buf, len);
+    batch.data_len += len;
+    Sockbuf_clear(sbuf);
+    return len;
+}
+
+void Sockbuf_batch_begin(void)
+{
+    batch.active = true;
+}
+
+/*
+ * Send the datagrams collected since Sockbuf_batch_begin().
+ * Datagrams the kernel has no room for are dropped, as they
+ * would be by Sockbuf_flush().  Socket buffers which could not be
+ * written get SOCKBUF_ERROR set.  Returns how many there were.
+ */
+int Sockbuf_batch_flush(void)
+{
+    int i, j, k, n, calls, failed = 0;
+    batch_dgram_t *d;
+    sock_msg_t *m;
+
+    batch.active = false;
+    if (batch.num == 0)
+        return 0;
+
+    batch.stats.flushes++;
+    for (i = 0; i < batch.num; i = j)
+    {
+        /* the datagrams for one socket follow each other. */
+        for (j = i, n = 0; j < batch.num && batch.dgrams[j].sock.fd == batch.dgrams[i].sock.fd; j++)
+        {
+            d = &batch.dgrams[j];
+            if (d->sbuf == NULL)
+                continue;
+            m = &batch.msgs[n++];
+            m->buf = batch.data + d->off;
+            m->len = d->len;
+            m->count = 0;
+            m->error = 0;
+        }
+        if (n == 0)
+            continue;
+        calls = sock_write_many(&batch.dgrams[i].sock, batch.msgs, n);
+        batch.stats.syscalls += calls;
+        batch.stats.datagrams += n;
+        for (k = i, n = 0; k < j; k++)
+        {
+            d = &batch.dgrams[k];
+            if (d->sbuf == NULL)
+                continue;
+            m = &batch.msgs[n++];
+            if (m->count < 0)
+            {
+                if (m->error == EWOULDBLOCK || m->error == EAGAIN)
+                {
+                    batch.stats.dropped++;
+                    continue;
+                }
+                /* retry on its own like Sockbuf_flush() does. */
+                batch.stats.syscalls++;
+                m->count = Sockbuf_send_dgram(&d->sock, m->buf, m->len);
+                if (m->count == 0)
+                    batch.stats.dropped++;
+                else if (m->count < 0)
+                {
+                    SET_BIT(d->sbuf->state, SOCKBUF_ERROR);
+                    failed++;
+                }
+            }
+            else if (m->count != m->len)
+                warn("Can't write complete datagram (%d,%d)", m->count, m->len);
+        }
+    }
+    batch.num = 0;
+    batch.data_len = 0;
+
+    return failed;
+}
+
+void Sockbuf_batch_get_stats(sockbuf_batch_stats_t *stats)
+{
+    *stats = batch.stats;
+}
+
 int Sockbuf_flush(sockbuf_t *sbuf)
 {
-    int len, i;
+    int len;
 
     if (BIT(sbuf->state, SOCKBUF_WRITE) == 0)
     {
@@ -178,54 +381,9 @@ int Sockbuf_flush(sockbuf_t *sbuf)
 
     if (BIT(sbuf->state, SOCKBUF_DGRAM) != 0)
     {
-        errno = 0;
-        i = 0;
-#if 0
-        if (randomMT() % 12 == 0)        /* artificial packet loss */
-            len = sbuf->len;
-        else
-#endif
-        while ((len = sock_write(&sbuf->sock, sbuf->buf, sbuf->len)) <= 0)
-        {
-            if (len == 0 || errno == EWOULDBLOCK || errno == EAGAIN)
-            {
-                Sockbuf_clear(sbuf);
-                return 0;
-            }
-            if (errno == EINTR)
-            {
-                errno = 0;
-                continue;
-            }
-#if 0
-            if (errno == ECONNREFUSED) {
-                error("Send refused");
-                Sockbuf_clear(sbuf);
-                return -1;
-            }
-#endif
-            if (++i > MAX_SOCKBUF_RETRIES)
-            {
-                error("Can't send on socket (%d,%d)", sbuf->sock, sbuf->len);
-                Sockbuf_clear(sbuf);
-                return -1;
-            }
-            {
-                static int send_err;
-                if ((send_err++ & 0x3F) == 0)
-                {
-                    error("send (%d)", i);
-                }
-            }
-            if (sock_get_error(&sbuf->sock) == -1)
-            {
-                error("sock_get_error send");
-                return -1;
-            }
-            errno = 0;
-        }
-        if (len != sbuf->len)
-            warn("Can't write complete datagram (%d,%d)", len, sbuf->len);
+        if (batch.active)
+            return Sockbuf_batch_add(sbuf);
+        len = Sockbuf_send_dgram(&sbuf->sock, sbuf->buf, sbuf->len);
         Sockbuf_clear(sbuf);
     }
     else
@@ -371,6 +529,85 @@ int Sockbuf_read(sockbuf_t *sbuf)
     return sbuf->len;
 }
 
+/*
+ * Read up to num datagrams from a datagram socket buffer at once.
+ * Datagram k is received at offset k * slice of the buffer and its
+ * length put in lens[k], so they can be parsed where they are.
+ * Returns the number of datagrams read, 0 if there were none
+ * or -1 on error.
+ */
+int Sockbuf_read_many(sockbuf_t *sbuf, int slice, int *lens, int num)
+{
+    sock_msg_t msgs[SOCKBUF_MAX_READS];
+    int i, k, n;
+
+    if (BIT(sbuf->state, SOCKBUF_READ) == 0 || BIT(sbuf->state, SOCKBUF_DGRAM) == 0)
+    {
+        warn("No batched read from socket buffer (%d)", sbuf->state);
+        return -1;
+    }
+    if (BIT(sbuf->state, SOCKBUF_LOCK) != 0)
+        return 0;
+    if (num > SOCKBUF_MAX_READS)
+        num = SOCKBUF_MAX_READS;
+    if (num > sbuf->size / slice)
+        num = sbuf->size / slice;
+    for (k = 0; k < num; k++)
+    {
+        msgs[k].buf = sbuf->buf + k * slice;
+        msgs[k].len = slice;
+    }
+    sbuf->len = 0;
+    sbuf->ptr = sbuf->buf;
+
+    errno = 0;
+    i = 0;
+    while ((n = sock_read_many(&sbuf->sock, msgs, num)) <= 0)
+    {
+        if (n == 0)
+            break;
+        if (errno == EINTR)
+        {
+            errno = 0;
+            continue;
+        }
+        if (errno == EWOULDBLOCK || errno == EAGAIN)
+        {
+            n = 0;
+            break;
+        }
+        if (++i > MAX_SOCKBUF_RETRIES)
+        {
+            error("Can't recv on socket");
+            return -1;
+        }
+        if (sock_get_error(&sbuf->sock) == -1)
+        {
+            error("GetSocketError recv");
+            return -1;
+        }
+        errno = 0;
+    }
+    if (n == 0)
+    {
+        recv_stats.empty++;
+        return 0;
+    }
+    for (k = 0; k < n; k++)
+        lens[k] = msgs[k].count;
+    recv_stats.calls++;
+    recv_stats.datagrams += n;
+    if (n > recv_stats.max_batch)
+        recv_stats.max_batch = n;
+
+    return n;
+}
+
+void Sockbuf_recv_get_stats(sockbuf_recv_stats_t *stats)
+{
+    *stats = recv_stats;
+}
+
 int Sockbuf_copy(sockbuf_t *dest, sockbuf_t *src, int len)
 {
     if (len < dest->size - dest->len)
@@ -389,6 +626,48 @@ int Sockbuf_copy(sockbuf_t *dest, sockbuf_t *src, int len)
     return len;
 }
 
+/*
+ * Put a small signed number, like the difference between two shorts,
+ * in 1 to 3 bytes: 7 bits per byte with the high bit set if more
+ * follow, the sign in the lowest bit.  Returns the bytes used.
+ */
+int Packet_put_delta(char *buf, int value)
+{
+    unsigned z = ((unsigned)value << 1) ^ (unsigned)(value >> 31);
+    int n = 0;
+
+    while (z >= 0x80 && n < 2)
+    {
+        buf[n++] = (char)(z | 0x80);
+        z >>= 7;
+    }
+    buf[n++] = (char)z;
+    return n;
+}
+
+/*
+ * Get a number written by Packet_put_delta().
+ * Returns the bytes used or 0 if buf ends too soon.
+ */
+int Packet_get_delta(const char *buf, const char *end, int *value)
+{
+    unsigned z = 0;
+    int n = 0, c;
+
+    do
+    {
+        if (buf + n >= end)
+            return 0;
+        c = (uint8_t)buf[n];
+        z |= (unsigned)(c & 0x7F) << (7 * n);
+        n++;
+    } while ((c & 0x80) && n < 3);
+    if (n == 3)
+        z |= (unsigned)(c & 0x80) << 14;
+    *value = (int)(z >> 1) ^ -(int)(z & 1);
+    return n;
+}
+
 int Packet_printf(sockbuf_t *sbuf, const char *fmt, ...)
 {
 #define PRINTF_FMT 1
@@ -578,6 +857,81 @@ int Packet_printf(sockbuf_t *sbuf, const char *fmt, ...)
     return count;
 }
 
+/*
+ * Write a string for Packet_write(), the same way as Packet_printf().
+ */
+char *Packet_write_string(char *buf, char *end, const char *str, int max_str_size)
+{
+    char *stop;
+
+    if (buf + max_str_size >= end)
+        stop = end;
+    else
+        stop = buf + max_str_size;
+    /* Send the nul byte too */
+    do
+    {
+        if (buf >= stop)
+            break;
+    } while ((*buf++ = *str++) != '\0');
+    if (buf > stop)
+        return NULL;
+
+    return buf;
+}
+
+/*
+ * Make sure that need bytes can be read for Packet_read().
+ * Returns 0 if they can, 3 if the packet is not complete yet
+ * and 2 on a read error, like the failure codes of Packet_scanf().
+ */
+int Packet_read_more(sockbuf_t *sbuf, int need)
+{
+    if (&sbuf->buf[sbuf->len] >= &sbuf->ptr[need])
+        return 0;
+    if (BIT(sbuf->state, SOCKBUF_DGRAM | SOCKBUF_LOCK) != 0)
+        return 3;
+    if (Sockbuf_read(sbuf) == -1)
+        return 2;
+    if (&sbuf->buf[sbuf->len] < &sbuf->ptr[need])
+        return 3;
+
+    return 0;
+}
+
+/*
+ * Read a string at offset *j for Packet_read(), the same way
+ * as Packet_scanf().
+ */
+int Packet_read_string(sockbuf_t *sbuf, int *j, char *str, int max_str_size)
+{
+    int k = 0,
+        failure = 0;
+
+    for (;;)
+    {
+        if ((failure = Packet_read_more(sbuf, *j + 1)) != 0)
+            break;
+        if ((str[k++] = sbuf->ptr[(*j)++]) == '\0')
+            break;
+        else if (k >= max_str_size)
+        {
+            warn("String overflow while scanning (%d,%d)",
+                 k, max_str_size);
+
+            if (BIT(sbuf->state, SOCKBUF_LOCK) != 0)
+                failure = 2;
+            else
+                failure = 3;
+            break;
+        }
+    }
+    if (failure != 0)
+        strcpy(str, "ErRoR");
+
+    return failure;
+}
+
 int Packet_scanf(sockbuf_t *sbuf, const char *fmt, ...)
 {
     int i,
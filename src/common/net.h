@@ -25,6 +25,7 @@
 #define NET_H
 
 #include "socklib.h"
+#include "const.h"
 
 #define MIN_SOCKBUF_SIZE 1024
 #define MAX_SOCKBUF_SIZE (50 * 1024)
@@ -55,6 +56,11 @@
  */
 #define MAX_SOCKBUF_RETRIES 2
 
+/*
+ * Maximum number of datagrams read by one Sockbuf_read_many().
+ */
+#define SOCKBUF_MAX_READS 16
+
 /*
  * A buffer to reduce the number of system calls made and to reduce
  * the number of network packets.
@@ -69,6 +75,30 @@ typedef struct
     int state;   /* read/write/locked/error status flags */
 } sockbuf_t;
 
+/*
+ * Counters for datagrams sent in batches by Sockbuf_batch_flush().
+ * datagrams - syscalls is the number of system calls saved.
+ */
+typedef struct
+{
+    long flushes;   /* batches sent */
+    long datagrams; /* datagrams in them */
+    long syscalls;  /* system calls used to send them */
+    long dropped;   /* datagrams the kernel had no room for */
+} sockbuf_batch_stats_t;
+
+/*
+ * Counters for Sockbuf_read_many(), each call is one system call
+ * and normally one wakeup of the server for a readable socket.
+ */
+typedef struct
+{
+    long calls;     /* calls which found input */
+    long empty;     /* calls which found nothing */
+    long datagrams; /* datagrams received */
+    int max_batch;  /* most datagrams in one call */
+} sockbuf_recv_stats_t;
+
 extern int last_packet_of_frame;
 
 int Sockbuf_init(sockbuf_t *sbuf, sock_t *sock, int size, int state);
@@ -78,9 +108,289 @@ int Sockbuf_advance(sockbuf_t *sbuf, int len);
 int Sockbuf_flush(sockbuf_t *sbuf);
 int Sockbuf_write(sockbuf_t *sbuf, char *buf, int len);
 int Sockbuf_read(sockbuf_t *sbuf);
+int Sockbuf_read_many(sockbuf_t *sbuf, int slice, int *lens, int num);
+void Sockbuf_recv_get_stats(sockbuf_recv_stats_t *stats);
 int Sockbuf_copy(sockbuf_t *dest, sockbuf_t *src, int len);
+void Sockbuf_batch_begin(void);
+int Sockbuf_batch_flush(void);
+void Sockbuf_batch_get_stats(sockbuf_batch_stats_t *stats);
 
 int Packet_printf(sockbuf_t *, const char *fmt, ...);
 int Packet_scanf(sockbuf_t *, const char *fmt, ...);
+int Packet_read_more(sockbuf_t *sbuf, int need);
+char *Packet_write_string(char *buf, char *end, const char *str, int max_str_size);
+int Packet_read_string(sockbuf_t *sbuf, int *j, char *str, int max_str_size);
+int Packet_put_delta(char *buf, int value);
+int Packet_get_delta(const char *buf, const char *end, int *value);
+
+/*
+ * Typed packet writing and reading.
+ *
+ * Packet_write<pkt_c, pkt_hd>(sbuf, PKT_EYES, id) puts exactly the
+ * same bytes in sbuf as Packet_printf(sbuf, "%c%hd", PKT_EYES, id),
+ * but the layout of the packet is fixed when compiling: there is no
+ * format string to parse and no va_list to walk, the arguments are
+ * checked by the compiler and for a packet without strings the room
+ * left in the buffer is checked once.  Packet_read<>() does the same
+ * for Packet_scanf() and takes pointers to the destinations.
+ *
+ * Each field type below corresponds to one Packet_printf() format.
+ */
+struct pkt_c /* %c */
+{
+    typedef int value_type;
+    static const bool fixed = true;
+    static const int size = 1;
+    static char *put(char *buf, int val)
+    {
+        *buf++ = val;
+        return buf;
+    }
+    template <typename T> static void get(const char *p, T *val)
+    {
+        static_assert(sizeof(T) == sizeof(char), "%c needs a char");
+        *val = p[0];
+    }
+};
+
+struct pkt_d /* %d */
+{
+    typedef int value_type;
+    static const bool fixed = true;
+    static const int size = 4;
+    static char *put(char *buf, int val)
+    {
+        *buf++ = val >> 24;
+        *buf++ = val >> 16;
+        *buf++ = val >> 8;
+        *buf++ = val;
+        return buf;
+    }
+    template <typename T> static void get(const char *p, T *val)
+    {
+        static_assert(sizeof(T) == sizeof(int), "%d needs an int");
+        *val = (p[0] << 24) | ((p[1] & 0xFF) << 16) | ((p[2] & 0xFF) << 8) | (p[3] & 0xFF);
+    }
+};
+
+struct pkt_u /* %u */
+{
+    typedef unsigned value_type;
+    static const bool fixed = true;
+    static const int size = 4;
+    static char *put(char *buf, unsigned val)
+    {
+        *buf++ = val >> 24;
+        *buf++ = val >> 16;
+        *buf++ = val >> 8;
+        *buf++ = val;
+        return buf;
+    }
+    template <typename T> static void get(const char *p, T *val)
+    {
+        static_assert(sizeof(T) == sizeof(unsigned), "%u needs an unsigned");
+        *val = ((p[0] & 0xFF) << 24) | ((p[1] & 0xFF) << 16) | ((p[2] & 0xFF) << 8) | (p[3] & 0xFF);
+    }
+};
+
+struct pkt_hd /* %hd */
+{
+    typedef int value_type;
+    static const bool fixed = true;
+    static const int size = 2;
+    static char *put(char *buf, int val)
+    {
+        short sval = val;
+
+        *buf++ = sval >> 8;
+        *buf++ = (char)sval;
+        return buf;
+    }
+    template <typename T> static void get(const char *p, T *val)
+    {
+        static_assert(sizeof(T) == sizeof(short), "%hd needs a short");
+        *val = (p[0] << 8) | (p[1] & 0xFF);
+    }
+};
+
+struct pkt_hu /* %hu */
+{
+    typedef unsigned value_type;
+    static const bool fixed = true;
+    static const int size = 2;
+    static char *put(char *buf, unsigned val)
+    {
+        unsigned short usval = val;
+
+        *buf++ = usval >> 8;
+        *buf++ = (char)usval;
+        return buf;
+    }
+    template <typename T> static void get(const char *p, T *val)
+    {
+        static_assert(sizeof(T) == sizeof(short), "%hu needs a short");
+        *val = ((p[0] & 0xFF) << 8) | (p[1] & 0xFF);
+    }
+};
+
+struct pkt_ld /* %ld */
+{
+    typedef long value_type;
+    static const bool fixed = true;
+    static const int size = 4;
+    static char *put(char *buf, long val)
+    {
+        *buf++ = (char)(val >> 24);
+        *buf++ = (char)(val >> 16);
+        *buf++ = (char)(val >> 8);
+        *buf++ = (char)val;
+        return buf;
+    }
+    template <typename T> static void get(const char *p, T *val)
+    {
+        static_assert(sizeof(T) == sizeof(long), "%ld needs a long");
+        *val = (p[0] << 24) | ((p[1] & 0xFF) << 16) | ((p[2] & 0xFF) << 8) | (p[3] & 0xFF);
+    }
+};
+
+struct pkt_lu /* %lu */
+{
+    typedef unsigned long value_type;
+    static const bool fixed = true;
+    static const int size = 4;
+    static char *put(char *buf, unsigned long val)
+    {
+        *buf++ = (char)(val >> 24);
+        *buf++ = (char)(val >> 16);
+        *buf++ = (char)(val >> 8);
+        *buf++ = (char)val;
+        return buf;
+    }
+    template <typename T> static void get(const char *p, T *val)
+    {
+        static_assert(sizeof(T) == sizeof(long), "%lu needs a long");
+        /* Sign extended like in Packet_scanf(). */
+        *val = ((p[0] & 0xFF) << 24) | ((p[1] & 0xFF) << 16) | ((p[2] & 0xFF) << 8) | (p[3] & 0xFF);
+    }
+};
+
+struct pkt_s /* %s, small strings */
+{
+    typedef const char *value_type;
+    static const bool fixed = false;
+    static const int size = 0;
+    static const int max_size = MAX_CHARS;
+};
+
+struct pkt_S /* %S, big strings */
+{
+    typedef const char *value_type;
+    static const bool fixed = false;
+    static const int size = 0;
+    static const int max_size = MSG_LEN;
+};
+
+/*
+ * Bounds checked versions for packets with strings in them,
+ * where the position of a field is only known when writing.
+ * They return NULL when the field does not fit.
+ */
+template <typename F>
+inline char *Packet_put_checked(char *buf, char *end, typename F::value_type val)
+{
+    if constexpr (F::fixed)
+    {
+        if (buf + F::size >= end)
+            return NULL;
+        return F::put(buf, val);
+    }
+    else
+        return Packet_write_string(buf, end, val, F::max_size);
+}
+
+template <typename F, typename T>
+inline int Packet_get_checked(sockbuf_t *sbuf, int *j, T *val)
+{
+    if constexpr (F::fixed)
+    {
+        int failure;
+
+        if (&sbuf->buf[sbuf->len] < &sbuf->ptr[*j + F::size] && (failure = Packet_read_more(sbuf, *j + F::size)) != 0)
+            return failure;
+        F::get(sbuf->ptr + *j, val);
+        *j += F::size;
+        return 0;
+    }
+    else
+    {
+        static_assert(sizeof(T) == sizeof(char), "strings need a char buffer");
+        return Packet_read_string(sbuf, j, val, F::max_size);
+    }
+}
+
+/*
+ * Returns the number of bytes written, 0 if a datagram buffer
+ * is full or -1 if another buffer is full.
+ * Like Packet_printf() nothing is written unless the whole packet fits.
+ */
+template <typename... F>
+int Packet_write(sockbuf_t *sbuf, typename F::value_type... vals)
+{
+    char *start = sbuf->buf + sbuf->len,
+         *end = sbuf->buf + sbuf->size,
+         *buf = start;
+
+    /* Room for the terminating packet, see Packet_printf(). */
+    if (last_packet_of_frame != 1)
+        end -= SOCKBUF_WRITE_SPARE;
+
+    if constexpr ((F::fixed && ...))
+    {
+        if (buf + (F::size + ...) >= end)
+            return (sbuf->state & SOCKBUF_DGRAM) ? 0 : -1;
+        ((buf = F::put(buf, vals)), ...);
+    }
+    else
+    {
+        if (!(((buf = Packet_put_checked<F>(buf, end, vals)) != NULL) && ...))
+            return (sbuf->state & SOCKBUF_DGRAM) ? 0 : -1;
+    }
+    sbuf->len += buf - start;
+
+    return buf - start;
+}
+
+/*
+ * Returns the number of fields read, 0 if the packet is not complete
+ * yet, or -1 on error.  The read position only moves on success.
+ */
+template <typename... F, typename... T>
+int Packet_read(sockbuf_t *sbuf, T *...vals)
+{
+    int j = 0,
+        failure = 0;
+
+    static_assert(sizeof...(F) == sizeof...(T), "one destination per field");
+
+    if constexpr ((F::fixed && ...))
+    {
+        const int size = (F::size + ...);
+
+        if (&sbuf->buf[sbuf->len] < &sbuf->ptr[size])
+            failure = Packet_read_more(sbuf, size);
+        if (failure == 0)
+            ((F::get(sbuf->ptr + j, vals), j += F::size), ...);
+    }
+    else
+        (void)(((failure = Packet_get_checked<F>(sbuf, &j, vals)) == 0) && ...);
+
+    if (failure == 3)
+        return 0;
+    if (failure != 0)
+        return -1;
+    sbuf->ptr += j;
+
+    return sizeof...(F);
+}
 
 #endif
@@ -100,6 +100,7 @@
  * 4.4.0.1: fast radar packet
  * 4.5.0.0: new team score packet; score packet made larger to send decimals
  * 4.5.0.1: temporary wormholes
+ * 4.5.0.2: delta coded self and ship packets, frame acknowledgements
 
  * Polygon branch
  * 4.F.0.9: 4.3.0.0 + xp2 map format
@@ -110,7 +111,7 @@
  * 4.F.1.4: balls use polygon styles
  * 4.F.1.5: Possibility to change polygon styles.
  */
-#define MAGIC 0x4501F4ED
+#define MAGIC 0x4502F4ED
 #define POLYGON_VERSION 0x4F15
 #define OLD_VERSION 0x4501
 // #define MAGIC 0x4F15F4ED
@@ -145,7 +146,7 @@
  * there is a separate "old" range of allowed servers.
  */
 #define MIN_OLD_SERVER_VERSION 0x4203
-#define MAX_OLD_SERVER_VERSION 0x4501
+#define MAX_OLD_SERVER_VERSION 0x4502
 /* Which old-style (non-polygon) protocol version we support. */
 #define COMPATIBILITY_MAGIC 0x4501F4ED
 
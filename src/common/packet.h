@@ -108,10 +108,10 @@
 #define PKT_TEAM 61
 #define PKT_POLYSTYLE 62
 #define PKT_ACK_POLYSTYLE 63
-#define PKT_NOT_USED_64 64
-#define PKT_NOT_USED_65 65
-#define PKT_NOT_USED_66 66
-#define PKT_NOT_USED_67 67
+#define PKT_DELTA_BASE 64 /* frame self/ship deltas refer to */
+#define PKT_SELF_DELTA 65 /* changed fields of PKT_SELF */
+#define PKT_SHIP_DELTA 66 /* changed fields of PKT_SHIP */
+#define PKT_ACK_FRAME 67  /* client has a frame */
 #define PKT_MODIFIERS 68
 #define PKT_FASTSHOT 69 /* replaces SHOT/TEAMSHOT */
 
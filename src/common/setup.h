@@ -43,6 +43,17 @@
 #define SETUP_MAP_ORDER_XY 1
 #define SETUP_MAP_ORDER_YX 2
 #define SETUP_MAP_UNCOMPRESSED 3
+#define SETUP_MAP_ZLIB 4
+#define SETUP_MAP_ZSTD 5
+
+/*
+ * Map transfer methods a client can decode, one bit per map_order
+ * value above.  Sent by the client at the end of its verify packet;
+ * old clients send none and get the run length encoded map.
+ */
+#define SETUP_MAP_METHOD(order) (1 << (order))
+#define SETUP_MAP_METHODS_OLD \
+    (SETUP_MAP_METHOD(SETUP_MAP_ORDER_XY) | SETUP_MAP_METHOD(SETUP_MAP_UNCOMPRESSED))
 
 /*
  * Definitions for the map layout which permit a compact definition
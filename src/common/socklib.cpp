@@ -61,6 +61,9 @@
 
 #define SOCK_GETHOST_TIMEOUT 6
 
+/* datagrams handed to one sendmmsg() or recvmmsg() call. */
+#define SOCK_MAX_MSGS 64
+
 static jmp_buf env;
 
 static struct hostent *sock_get_host_by_name(const char *name);
@@ -521,6 +524,127 @@ int sock_write(sock_t *sock, char *buf, int len)
     return count;
 }
 
+/*
+ * Send num datagrams on one socket.  Where sendmmsg() is available
+ * they go out in as few system calls as possible, otherwise one at
+ * a time.  A datagram which fails does not stop the ones after it.
+ * Returns the number of system calls made.
+ */
+int sock_write_many(sock_t *sock, sock_msg_t *msgs, int num)
+{
+    int i = 0, calls = 0;
+
+#ifdef HAVE_SENDMMSG
+    static bool no_sendmmsg;
+    struct mmsghdr hdr[SOCK_MAX_MSGS];
+    struct iovec iov[SOCK_MAX_MSGS];
+    int k, n, todo;
+
+    while (i < num && !no_sendmmsg)
+    {
+        todo = (num - i < SOCK_MAX_MSGS) ? num - i : SOCK_MAX_MSGS;
+        memset(hdr, 0, todo * sizeof(hdr[0]));
+        for (k = 0; k < todo; k++)
+        {
+            iov[k].iov_base = msgs[i + k].buf;
+            iov[k].iov_len = msgs[i + k].len;
+            hdr[k].msg_hdr.msg_iov = &iov[k];
+            hdr[k].msg_hdr.msg_iovlen = 1;
+        }
+        n = sendmmsg(sock->fd, hdr, todo, 0);
+        if (n < 0 && errno == ENOSYS)
+        {
+            /* old kernel, use the fallback from now on. */
+            no_sendmmsg = true;
+            break;
+        }
+        calls++;
+        if (n < 0)
+        {
+            /*
+             * sendmmsg() only reports an error for the first
+             * datagram, the others are tried again.
+             */
+            msgs[i].count = -1;
+            msgs[i].error = errno;
+            sock_set_error(sock, errno, SOCK_CALL_IO, __LINE__);
+            i++;
+            continue;
+        }
+        for (k = 0; k < n; k++)
+        {
+            msgs[i + k].count = hdr[k].msg_len;
+            msgs[i + k].error = 0;
+        }
+        i += n;
+    }
+#endif
+
+    for (; i < num; i++)
+    {
+        msgs[i].count = send(sock->fd, msgs[i].buf, msgs[i].len, 0);
+        msgs[i].error = (msgs[i].count < 0) ? errno : 0;
+        if (msgs[i].count < 0)
+            sock_set_error(sock, errno, SOCK_CALL_IO, __LINE__);
+        calls++;
+    }
+
+    return calls;
+}
+
+/*
+ * Receive up to num datagrams, with one recvmmsg() call where it is
+ * available and otherwise just one datagram with recv().
+ * Returns the number of datagrams received, or what sock_read()
+ * would have returned if there were none.
+ */
+int sock_read_many(sock_t *sock, sock_msg_t *msgs, int num)
+{
+#ifdef HAVE_RECVMMSG
+    static bool no_recvmmsg;
+    struct mmsghdr hdr[SOCK_MAX_MSGS];
+    struct iovec iov[SOCK_MAX_MSGS];
+    int k, n;
+
+    if (num > SOCK_MAX_MSGS)
+        num = SOCK_MAX_MSGS;
+    if (!no_recvmmsg)
+    {
+        memset(hdr, 0, num * sizeof(hdr[0]));
+        for (k = 0; k < num; k++)
+        {
+            iov[k].iov_base = msgs[k].buf;
+            iov[k].iov_len = msgs[k].len;
+            hdr[k].msg_hdr.msg_iov = &iov[k];
+            hdr[k].msg_hdr.msg_iovlen = 1;
+        }
+        n = recvmmsg(sock->fd, hdr, num, MSG_DONTWAIT, NULL);
+        if (n >= 0)
+        {
+            for (k = 0; k < n; k++)
+            {
+                msgs[k].count = hdr[k].msg_len;
+                msgs[k].error = 0;
+            }
+            return n;
+        }
+        if (errno != ENOSYS)
+        {
+            sock_set_error(sock, errno, SOCK_CALL_IO, __LINE__);
+            return -1;
+        }
+        /* old kernel, use the fallback from now on. */
+        no_recvmmsg = true;
+    }
+#endif
+
+    if (num < 1)
+        return 0;
+    msgs[0].count = sock_read(sock, msgs[0].buf, msgs[0].len);
+    msgs[0].error = (msgs[0].count < 0) ? errno : 0;
+    return (msgs[0].count <= 0) ? msgs[0].count : 1;
+}
+
 char *sock_get_addr_by_name(const char *name)
 {
     struct hostent *hp;
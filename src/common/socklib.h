@@ -77,6 +77,19 @@ typedef struct sock_s
     char *hostname;
 } sock_t;
 
+/*
+ * One datagram for sock_write_many() or sock_read_many().
+ * count is what sock_write() or sock_read() would have returned
+ * for it and error the errno if count is negative.
+ */
+typedef struct sock_msg_s
+{
+    char *buf;
+    int len;
+    int count;
+    int error;
+} sock_msg_t;
+
 #if !defined(select) && defined(__linux__)
 #define select(N, R, W, E, T) select((N), \
                                      (fd_set *)(R), (fd_set *)(W), (fd_set *)(E), (T))
@@ -96,6 +109,8 @@ int sock_read(sock_t *sock, char *buf, int len);
 int sock_receive_any(sock_t *sock, char *buf, int len);
 int sock_send_dest(sock_t *sock, char *host, int port, char *buf, int len);
 int sock_write(sock_t *sock, char *buf, int len);
+int sock_write_many(sock_t *sock, sock_msg_t *msgs, int num);
+int sock_read_many(sock_t *sock, sock_msg_t *msgs, int num);
 char *sock_get_addr_by_name(const char *name);
 unsigned long sock_get_inet_by_addr(char *dotaddr);
 void sock_get_local_hostname(char *name, unsigned size,
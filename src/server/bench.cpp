@@ -0,0 +1,261 @@
+/*
+ * XPilot, a multiplayer gravity war game.  Copyright (C) 1991-2001 by
+ *
+ *      Bjørn Stabell
+ *      Ken Ronny Schouten
+ *      Bert Gijsbers
+ *      Dick Balaska
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+
+#include "server.h"
+
+#define SERVER
+#include "xpconfig.h"
+#include "serverconst.h"
+#include "global.h"
+#include "bit.h"
+#include "keys.h"
+#include "netserver.h"
+#include "portability.h"
+#include "xperror.h"
+#include "threadpool.h"
+#include "profile.h"
+#include "walls.h"
+
+/*
+ * A headless server for measuring the cost of a game tick.
+ * It loads a map, fills it with robots and with clients that
+ * have no socket, and runs a fixed number of ticks as fast as
+ * it can.  The random generator is seeded with a fixed value,
+ * so two runs with the same arguments play the same game and
+ * their timings can be compared.
+ *
+ * Usage: xpilot-cpp-bench [-ticks K] [-clients C] [-seed S]
+ *                         [server options]
+ * The number of robots is given with the normal -robots option.
+ */
+
+#define DEF_BENCH_TICKS 2000
+#define DEF_BENCH_CLIENTS 4
+#define DEF_BENCH_SEED 1
+
+static int bench_ticks = DEF_BENCH_TICKS;
+static int bench_clients = DEF_BENCH_CLIENTS;
+static unsigned bench_seed = DEF_BENCH_SEED;
+
+/*
+ * Take out the options of the benchmark itself and
+ * leave the others for the normal option parser.
+ */
+static int Bench_args(int argc, char **argv)
+{
+    int i, n = 1;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (i + 1 < argc && !strcmp(argv[i], "-ticks"))
+            bench_ticks = atoi(argv[++i]);
+        else if (i + 1 < argc && !strcmp(argv[i], "-clients"))
+            bench_clients = atoi(argv[++i]);
+        else if (i + 1 < argc && !strcmp(argv[i], "-seed"))
+            bench_seed = (unsigned)strtoul(argv[++i], NULL, 0);
+        else
+            argv[n++] = argv[i];
+    }
+    argv[n] = NULL;
+
+    return n;
+}
+
+/*
+ * Scripted keyboard input for the fake clients: each of them
+ * flies in loops, turning both ways and firing now and then.
+ * The pattern only depends on the tick and the player index.
+ */
+static void Bench_input(void)
+{
+    int i, t;
+    player_t *pl;
+
+    for (i = 0; i < NumPlayers; i++)
+    {
+        pl = PlayersArray[i];
+        if (pl->conn == NULL || !pl->conn->fake)
+            continue;
+        t = (int)((main_loops + i * 17) % 64);
+        memset(pl->last_keyv, 0, sizeof(pl->last_keyv));
+        if (t < 40)
+            BITV_SET(pl->last_keyv, KEY_THRUST);
+        if (t >= 8 && t < 20)
+            BITV_SET(pl->last_keyv, KEY_TURN_LEFT);
+        else if (t >= 36 && t < 44)
+            BITV_SET(pl->last_keyv, KEY_TURN_RIGHT);
+        if ((t & 7) == 0)
+            BITV_SET(pl->last_keyv, KEY_FIRE_SHOT);
+        Handle_keyboard(i);
+    }
+}
+
+static void Bench_report(double seconds)
+{
+    int i, num_conns = 0;
+    long bytes = 0;
+    player_t *pl;
+    profile_stats_t stats;
+    pool_stats_t pool;
+    robot_lod_stats_t lod;
+    move_stats_t moves;
+
+    xpprintf("%d ticks in %.3f s: %.1f ticks/s\n",
+             bench_ticks, seconds,
+             seconds > 0 ? bench_ticks / seconds : 0.0);
+    xpprintf("%d players, %d robots, %d fake clients\n",
+             NumPlayers, NumRobots, bench_clients);
+
+    xpprintf("%-10s %8s %10s %10s %10s %10s\n",
+             "phase", "count", "mean_us", "p50_us", "p99_us", "max_us");
+    for (i = 0; i < NUM_PROFILE_PHASES; i++)
+    {
+        Profile_get_stats(i, &stats);
+        if (stats.count == 0)
+            continue;
+        xpprintf("%-10s %8ld %10.1f %10.1f %10.1f %10.1f\n",
+                 Profile_phase_name(i), stats.count,
+                 stats.mean, stats.p50, stats.p99, stats.max);
+    }
+
+    for (i = 0; i < NUM_POOLS; i++)
+    {
+        Pool_get_stats(i, &pool);
+        xpprintf("pool %-12s %4d of %4d used at most, %ld allocations\n",
+                 pool.name, pool.high_water, pool.capacity, pool.allocs);
+    }
+
+    Robot_get_lod_stats(&lod);
+    xpprintf("robot turns: %ld full, %ld reduced, %ld skipped, %ld deferred\n",
+             lod.full, lod.reduced, lod.skipped, lod.deferred);
+
+    Move_get_stats(&moves);
+    xpprintf("fast moves: objects %.1f%% of %ld, ships %.1f%% of %ld, "
+             "segments %.1f%% of %ld\n",
+             moves.object_moves ? 100.0 * moves.object_fast / moves.object_moves : 0.0,
+             moves.object_moves,
+             moves.player_moves ? 100.0 * moves.player_fast / moves.player_moves : 0.0,
+             moves.player_moves,
+             moves.segments ? 100.0 * moves.segments_fast / moves.segments : 0.0,
+             moves.segments);
+
+    for (i = 0; i < NumPlayers; i++)
+    {
+        pl = PlayersArray[i];
+        if (pl->conn == NULL || !pl->conn->fake)
+            continue;
+        xpprintf("client %-16s %10ld bytes %8.1f bytes/tick\n",
+                 pl->name, pl->conn->bytes_sent,
+                 (double)pl->conn->bytes_sent / bench_ticks);
+        bytes += pl->conn->bytes_sent;
+        num_conns++;
+    }
+    if (num_conns > 0)
+        xpprintf("average %.1f bytes/tick per client\n",
+                 (double)bytes / num_conns / bench_ticks);
+}
+
+int main(int argc, char **argv)
+{
+    int i, tick;
+    uint64_t start, tick_start, prof;
+    char nick[MAX_CHARS];
+
+    setvbuf(stdout, NULL, _IOLBF, BUFSIZ);
+    setvbuf(stderr, NULL, _IOLBF, BUFSIZ);
+
+    init_error(argv[0]);
+
+    argc = Bench_args(argc, argv);
+    if (bench_ticks <= 0 || bench_clients < 0)
+    {
+        error("Bad -ticks or -clients value");
+        exit(1);
+    }
+
+    seedMT(bench_seed);
+
+    if (Parser(argc, argv) == false)
+        exit(1);
+
+    Game_init();
+    Get_login_name(Server.owner, sizeof Server.owner);
+    if (Setup_net_server() == -1)
+        exit(1);
+
+    /*
+     * Keep the number of robots fixed for the whole run.  Only add
+     * robots the server itself would let in, on team maps
+     * restrictRobots may leave fewer bases than asked for.
+     */
+    options.robotsLeave = 0;
+    options.minRobots = options.maxRobots = MIN(options.maxRobots,
+                                                world->NumBases - bench_clients);
+    for (i = 0; i < options.minRobots && Robot_may_join(); i++)
+        Robot_create();
+    options.minRobots = options.maxRobots = NumRobots;
+
+    for (i = 0; i < bench_clients; i++)
+    {
+        snprintf(nick, sizeof(nick), "bench%d", i);
+        if (Setup_fake_connection(nick) == -1)
+        {
+            error("Cannot log in fake client %s", nick);
+            exit(1);
+        }
+    }
+    options.maxRobots += bench_clients;
+
+    options.profile = true;
+    Profile_reset();
+
+    start = Profile_now();
+    for (tick = 0; tick < bench_ticks; tick++)
+    {
+        tick_start = Profile_start();
+        main_loops++;
+
+        prof = Profile_start();
+        Bench_input();
+        Profile_stop(PROFILE_INPUT, prof);
+
+        Update_objects();
+
+        prof = Profile_start();
+        Frame_update();
+        Profile_stop(PROFILE_FRAMES, prof);
+
+        Profile_stop(PROFILE_TICK, tick_start);
+    }
+
+    Bench_report((Profile_now() - start) / 1e9);
+
+    Threadpool_cleanup();
+
+    return 0;
+}
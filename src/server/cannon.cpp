@@ -27,6 +27,7 @@
 #include <cstdio>
 #include <cmath>
 #include <climits>
+#include <vector>
 
 #include "const.h"
 #include "randommt.h"
@@ -42,6 +43,7 @@
 #include "cannon.h"
 #include "saudio.h"
 #include "xpmath.h"
+#include "mapindex.h"
 
 #ifdef SOUND
 #define IFSOUND(__x) __x
@@ -56,6 +58,17 @@ static int Cannon_in_danger(int ind);
 static int Cannon_select_defense(int ind);
 static void Cannon_defend(int ind, int defense);
 
+/*
+ * The players each cannon may see this frame, in player order.
+ * watch_players[watch_start[c]] up to watch_players[watch_start[c + 1]]
+ * belong to cannon c.  They are found through the cannon index the
+ * first time a cannon aims in a frame; players do not move while the
+ * cannons are updated, so the lists hold for the rest of the frame.
+ */
+static std::vector<int> watch_start;
+static std::vector<int> watch_players;
+static long watch_loops = -1;
+
 /* the items that are useful to cannons.
    these are the items that cannon get 'for free' once in a while.
    cannons can get other items, but only by picking them up or
@@ -297,6 +310,52 @@ static int Cannon_select_weapon(int ind)
     return CW_SHOT;
 }
 
+static void Cannon_watch_update(void)
+{
+    static std::vector<int> pair_cannon, pair_player;
+    int i, k, num, range, max_sensor;
+    int *list;
+    size_t p;
+
+    max_sensor = 0;
+    for (i = 0; i < world->NumCannons; i++)
+        max_sensor = MAX(max_sensor, world->cannon[i].item[ITEM_SENSOR]);
+    range = (int)((CANNON_DISTANCE + 2 * max_sensor * BLOCK_SZ + 1) * CLICK);
+
+    pair_cannon.clear();
+    pair_player.clear();
+    watch_start.assign(world->NumCannons + 1, 0);
+    for (i = 0; i < NumPlayers; i++)
+    {
+        player_t *pl = PlayersArray[i];
+
+        /* Cannon_aim() skips these too. */
+        if (BIT(pl->status, PLAYING | GAME_OVER | PAUSE | KILLED) != PLAYING)
+            continue;
+
+        num = Map_index_find(MAP_INDEX_CANNON, pl->pos.cx, pl->pos.cy,
+                             range, &list);
+        for (k = 0; k < num; k++)
+        {
+            pair_cannon.push_back(list[k]);
+            pair_player.push_back(i);
+            watch_start[list[k] + 1]++;
+        }
+    }
+
+    for (i = 0; i < world->NumCannons; i++)
+        watch_start[i + 1] += watch_start[i];
+    watch_players.resize(pair_player.size());
+    /* walk the pairs backwards so each list stays in player order. */
+    for (p = pair_player.size(); p-- > 0;)
+        watch_players[--watch_start[pair_cannon[p] + 1]] = pair_player[p];
+    for (i = 0; i < world->NumCannons; i++)
+        watch_start[i] = watch_start[i + 1];
+    watch_start[world->NumCannons] = (int)pair_player.size();
+
+    watch_loops = frame_loops;
+}
+
 /* determines in which direction to fire.
    mode 0 fires straight ahead.
    mode 1 in a random direction.
@@ -320,7 +379,7 @@ static void Cannon_aim(int ind, int weapon, int *target, int *dir)
     int cpy = (int)c->pix_pos.y;
     int visualrange = (int)(CANNON_DISTANCE + 2 * c->item[ITEM_SENSOR] * BLOCK_SZ);
     bool found = false, ready = false;
-    int closest = range, i;
+    int closest = range, i, k;
     int ddir;
 
     switch (weapon)
@@ -362,11 +421,17 @@ static void Cannon_aim(int ind, int weapon, int *target, int *dir)
         break;
     }
 
-    for (i = 0; i < NumPlayers && !ready; i++)
+    if (watch_loops != frame_loops)
+        Cannon_watch_update();
+
+    for (k = watch_start[ind]; k < watch_start[ind + 1] && !ready; k++)
     {
-        player_t *pl = PlayersArray[i];
+        player_t *pl;
         int tdist, tdx, tdy;
 
+        i = watch_players[k];
+        pl = PlayersArray[i];
+
         tdx = WRAP_DX(pl->pos.x - cpx);
         if (ABS(tdx) >= visualrange)
             continue;
@@ -27,6 +27,7 @@
 #include <cmath>
 #include <climits>
 #include <cassert>
+#include <vector>
 
 #include "commonmacros.h"
 
@@ -61,8 +62,22 @@ struct cell_offset
     short y;
 };
 
-static cell_node_t **Cells;
-static int object_node_offset;
+/*
+ * Objects are kept in a uniform grid with one cell per map block.
+ * The grid is a counting sort of the object array: cell_start[] and
+ * cell_count[] give the span of cell_objects[] holding the objects of
+ * a block.  Adding, moving or removing an object only records the new
+ * block in obj->cell and marks the grid dirty; the grid is rebuilt on
+ * the next query.  Only blocks that hold objects are touched on a
+ * rebuild, so its cost depends on the number of objects, not on the
+ * size of the map.
+ */
+static int *cell_start;
+static int *cell_count;
+static int *cell_touched;
+static int num_cell_touched;
+static object_t **cell_objects;
+static bool cells_dirty = true;
 static cell_dist_t *cell_dist;
 static size_t cell_dist_size;
 
@@ -150,125 +165,145 @@ static void Init_cell_dist(void)
 
 void Free_cells(void)
 {
-    XFREE(Cells);
+    XFREE(cell_start);
+    XFREE(cell_count);
+    XFREE(cell_touched);
+    XFREE(cell_objects);
+    num_cell_touched = 0;
+    cells_dirty = true;
     Free_cell_dist();
 }
 
 void Alloc_cells(void)
 {
-    size_t size;
-    cell_node_t *cell_ptr;
-    int x, y;
+    size_t num_cells = (size_t)world->x * world->y;
 
     Free_cells();
 
-    size = sizeof(cell_node_t *) * world->x;
-    size += sizeof(cell_node_t) * world->x * world->y;
-    if (!(Cells = (cell_node_t **)malloc(size)))
+    cell_start = XMALLOC(int, num_cells);
+    cell_count = XCALLOC(int, num_cells);
+    cell_touched = XMALLOC(int, MAX_TOTAL_SHOTS);
+    cell_objects = XMALLOC(object_t *, MAX_TOTAL_SHOTS);
+    if (!cell_start || !cell_count || !cell_touched || !cell_objects)
     {
         error("No Cell mem");
         End_game();
     }
-    cell_ptr = (cell_node_t *)&Cells[world->x];
-    for (x = 0; x < world->x; x++)
-    {
-        Cells[x] = cell_ptr;
-        for (y = 0; y < world->y; y++)
-        {
-            /* init list to point to itself. */
-            cell_ptr->next = cell_ptr;
-            cell_ptr->prev = cell_ptr;
-            cell_ptr++;
-        }
-    }
 
     Init_cell_dist();
 }
 
-void Cell_init_object(object_t *obj)
+/*
+ * Sort the objects into the grid.  The object array is walked
+ * backwards so that within a block the most recently moved objects
+ * come first, which is the order the old per-block lists had.
+ */
+static void Cell_rebuild(void)
 {
-    /* put obj on list with only itself. */
-    obj->cell.next = &(obj->cell);
-    obj->cell.prev = &(obj->cell);
+    int i, n, cell;
 
-    if (object_node_offset == 0)
-        object_node_offset = ((char *)&(obj->cell) - (char *)obj);
+    /* only the blocks used by the previous build have nonzero counts. */
+    for (i = 0; i < num_cell_touched; i++)
+        cell_count[cell_touched[i]] = 0;
+    num_cell_touched = 0;
+
+    for (i = 0; i < NumObjs; i++)
+    {
+        cell = Obj[i]->cell;
+        if (cell < 0)
+            continue;
+        if (cell_count[cell]++ == 0)
+            cell_touched[num_cell_touched++] = cell;
+    }
+
+    n = 0;
+    for (i = 0; i < num_cell_touched; i++)
+    {
+        cell = cell_touched[i];
+        cell_start[cell] = n;
+        n += cell_count[cell];
+        cell_count[cell] = 0;
+    }
+
+    for (i = NumObjs - 1; i >= 0; i--)
+    {
+        cell = Obj[i]->cell;
+        if (cell < 0)
+            continue;
+        cell_objects[cell_start[cell] + cell_count[cell]++] = Obj[i];
+    }
+
+    cells_dirty = false;
 }
 
-void Cell_add_object(object_t *obj)
+/*
+ * Bring the grid up to date.  Queries do this by themselves, but it
+ * must be called before querying from more than one thread.
+ */
+void Cell_update(void)
 {
-    blkpos_t bpos = Clicks_to_blkpos(obj->pos.cx, obj->pos.cy);
-    cell_node_t *obj_node_ptr, *cell_node_ptr;
-    cell_node_t *prev, *next;
-
-    obj_node_ptr = &(obj->cell);
-    next = obj_node_ptr->next;
-    prev = obj_node_ptr->prev;
+    if (cells_dirty)
+        Cell_rebuild();
+}
 
-    assert(next->prev == obj_node_ptr);
-    assert(prev->next == obj_node_ptr);
+void Cell_init_object(object_t *obj)
+{
+    obj->cell = -1;
+}
 
-    /* remove obj from current list */
-    next->prev = prev;
-    prev->next = next;
+void Cell_add_object(object_t *obj)
+{
+    int cell = -1;
 
-    if (!World_contains_clicks(obj->pos.cx, obj->pos.cy))
+    if (World_contains_clicks(obj->pos.cx, obj->pos.cy))
     {
-        /* put obj on list with only itself. */
-        obj_node_ptr->next = obj_node_ptr;
-        obj_node_ptr->prev = obj_node_ptr;
+        blkpos_t bpos = Clicks_to_blkpos(obj->pos.cx, obj->pos.cy);
+        cell = bpos.bx * world->y + bpos.by;
     }
-    else
+    if (cell != obj->cell)
     {
-        /* put obj in cell list. */
-        cell_node_ptr = &Cells[bpos.bx][bpos.by];
-        obj_node_ptr->next = cell_node_ptr->next;
-        obj_node_ptr->prev = cell_node_ptr;
-        cell_node_ptr->next->prev = obj_node_ptr;
-        cell_node_ptr->next = obj_node_ptr;
+        obj->cell = cell;
+        cells_dirty = true;
     }
 }
 
 void Cell_remove_object(object_t *obj)
 {
-    cell_node_t *obj_node_ptr;
-    cell_node_t *next, *prev;
-
-    obj_node_ptr = &(obj->cell);
-    next = obj_node_ptr->next;
-    prev = obj_node_ptr->prev;
-
-    assert(next->prev == obj_node_ptr);
-    assert(prev->next == obj_node_ptr);
-
-    /* remove obj from current list */
-    next->prev = prev;
-    prev->next = next;
-
-    /* put obj on list with only itself. */
-    obj_node_ptr->next = obj_node_ptr;
-    obj_node_ptr->prev = obj_node_ptr;
+    if (obj->cell >= 0)
+    {
+        obj->cell = -1;
+        cells_dirty = true;
+    }
 }
 
-void Cell_get_objects(int cx, int cy, // TODO: clpos_t pos, ?
-                      int range,
-                      int max_obj_count,
-                      object_t ***obj_list, int *count_ptr)
+/*
+ * Find the objects in the blocks at most range blocks away from
+ * the given position, nearest blocks first.  The result is a list of
+ * spans pointing into the grid, at most max_obj_count objects in total.
+ * The spans are valid until the next query, so the caller must not
+ * query again while it walks them.
+ */
+int Cell_get_spans(int cx, int cy, // TODO: clpos_t pos, ?
+                   int range,
+                   int max_obj_count,
+                   cell_span_t **span_list)
 {
-    static object_t *ObjectList[MAX_TOTAL_SHOTS + 1];
-    int i, count, x, y, xw, yw, wrap;
-    object_t *obj;
-    cell_node_t *cell_node_ptr, *next;
+    /* one list per thread, frames may be built on several threads. */
+    static thread_local std::vector<cell_span_t> spans;
+    int i, count, num_spans, x, y, xw, yw, wrap, cell, num;
     double dist;
     // blkpos_t bpos = Clpos_to_blkpos(pos);
     blkpos_t bpos = Clicks_to_blkpos(cx, cy);
 
+    Cell_update();
+
     x = bpos.bx;
     y = bpos.by;
 
     wrap = (BIT(world->rules->mode, WRAP_PLAY) != 0);
     dist = (double)(range * SQRT2);
     count = 0;
+    num_spans = 0;
     for (i = 0; i < (int)cell_dist_size && count < max_obj_count; i++)
     {
         if (dist < cell_dist[i].dist)
@@ -305,17 +340,41 @@ void Cell_get_objects(int cx, int cy, // TODO: clpos_t pos, ?
                 else
                     continue;
             }
-            cell_node_ptr = &Cells[xw][yw];
-            next = cell_node_ptr->next;
-            while (next != cell_node_ptr && count < max_obj_count)
-            {
-                obj = (object_t *)((char *)next - object_node_offset);
-                ObjectList[count++] = obj;
-                next = next->next;
-            }
+            cell = xw * world->y + yw;
+            num = MIN(cell_count[cell], max_obj_count - count);
+            if (num == 0)
+                continue;
+            if (num_spans >= (int)spans.size())
+                spans.resize(MAX(16, 2 * spans.size()));
+            spans[num_spans].objs = &cell_objects[cell_start[cell]];
+            spans[num_spans].num = num;
+            num_spans++;
+            count += num;
         }
     }
 
+    *span_list = spans.data();
+    return num_spans;
+}
+
+void Cell_get_objects(int cx, int cy, // TODO: clpos_t pos, ?
+                      int range,
+                      int max_obj_count,
+                      object_t ***obj_list, int *count_ptr)
+{
+    /* one list per thread, frames may be built on several threads. */
+    static thread_local object_t *ObjectList[MAX_TOTAL_SHOTS + 1];
+    cell_span_t *spans;
+    int i, j, count, num_spans;
+
+    num_spans = Cell_get_spans(cx, cy, range, max_obj_count, &spans);
+    count = 0;
+    for (i = 0; i < num_spans; i++)
+    {
+        for (j = 0; j < spans[i].num; j++)
+            ObjectList[count++] = spans[i].objs[j];
+    }
+
     ObjectList[count] = NULL;
     *obj_list = &ObjectList[0];
     if (count_ptr != NULL)
@@ -2415,6 +2415,104 @@ static option_desc opts[] = {
      tuner_dummy,
      "What is the maximum number of objects a player can see.\n",
      OPT_ORIGIN_ANY | OPT_VISIBLE},
+    {"frameThreads",
+     "frameThreads",
+     "1",
+     &options.frameThreads,
+     valInt,
+     tuner_dummy,
+     "How many threads are used for building the frames sent to the\n"
+     "clients.  The frames are identical whatever the number of threads.\n",
+     OPT_COMMAND | OPT_DEFAULTS | OPT_VISIBLE},
+    {"robotThreads",
+     "robotThreads",
+     "1",
+     &options.robotThreads,
+     valInt,
+     tuner_dummy,
+     "How many threads are used for the robots looking around before\n"
+     "they decide what to do.  The robots play the same whatever the\n"
+     "number of threads.\n",
+     OPT_COMMAND | OPT_DEFAULTS | OPT_VISIBLE},
+    {"robotLodNearRate",
+     "robotLodNearRate",
+     "2",
+     &options.robotLodNearRate,
+     valInt,
+     tuner_dummy,
+     "Robots on nobody's screen, but within robotLodDistance of what\n"
+     "some player looks at, decide what to do once every this many\n"
+     "frames.  Robots on screen always decide every frame.\n",
+     OPT_ORIGIN_ANY | OPT_VISIBLE},
+    {"robotLodFarRate",
+     "robotLodFarRate",
+     "4",
+     &options.robotLodFarRate,
+     valInt,
+     tuner_dummy,
+     "Robots farther than robotLodDistance from what any player looks at\n"
+     "decide what to do once every this many frames.\n",
+     OPT_ORIGIN_ANY | OPT_VISIBLE},
+    {"robotLodDistance",
+     "robotLodDistance",
+     "2000",
+     &options.robotLodDistance,
+     valReal,
+     tuner_dummy,
+     "The distance in pixels within which off screen robots use\n"
+     "robotLodNearRate instead of robotLodFarRate.\n",
+     OPT_ORIGIN_ANY | OPT_VISIBLE},
+    {"robotTimeBudget",
+     "robotTimeBudget",
+     "0",
+     &options.robotTimeBudget,
+     valReal,
+     tuner_dummy,
+     "How many milliseconds per frame robots may use for deciding what\n"
+     "to do.  When the off screen robots whose turn it is would take\n"
+     "longer, some of them wait for a later frame.  0 means no limit.\n",
+     OPT_ORIGIN_ANY | OPT_VISIBLE},
+    {"batchSend",
+     "batchSend",
+     "false",
+     &options.batchSend,
+     valBool,
+     tuner_dummy,
+     "Whether the frame datagrams are collected and sent together\n"
+     "at the end of a frame, using sendmmsg() where available.\n"
+     "Every client has its own socket, so this still takes one\n"
+     "system call per client each frame.\n",
+     OPT_ORIGIN_ANY | OPT_VISIBLE},
+    {"deltaFrames",
+     "deltaFrames",
+     "true",
+     &options.deltaFrames,
+     valBool,
+     tuner_dummy,
+     "Whether the player's own ship and the other ships are sent as\n"
+     "differences from a frame the client has acknowledged, to clients\n"
+     "which support it.  Applies to players who join afterwards.\n",
+     OPT_ORIGIN_ANY | OPT_VISIBLE},
+    {"adaptiveFrames",
+     "adaptiveFrames",
+     "true",
+     &options.adaptiveFrames,
+     valBool,
+     tuner_dummy,
+     "Whether frames to a client that overdraws clientByteRate or whose\n"
+     "acknowledgements show growing delay or loss are thinned, first\n"
+     "debris and sparks, then radar objects, then every other frame.\n",
+     OPT_ORIGIN_ANY | OPT_VISIBLE},
+    {"clientByteRate",
+     "clientByteRate",
+     "0",
+     &options.clientByteRate,
+     valInt,
+     tuner_dummy,
+     "The maximum number of bytes per second sent to one client.\n"
+     "Frames are thinned and then skipped to stay below it.\n"
+     "0 means no limit.\n",
+     OPT_ORIGIN_ANY | OPT_VISIBLE},
     {"pLockServer",
      "pLockServer",
 #ifdef PLOCKSERVER
@@ -2483,6 +2581,33 @@ static option_desc opts[] = {
      "Duration of last Main_loop() function call (in microseconds).\n"
      "This option is read only.\n",
      OPT_COMMAND | OPT_VISIBLE},
+    {"profile",
+     "profile",
+     "false",
+     &options.profile,
+     valBool,
+     tuner_dummy,
+     "Measure how long the phases of each server tick take.\n"
+     "The results are shown by the /profile command and written\n"
+     "to profileFileName.\n",
+     OPT_COMMAND | OPT_DEFAULTS | OPT_VISIBLE},
+    {"profileFileName",
+     "profileFile",
+     NULL,
+     &options.profileFileName,
+     valString,
+     tuner_dummy,
+     "File where the tick phase timings are appended as CSV\n"
+     "when the profile option is on.\n",
+     OPT_COMMAND | OPT_DEFAULTS},
+    {"profileInterval",
+     "profileInterval",
+     "10",
+     &options.profileInterval,
+     valInt,
+     tuner_dummy,
+     "Seconds between writing tick phase timings to profileFileName.\n",
+     OPT_COMMAND | OPT_DEFAULTS | OPT_VISIBLE},
 };
 
 static bool options_inited = false;
@@ -29,6 +29,8 @@
 #include <cmath>
 #include <climits>
 #include <cassert>
+#include <algorithm>
+#include <vector>
 
 #include "server.h"
 
@@ -251,6 +253,185 @@ static void Player_collides_with_asteroid(int ind, wireobject_t *obj);
 static void Player_collides_with_killing_shot(int ind, object_t *obj);
 static void Player_pass_checkpoint(int ind);
 
+/*
+ * Broad phase for player - player collisions.
+ *
+ * The path of each player during the frame, widened by half the
+ * collision range, spans an interval on each axis.  The x intervals are
+ * sorted and swept to find the pairs that also overlap in y.  Any pair
+ * that in_range_acd() would accept is among them, so testing only these
+ * pairs in the same order gives the same collisions as testing all pairs.
+ */
+typedef struct
+{
+    int lo, hi; /* pixels */
+    int ind;
+} sweep_span_t;
+
+typedef struct
+{
+    int i, j;
+} player_pair_t;
+
+static std::vector<sweep_span_t> player_span_x, player_span_y, sweep_list;
+static std::vector<player_pair_t> player_pairs;
+static std::vector<int> player_pair_start;
+
+static void Player_sweep_span(int c1, int c2, int size, int half, bool wrap,
+                              int ind, sweep_span_t *span)
+{
+    int p1 = CLICK_TO_PIXEL(c1);
+    int p2 = CLICK_TO_PIXEL(c2);
+
+    /* unwrap the path the same way in_range_acd() does. */
+    if (wrap && ABS(p2 - p1) > size / 2)
+    {
+        if (p1 > p2)
+            p1 -= size;
+        else
+            p2 -= size;
+    }
+    span->lo = MIN(p1, p2) - half;
+    span->hi = MAX(p1, p2) + half;
+    span->ind = ind;
+    if (wrap)
+    {
+        while (span->lo < 0)
+        {
+            span->lo += size;
+            span->hi += size;
+        }
+        while (span->lo >= size)
+        {
+            span->lo -= size;
+            span->hi -= size;
+        }
+    }
+}
+
+/*
+ * Do two spans overlap?  With wrapping both spans start inside the map
+ * and are shorter than it, so only a shift by one map size can matter.
+ */
+static bool Sweep_spans_overlap(const sweep_span_t *a, const sweep_span_t *b,
+                                int size, bool wrap)
+{
+    if (a->lo <= b->hi && b->lo <= a->hi)
+        return true;
+    if (!wrap)
+        return false;
+    return (b->lo + size <= a->hi || a->lo + size <= b->hi);
+}
+
+static bool Compare_sweep_lo(const sweep_span_t &a, const sweep_span_t &b)
+{
+    return a.lo < b.lo;
+}
+
+static bool Compare_player_pair(const player_pair_t &a, const player_pair_t &b)
+{
+    return (a.i != b.i) ? (a.i < b.i) : (a.j < b.j);
+}
+
+static void Player_collision_pairs(void)
+{
+    int i, j, k, n;
+    int half = (2 * SHIP_SZ - 6 + 1) / 2;
+    bool wrap = (BIT(world->rules->mode, WRAP_PLAY) != 0);
+    bool all_pairs = false;
+    player_pair_t pair;
+    std::vector<int> active;
+
+    player_span_x.resize(NumPlayers);
+    player_span_y.resize(NumPlayers);
+    player_pairs.clear();
+    for (i = 0; i < NumPlayers; i++)
+    {
+        player_t *pl = PlayersArray[i];
+
+        Player_sweep_span(pl->prevpos.cx, pl->pos.cx, world->width, half,
+                          wrap, i, &player_span_x[i]);
+        Player_sweep_span(pl->prevpos.cy, pl->pos.cy, world->height, half,
+                          wrap, i, &player_span_y[i]);
+        /* on tiny wrapping maps a span may cover the map, test all pairs. */
+        if (wrap && (player_span_x[i].hi - player_span_x[i].lo >= world->width || player_span_y[i].hi - player_span_y[i].lo >= world->height))
+            all_pairs = true;
+    }
+
+    if (all_pairs)
+    {
+        for (i = 0; i < NumPlayers; i++)
+        {
+            for (j = i + 1; j < NumPlayers; j++)
+            {
+                pair.i = i;
+                pair.j = j;
+                player_pairs.push_back(pair);
+            }
+        }
+    }
+    else
+    {
+        /* a span reaching past the right edge also shows up on the left. */
+        sweep_list.assign(player_span_x.begin(), player_span_x.end());
+        for (i = 0; i < NumPlayers; i++)
+        {
+            if (wrap && player_span_x[i].hi >= world->width)
+            {
+                sweep_span_t ghost = player_span_x[i];
+                ghost.lo -= world->width;
+                ghost.hi -= world->width;
+                sweep_list.push_back(ghost);
+            }
+        }
+        std::sort(sweep_list.begin(), sweep_list.end(), Compare_sweep_lo);
+
+        for (k = 0; k < (int)sweep_list.size(); k++)
+        {
+            const sweep_span_t *span = &sweep_list[k];
+
+            for (n = 0; n < (int)active.size();)
+            {
+                const sweep_span_t *other = &sweep_list[active[n]];
+
+                if (other->hi < span->lo)
+                {
+                    active[n] = active.back();
+                    active.pop_back();
+                    continue;
+                }
+                n++;
+                if (other->ind == span->ind)
+                    continue;
+                pair.i = MIN(other->ind, span->ind);
+                pair.j = MAX(other->ind, span->ind);
+                if (Sweep_spans_overlap(&player_span_y[pair.i],
+                                        &player_span_y[pair.j],
+                                        world->height, wrap))
+                    player_pairs.push_back(pair);
+            }
+            active.push_back(k);
+        }
+
+        /* a pair may have been found through a ghost as well. */
+        std::sort(player_pairs.begin(), player_pairs.end(), Compare_player_pair);
+        n = 0;
+        for (k = 0; k < (int)player_pairs.size(); k++)
+        {
+            if (n > 0 && player_pairs[n - 1].i == player_pairs[k].i && player_pairs[n - 1].j == player_pairs[k].j)
+                continue;
+            player_pairs[n++] = player_pairs[k];
+        }
+        player_pairs.resize(n);
+    }
+
+    player_pair_start.assign(NumPlayers + 1, 0);
+    for (k = 0; k < (int)player_pairs.size(); k++)
+        player_pair_start[player_pairs[k].i + 1]++;
+    for (i = 0; i < NumPlayers; i++)
+        player_pair_start[i + 1] += player_pair_start[i];
+}
+
 void Check_collision(void)
 {
     BallCollision();
@@ -262,9 +443,12 @@ void Check_collision(void)
 
 static void PlayerCollision(void)
 {
-    int i, j, sc, sc2;
+    int i, j, k, sc, sc2;
     player_t *pl;
 
+    if (BIT(world->rules->mode, CRASH_WITH_PLAYER | BOUNCE_WITH_PLAYER))
+        Player_collision_pairs();
+
     /* Player - player, checkpoint, treasure, object and wall */
     for (i = 0; i < NumPlayers; i++)
     {
@@ -288,8 +472,9 @@ static void PlayerCollision(void)
         /* Player - player */
         if (BIT(world->rules->mode, CRASH_WITH_PLAYER | BOUNCE_WITH_PLAYER))
         {
-            for (j = i + 1; j < NumPlayers; j++)
+            for (k = player_pair_start[i]; k < player_pair_start[i + 1]; k++)
             {
+                j = player_pairs[k].j;
                 if (BIT(PlayersArray[j]->status, PLAYING | PAUSE | GAME_OVER | KILLED) != PLAYING)
                     continue;
                 if (BIT(PlayersArray[j]->used, HAS_PHASING_DEVICE))
@@ -609,9 +794,10 @@ int CountDefensiveItems(player_t *pl)
 
 static void PlayerObjectCollision(int ind)
 {
-    int j, range, radius, hit, obj_count;
+    int s, j, range, radius, hit, num_spans;
     player_t *pl = PlayersArray[ind];
-    object_t *obj, **obj_list;
+    object_t *obj;
+    cell_span_t *spans;
 
     /*
      * Collision between a player and an object.
@@ -619,181 +805,183 @@ static void PlayerObjectCollision(int ind)
     if (BIT(pl->status, PLAYING | PAUSE | GAME_OVER | KILLED) != PLAYING)
         return;
 
-    Cell_get_objects(pl->pos.cx, pl->pos.cy,
-                     4, 500,
-                     &obj_list, &obj_count);
+    num_spans = Cell_get_spans(pl->pos.cx, pl->pos.cy,
+                               4, 500, &spans);
 
-    for (j = 0; j < obj_count; j++)
+    for (s = 0; s < num_spans; s++)
     {
-        obj = obj_list[j];
-        if (obj->life <= 0)
-            continue;
-
-        range = SHIP_SZ + obj->pl_range;
-        if (!in_range_acd(pl->prevpos.cx, pl->prevpos.cy,
-                          pl->pos.cx, pl->pos.cy,
-                          obj->prevpos.cx, obj->prevpos.cy,
-                          obj->pos.cx, obj->pos.cy,
-                          range))
+        for (j = 0; j < spans[s].num; j++)
         {
-            continue;
-        }
+            obj = spans[s].objs[j];
+            if (obj->life <= 0)
+                continue;
 
-        if (obj->id != NO_ID)
-        {
-            if (obj->id == pl->id)
+            range = SHIP_SZ + obj->pl_range;
+            if (!in_range_acd(pl->prevpos.cx, pl->prevpos.cy,
+                              pl->pos.cx, pl->pos.cy,
+                              obj->prevpos.cx, obj->prevpos.cy,
+                              obj->pos.cx, obj->pos.cy,
+                              range))
+            {
+                continue;
+            }
+
+            if (obj->id != NO_ID)
             {
-                if (BIT(obj->type, OBJ_SPARK | OBJ_MINE) && BIT(obj->status, OWNERIMMUNE))
+                if (obj->id == pl->id)
+                {
+                    if (BIT(obj->type, OBJ_SPARK | OBJ_MINE) && BIT(obj->status, OWNERIMMUNE))
+                    {
+                        continue;
+                    }
+                    else if (options.selfImmunity)
+                    {
+                        continue;
+                    }
+                }
+                else if (options.selfImmunity &&
+                         Player_is_tank(pl) &&
+                         (pl->lock.pl_id == obj->id))
                 {
                     continue;
                 }
-                else if (options.selfImmunity)
+                else if (Team_immune(obj->id, pl->id))
+                {
+                    continue;
+                }
+                else if (BIT(PlayersArray[GetInd[obj->id]]->status, PAUSE))
                 {
                     continue;
                 }
             }
-            else if (options.selfImmunity &&
-                     Player_is_tank(pl) &&
-                     (pl->lock.pl_id == obj->id))
-            {
-                continue;
-            }
-            else if (Team_immune(obj->id, pl->id))
-            {
-                continue;
-            }
-            else if (BIT(PlayersArray[GetInd[obj->id]]->status, PAUSE))
+            else if (BIT(world->rules->mode, TEAM_PLAY) && options.teamImmunity && obj->team == pl->team
+                     /* allow players to destroy their team's unowned balls */
+                     && obj->type != OBJ_BALL)
             {
                 continue;
             }
-        }
-        else if (BIT(world->rules->mode, TEAM_PLAY) && options.teamImmunity && obj->team == pl->team
-                 /* allow players to destroy their team's unowned balls */
-                 && obj->type != OBJ_BALL)
-        {
-            continue;
-        }
 
-        if (obj->type == OBJ_ITEM)
-        {
-            if (BIT(pl->used, HAS_SHIELD) && !options.shieldedItemPickup)
+            if (obj->type == OBJ_ITEM)
             {
-                SET_BIT(obj->status, GRAVITY);
-                Delta_mv((object_t *)pl, obj);
-                continue;
+                if (BIT(pl->used, HAS_SHIELD) && !options.shieldedItemPickup)
+                {
+                    SET_BIT(obj->status, GRAVITY);
+                    Delta_mv((object_t *)pl, obj);
+                    continue;
+                }
             }
-        }
-        else if (BIT(obj->type, OBJ_HEAT_SHOT | OBJ_SMART_SHOT | OBJ_TORPEDO | OBJ_SHOT | OBJ_CANNON_SHOT))
-        {
-            if (pl->id == obj->id && obj->life > obj->fuselife)
+            else if (BIT(obj->type, OBJ_HEAT_SHOT | OBJ_SMART_SHOT | OBJ_TORPEDO | OBJ_SHOT | OBJ_CANNON_SHOT))
             {
-                continue;
+                if (pl->id == obj->id && obj->life > obj->fuselife)
+                {
+                    continue;
+                }
             }
-        }
-        else if (BIT(obj->type, OBJ_MINE))
-        {
-            if (BIT(obj->status, CONFUSED))
+            else if (BIT(obj->type, OBJ_MINE))
             {
-                continue;
+                if (BIT(obj->status, CONFUSED))
+                {
+                    continue;
+                }
             }
-        }
-        else if (BIT(obj->type, OBJ_BALL) && obj->id != NO_ID)
-        {
-            if (BIT(PlayersArray[GetInd[obj->id]]->used, HAS_PHASING_DEVICE))
+            else if (BIT(obj->type, OBJ_BALL) && obj->id != NO_ID)
             {
-                continue;
+                if (BIT(PlayersArray[GetInd[obj->id]]->used, HAS_PHASING_DEVICE))
+                {
+                    continue;
+                }
             }
-        }
 
-        /*
-         * Objects actually only hit the player if they are really close.
-         */
-        radius = SHIP_SZ + obj->pl_radius;
-        if (radius >= range)
-            hit = 1;
-        else
-        {
-            hit = in_range_acd(pl->prevpos.cx, pl->prevpos.cy,
-                               pl->pos.cx, pl->pos.cy,
-                               obj->prevpos.cx, obj->prevpos.cy,
-                               obj->pos.cx, obj->pos.cy,
-                               range);
-        }
-
-        /*
-         * Object collision.
-         */
-        switch (obj->type)
-        {
-        case OBJ_BALL:
-            if (!hit)
-            {
-                continue;
-            }
-            Player_collides_with_ball(ind, obj, radius);
-            if (BIT(pl->status, KILLED))
+            /*
+             * Objects actually only hit the player if they are really close.
+             */
+            radius = SHIP_SZ + obj->pl_radius;
+            if (radius >= range)
+                hit = 1;
+            else
             {
-                return;
+                hit = in_range_acd(pl->prevpos.cx, pl->prevpos.cy,
+                                   pl->pos.cx, pl->pos.cy,
+                                   obj->prevpos.cx, obj->prevpos.cy,
+                                   obj->pos.cx, obj->pos.cy,
+                                   range);
             }
-            continue;
 
-        case OBJ_ITEM:
-            Player_collides_with_item(ind, obj);
-            /* if life is non-zero then no collision occurred */
-            if (obj->life != 0)
+            /*
+             * Object collision.
+             */
+            switch (obj->type)
             {
+            case OBJ_BALL:
+                if (!hit)
+                {
+                    continue;
+                }
+                Player_collides_with_ball(ind, obj, radius);
+                if (BIT(pl->status, KILLED))
+                {
+                    return;
+                }
                 continue;
-            }
-            break;
 
-        case OBJ_MINE:
-            Player_collides_with_mine(ind, obj);
-            break;
+            case OBJ_ITEM:
+                Player_collides_with_item(ind, obj);
+                /* if life is non-zero then no collision occurred */
+                if (obj->life != 0)
+                {
+                    continue;
+                }
+                break;
 
-        case OBJ_WRECKAGE:
-        case OBJ_DEBRIS:
-            Player_collides_with_debris(ind, obj);
-            if (BIT(pl->status, KILLED))
-            {
-                return;
-            }
-            break;
+            case OBJ_MINE:
+                Player_collides_with_mine(ind, obj);
+                break;
 
-        case OBJ_ASTEROID:
-            if (hit)
-            {
-                Player_collides_with_asteroid(ind, WIRE_PTR(obj));
-                Delta_mv_elastic((object_t *)pl, (object_t *)obj);
-            }
-            if (BIT(pl->status, KILLED))
-            {
-                return;
-            }
-            continue;
+            case OBJ_WRECKAGE:
+            case OBJ_DEBRIS:
+                Player_collides_with_debris(ind, obj);
+                if (BIT(pl->status, KILLED))
+                {
+                    return;
+                }
+                break;
 
-        case OBJ_CANNON_SHOT:
-            /* don't explode cannon flak if it hits directly*/
-            CLR_BIT(obj->mods.warhead, CLUSTER);
-            break;
+            case OBJ_ASTEROID:
+                if (hit)
+                {
+                    Player_collides_with_asteroid(ind, WIRE_PTR(obj));
+                    Delta_mv_elastic((object_t *)pl, (object_t *)obj);
+                }
+                if (BIT(pl->status, KILLED))
+                {
+                    return;
+                }
+                continue;
 
-        default:
-            break;
-        }
+            case OBJ_CANNON_SHOT:
+                /* don't explode cannon flak if it hits directly*/
+                CLR_BIT(obj->mods.warhead, CLUSTER);
+                break;
 
-        obj->life = 0;
+            default:
+                break;
+            }
 
-        if (BIT(obj->type, KILLING_SHOTS))
-        {
-            Player_collides_with_killing_shot(ind, obj);
-            if (BIT(pl->status, KILLED))
+            obj->life = 0;
+
+            if (BIT(obj->type, KILLING_SHOTS))
             {
-                return;
+                Player_collides_with_killing_shot(ind, obj);
+                if (BIT(pl->status, KILLED))
+                {
+                    return;
+                }
             }
-        }
 
-        if (hit)
-        {
-            Delta_mv((object_t *)pl, (object_t *)obj);
+            if (hit)
+            {
+                Delta_mv((object_t *)pl, (object_t *)obj);
+            }
         }
     }
 }
@@ -1457,9 +1645,10 @@ static void Player_pass_checkpoint(int ind)
 
 static void AsteroidCollision(void)
 {
-    int j, radius, obj_count;
+    int s, j, radius, num_spans;
     object_t *ast;
-    object_t *obj = NULL, **obj_list;
+    object_t *obj = NULL;
+    cell_span_t *spans;
     double damage = 0;
     bool sound = false;
 
@@ -1480,115 +1669,117 @@ static void AsteroidCollision(void)
         assert(OBJ_Y_IN_BLOCKS(ast) >= 0);
         assert(OBJ_Y_IN_BLOCKS(ast) < world->y);
 
-        Cell_get_objects(ast->pos.cx, ast->pos.cy,
-                         ast->pl_radius / BLOCK_SZ + 1, 300,
-                         &obj_list, &obj_count);
+        num_spans = Cell_get_spans(ast->pos.cx, ast->pos.cy,
+                                   ast->pl_radius / BLOCK_SZ + 1, 300, &spans);
 
-        for (j = 0; j < obj_count; j++)
+        for (s = 0; s < num_spans; s++)
         {
-            obj = obj_list[j];
-            assert(obj != NULL);
-            if (obj->life <= 0)
-                continue;
+            for (j = 0; j < spans[s].num; j++)
+            {
+                obj = spans[s].objs[j];
+                assert(obj != NULL);
+                if (obj->life <= 0)
+                    continue;
 
-            /* asteroids don't hit these objects */
-            if (BIT(obj->type, OBJ_ITEM | OBJ_DEBRIS | OBJ_SPARK | OBJ_WRECKAGE) && obj->id == NO_ID && !BIT(obj->status, FROMCANNON))
-                continue;
-            /* don't collide while still overlapping  after breaking */
-            if (obj->type == OBJ_ASTEROID && ast->life > ast->fuselife)
-                continue;
-            /* don't collide with self */
-            if (obj == ast)
-                continue;
-            /* don't collide with phased balls */
-            if (BIT(obj->type, OBJ_BALL) && obj->id != NO_ID && BIT(PlayersArray[GetInd[obj->id]]->used, HAS_PHASING_DEVICE))
-                continue;
+                /* asteroids don't hit these objects */
+                if (BIT(obj->type, OBJ_ITEM | OBJ_DEBRIS | OBJ_SPARK | OBJ_WRECKAGE) && obj->id == NO_ID && !BIT(obj->status, FROMCANNON))
+                    continue;
+                /* don't collide while still overlapping  after breaking */
+                if (obj->type == OBJ_ASTEROID && ast->life > ast->fuselife)
+                    continue;
+                /* don't collide with self */
+                if (obj == ast)
+                    continue;
+                /* don't collide with phased balls */
+                if (BIT(obj->type, OBJ_BALL) && obj->id != NO_ID && BIT(PlayersArray[GetInd[obj->id]]->used, HAS_PHASING_DEVICE))
+                    continue;
 
-            radius = ast->pl_radius + obj->pl_radius;
-            if (!in_range_acd(ast->prevpos.cx, ast->prevpos.cy,
-                              ast->pos.cx, ast->pos.cy,
-                              obj->prevpos.cx, obj->prevpos.cy,
-                              obj->pos.cx, obj->pos.cy,
-                              radius))
-            {
-                continue;
-            }
+                radius = ast->pl_radius + obj->pl_radius;
+                if (!in_range_acd(ast->prevpos.cx, ast->prevpos.cy,
+                                  ast->pos.cx, ast->pos.cy,
+                                  obj->prevpos.cx, obj->prevpos.cy,
+                                  obj->pos.cx, obj->pos.cy,
+                                  radius))
+                {
+                    continue;
+                }
 
-            switch (obj->type)
-            {
-            case OBJ_BALL:
-                Obj_repel(ast, obj, radius);
-                if (options.treasureCollisionDestroys)
+                switch (obj->type)
+                {
+                case OBJ_BALL:
+                    Obj_repel(ast, obj, radius);
+                    if (options.treasureCollisionDestroys)
+                        obj->life = 0;
+                    damage = ED_BALL_HIT;
+                    sound = true;
+                    break;
+                case OBJ_ASTEROID:
+                    obj->life -= ASTEROID_FUEL_HIT(ABS(2 * ast->mass * VECTOR_LENGTH(ast->vel)),
+                                                   WIRE_PTR(obj)->size);
+                    damage = -ABS(2 * obj->mass * VECTOR_LENGTH(obj->vel));
+                    Delta_mv_elastic(ast, obj);
+                    /* avoid doing collision twice */
+                    obj->fuselife = obj->life - 1;
+                    sound = true;
+                    break;
+                case OBJ_SPARK:
                     obj->life = 0;
-                damage = ED_BALL_HIT;
-                sound = true;
-                break;
-            case OBJ_ASTEROID:
-                obj->life -= ASTEROID_FUEL_HIT(ABS(2 * ast->mass * VECTOR_LENGTH(ast->vel)),
-                                               WIRE_PTR(obj)->size);
-                damage = -ABS(2 * obj->mass * VECTOR_LENGTH(obj->vel));
-                Delta_mv_elastic(ast, obj);
-                /* avoid doing collision twice */
-                obj->fuselife = obj->life - 1;
-                sound = true;
-                break;
-            case OBJ_SPARK:
-                obj->life = 0;
-                Delta_mv(ast, obj);
-                damage = 0;
-                break;
-            case OBJ_DEBRIS:
-            case OBJ_WRECKAGE:
-                obj->life = 0;
-                damage = -ABS(2 * obj->mass * VECTOR_LENGTH(obj->vel));
-                Delta_mv(ast, obj);
-                break;
-            case OBJ_MINE:
-                if (!BIT(obj->status, CONFUSED))
+                    Delta_mv(ast, obj);
+                    damage = 0;
+                    break;
+                case OBJ_DEBRIS:
+                case OBJ_WRECKAGE:
                     obj->life = 0;
-                break;
-            case OBJ_SHOT:
-            case OBJ_CANNON_SHOT:
-                obj->life = 0;
-                Delta_mv(ast, obj);
-                damage = ED_SHOT_HIT;
-                sound = true;
-                break;
-            case OBJ_SMART_SHOT:
-            case OBJ_TORPEDO:
-            case OBJ_HEAT_SHOT:
-                obj->life = 0;
-                Delta_mv(ast, obj);
-                damage = ED_SMART_SHOT_HIT / ((obj->mods.mini + 1) * (obj->mods.power + 1));
-                sound = true;
-                break;
-            default:
-                Delta_mv(ast, obj);
-                damage = 0;
-                break;
-            }
+                    damage = -ABS(2 * obj->mass * VECTOR_LENGTH(obj->vel));
+                    Delta_mv(ast, obj);
+                    break;
+                case OBJ_MINE:
+                    if (!BIT(obj->status, CONFUSED))
+                        obj->life = 0;
+                    break;
+                case OBJ_SHOT:
+                case OBJ_CANNON_SHOT:
+                    obj->life = 0;
+                    Delta_mv(ast, obj);
+                    damage = ED_SHOT_HIT;
+                    sound = true;
+                    break;
+                case OBJ_SMART_SHOT:
+                case OBJ_TORPEDO:
+                case OBJ_HEAT_SHOT:
+                    obj->life = 0;
+                    Delta_mv(ast, obj);
+                    damage = ED_SMART_SHOT_HIT / ((obj->mods.mini + 1) * (obj->mods.power + 1));
+                    sound = true;
+                    break;
+                default:
+                    Delta_mv(ast, obj);
+                    damage = 0;
+                    break;
+                }
 
-            if (ast->life > 0)
-            {
-                if (ast->life <= ast->fuselife)
-                    ast->life += ASTEROID_FUEL_HIT(damage, WIRE_PTR(ast)->size);
-                if (sound)
-                    sound_play_sensors(ast->pos.cx, ast->pos.cy, ASTEROID_HIT_SOUND);
-                if (ast->life < 0)
-                    ast->life = 0;
-                if (ast->life == 0)
+                if (ast->life > 0)
                 {
-                    if (options.asteroidPoints > 0 && (obj->id != NO_ID || (obj->type == OBJ_BALL && BALL_PTR(obj)->owner != NO_ID)))
+                    if (ast->life <= ast->fuselife)
+                        ast->life += ASTEROID_FUEL_HIT(damage, WIRE_PTR(ast)->size);
+                    if (sound)
+                        sound_play_sensors(ast->pos.cx, ast->pos.cy, ASTEROID_HIT_SOUND);
+                    if (ast->life < 0)
+                        ast->life = 0;
+                    if (ast->life == 0)
                     {
-                        int owner_id = ((obj->type == OBJ_BALL)
-                                            ? BALL_PTR(obj)->owner
-                                            : obj->id);
-                        int ind = GetInd[owner_id];
-                        if (PlayersArray[ind]->score <= options.asteroidMaxScore)
-                            SCORE(PlayersArray[ind], options.asteroidPoints, ast->pos.cx, ast->pos.cy, "");
-                    }
+                        if (options.asteroidPoints > 0 && (obj->id != NO_ID || (obj->type == OBJ_BALL && BALL_PTR(obj)->owner != NO_ID)))
+                        {
+                            int owner_id = ((obj->type == OBJ_BALL)
+                                                ? BALL_PTR(obj)->owner
+                                                : obj->id);
+                            int ind = GetInd[owner_id];
+                            if (PlayersArray[ind]->score <= options.asteroidMaxScore)
+                                SCORE(PlayersArray[ind], options.asteroidPoints, ast->pos.cx, ast->pos.cy, "");
+                        }
 
-                    /* break; */
+                        /* break; */
+                    }
                 }
             }
         }
@@ -1598,9 +1789,9 @@ static void AsteroidCollision(void)
 /* do ball - object and ball - checkpoint collisions */
 static void BallCollision(void)
 {
-    int i, j, obj_count;
+    int i, s, j, num_spans;
     int ignored_object_types;
-    object_t **obj_list;
+    cell_span_t *spans;
     object_t *obj;
     ballobject_t *ball;
 
@@ -1644,80 +1835,82 @@ static void BallCollision(void)
         if (!options.ballCollisions)
             continue;
 
-        Cell_get_objects(ball->pos.cx, ball->pos.cy,
-                         4, 300,
-                         &obj_list, &obj_count);
+        num_spans = Cell_get_spans(ball->pos.cx, ball->pos.cy,
+                                   4, 300, &spans);
 
-        for (j = 0; j < obj_count; j++)
+        for (s = 0; s < num_spans; s++)
         {
-            obj = obj_list[j];
+            for (j = 0; j < spans[s].num; j++)
+            {
+                obj = spans[s].objs[j];
 
-            if (BIT(obj->type, ignored_object_types))
-                continue;
+                if (BIT(obj->type, ignored_object_types))
+                    continue;
 
-            if (obj->life <= 0)
-                continue;
+                if (obj->life <= 0)
+                    continue;
 
-            /* have we already done this ball pair? */
-            if (obj->type == OBJ_BALL && obj <= OBJ_PTR(ball))
-                continue;
+                /* have we already done this ball pair? */
+                if (obj->type == OBJ_BALL && obj <= OBJ_PTR(ball))
+                    continue;
 
-            if (!in_range_acd(ball->prevpos.cx, ball->prevpos.cy,
-                              ball->pos.cx, ball->pos.cy,
-                              obj->prevpos.cx, obj->prevpos.cy,
-                              obj->pos.cx, obj->pos.cy,
-                              ball->pl_radius + obj->pl_radius))
-            {
-                continue;
-            }
+                if (!in_range_acd(ball->prevpos.cx, ball->prevpos.cy,
+                                  ball->pos.cx, ball->pos.cy,
+                                  obj->prevpos.cx, obj->prevpos.cy,
+                                  obj->pos.cx, obj->pos.cy,
+                                  ball->pl_radius + obj->pl_radius))
+                {
+                    continue;
+                }
 
-            /* bang! */
+                /* bang! */
 
-            switch (obj->type)
-            {
-            case OBJ_BALL:
-                /* Balls bounce off other balls that aren't safe in
-                 * the treasure: */
+                switch (obj->type)
                 {
-                    ballobject_t *b2 = BALL_PTR(obj);
-                    if (world->treasures[b2->treasure].have)
+                case OBJ_BALL:
+                    /* Balls bounce off other balls that aren't safe in
+                     * the treasure: */
+                    {
+                        ballobject_t *b2 = BALL_PTR(obj);
+                        if (world->treasures[b2->treasure].have)
+                        {
+                            break;
+                        }
+                        if (b2->id != NO_ID && BIT(PlayersArray[GetInd[b2->id]]->used, HAS_PHASING_DEVICE))
+                        {
+                            break;
+                        }
+                    }
+
+                    /* if the collision was too violent, destroy ball and object */
+                    if ((sqr(ball->vel.x - obj->vel.x) +
+                         sqr(ball->vel.y - obj->vel.y)) >
+                        sqr(options.maxObjectWallBounceSpeed))
                     {
-                        break;
+                        ball->life = 0;
+                        obj->life = 0;
                     }
-                    if (b2->id != NO_ID && BIT(PlayersArray[GetInd[b2->id]]->used, HAS_PHASING_DEVICE))
+                    else
                     {
-                        break;
+                        /* they bounce */
+                        Obj_repel((object_t *)ball, obj,
+                                  ball->pl_radius + obj->pl_radius);
                     }
-                }
-
-                /* if the collision was too violent, destroy ball and object */
-                if ((sqr(ball->vel.x - obj->vel.x) +
-                     sqr(ball->vel.y - obj->vel.y)) >
-                    sqr(options.maxObjectWallBounceSpeed))
-                {
-                    ball->life = 0;
+                    break;
+
+                /* balls absorb and destroy all other objects: */
+                case OBJ_SPARK:
+                case OBJ_TORPEDO:
+                case OBJ_SMART_SHOT:
+                case OBJ_HEAT_SHOT:
+                case OBJ_SHOT:
+                case OBJ_CANNON_SHOT:
+                case OBJ_DEBRIS:
+                case OBJ_WRECKAGE:
+                    Delta_mv(OBJ_PTR(ball), obj);
                     obj->life = 0;
+                    break;
                 }
-                else
-                {
-                    /* they bounce */
-                    Obj_repel((object_t *)ball, obj,
-                              ball->pl_radius + obj->pl_radius);
-                }
-                break;
-
-            /* balls absorb and destroy all other objects: */
-            case OBJ_SPARK:
-            case OBJ_TORPEDO:
-            case OBJ_SMART_SHOT:
-            case OBJ_HEAT_SHOT:
-            case OBJ_SHOT:
-            case OBJ_CANNON_SHOT:
-            case OBJ_DEBRIS:
-            case OBJ_WRECKAGE:
-                Delta_mv(OBJ_PTR(ball), obj);
-                obj->life = 0;
-                break;
             }
         }
     }
@@ -1726,8 +1919,8 @@ static void BallCollision(void)
 /* do mine - object collisions */
 static void MineCollision(void)
 {
-    int i, j, obj_count;
-    object_t **obj_list;
+    int i, s, j, num_spans;
+    cell_span_t *spans;
     object_t *obj;
     mineobject_t *mine;
     int collide_object_types;
@@ -1757,33 +1950,36 @@ static void MineCollision(void)
             continue;
         }
 
-        Cell_get_objects(mine->pos.cx, mine->pos.cy,
-                         4, 300,
-                         &obj_list, &obj_count);
+        num_spans = Cell_get_spans(mine->pos.cx, mine->pos.cy,
+                                   4, 300, &spans);
 
-        for (j = 0; j < obj_count; j++)
+        /* a mine goes off on the first object it hits. */
+        for (s = 0; s < num_spans && mine->life > 0; s++)
         {
-            obj = obj_list[j];
+            for (j = 0; j < spans[s].num; j++)
+            {
+                obj = spans[s].objs[j];
 
-            if (!BIT(obj->type, collide_object_types))
-                continue;
+                if (!BIT(obj->type, collide_object_types))
+                    continue;
 
-            if (obj->life <= 0)
-                continue;
+                if (obj->life <= 0)
+                    continue;
 
-            if (!in_range_acd(mine->prevpos.cx, mine->prevpos.cy,
-                              mine->pos.cx, mine->pos.cy,
-                              obj->prevpos.cx, obj->prevpos.cy,
-                              obj->pos.cx, obj->pos.cy,
-                              options.mineShotDetonateDistance + obj->pl_radius))
-            {
-                continue;
-            }
+                if (!in_range_acd(mine->prevpos.cx, mine->prevpos.cy,
+                                  mine->pos.cx, mine->pos.cy,
+                                  obj->prevpos.cx, obj->prevpos.cy,
+                                  obj->pos.cx, obj->pos.cy,
+                                  options.mineShotDetonateDistance + obj->pl_radius))
+                {
+                    continue;
+                }
 
-            /* bang! */
-            obj->life = 0;
-            mine->life = 0;
-            break;
+                /* bang! */
+                obj->life = 0;
+                mine->life = 0;
+                break;
+            }
         }
     }
 }
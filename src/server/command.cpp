@@ -40,6 +40,8 @@
 #include "xperror.h"
 #include "netserver.h"
 #include "score.h"
+#include "profile.h"
+#include "walls.h"
 
 static int Get_player_index_by_name(char *name)
 {
@@ -120,6 +122,7 @@ static int Cmd_kick(char *arg, player_t *pl, int oper, char *msg);
 static int Cmd_queue(char *arg, player_t *pl, int oper, char *msg);
 static int Cmd_advance(char *arg, player_t *pl, int oper, char *msg);
 static int Cmd_get(char *arg, player_t *pl, int oper, char *msg);
+static int Cmd_profile(char *arg, player_t *pl, int oper, char *msg);
 
 typedef struct
 {
@@ -177,6 +180,12 @@ static Command_info commands[] = {
      "/pause <player name or ID number>.  Pauses player.  (operator)",
      1,
      Cmd_pause},
+    {"profile",
+     "pr",
+     "/profile [on|off|reset|<phase>].  Shows how long the phases of "
+     "a server tick take, in microseconds.  (operator)",
+     1,
+     Cmd_profile},
     {"queue",
      "q",
      "/queue.  Show the names of players waiting to enter.",
@@ -896,3 +905,120 @@ static int Cmd_get(char *arg, player_t *pl, int oper, char *msg)
 
     return CMD_RESULT_ERROR;
 }
+
+static int Cmd_profile(char *arg, player_t *pl, int oper, char *msg)
+{
+    profile_stats_t stats;
+    char line[MSG_LEN];
+    int i, first, last;
+
+    if (!oper)
+    {
+        return CMD_RESULT_NOT_OPERATOR;
+    }
+
+    if (!strcasecmp(arg, "on") || !strcasecmp(arg, "off"))
+    {
+        char value[MAX_CHARS];
+
+        strlcpy(value, strcasecmp(arg, "on") ? "false" : "true", sizeof(value));
+        Tune_option((char *)"profile", value);
+        sprintf(msg, "Profiling is %s.", options.profile ? "on" : "off");
+        return CMD_RESULT_SUCCESS;
+    }
+    if (!strcasecmp(arg, "reset"))
+    {
+        Profile_reset();
+        strcpy(msg, "Profile reset.");
+        return CMD_RESULT_SUCCESS;
+    }
+    if (!options.profile)
+    {
+        strcpy(msg, "Profiling is off, use /profile on.");
+        return CMD_RESULT_ERROR;
+    }
+
+    if (!*arg)
+    {
+        first = 0;
+        last = NUM_PROFILE_PHASES - 1;
+    }
+    else if ((first = last = Profile_phase_by_name(arg)) < 0)
+    {
+        sprintf(msg, "No phase named %s.", arg);
+        return CMD_RESULT_ERROR;
+    }
+
+    for (i = first; i <= last; i++)
+    {
+        Profile_get_stats(i, &stats);
+        snprintf(line, sizeof(line),
+                 "%s: n=%ld mean=%.0f p50=%.0f p99=%.0f max=%.0f "
+                 "[*Server reply*]",
+                 Profile_phase_name(i), stats.count,
+                 stats.mean, stats.p50, stats.p99, stats.max);
+        Set_player_message(pl, line);
+    }
+    if (!*arg)
+    {
+        pool_stats_t pool;
+        sockbuf_batch_stats_t send;
+        sockbuf_recv_stats_t recv;
+        frame_shaping_stats_t shaping;
+        robot_lod_stats_t lod;
+        move_stats_t moves;
+
+        for (i = 0; i < NUM_POOLS; i++)
+        {
+            Pool_get_stats(i, &pool);
+            snprintf(line, sizeof(line),
+                     "%s pool: used=%d high=%d of %d "
+                     "[*Server reply*]",
+                     pool.name, pool.in_use, pool.high_water, pool.capacity);
+            Set_player_message(pl, line);
+        }
+
+        Sockbuf_batch_get_stats(&send);
+        snprintf(line, sizeof(line),
+                 "send: datagrams=%ld syscalls=%ld saved=%ld dropped=%ld "
+                 "[*Server reply*]",
+                 send.datagrams, send.syscalls,
+                 send.datagrams - send.syscalls, send.dropped);
+        Set_player_message(pl, line);
+
+        Sockbuf_recv_get_stats(&recv);
+        snprintf(line, sizeof(line),
+                 "recv: wakeups=%ld datagrams=%ld per_wakeup=%.2f "
+                 "max=%d empty=%ld [*Server reply*]",
+                 recv.calls, recv.datagrams,
+                 recv.calls ? (double)recv.datagrams / recv.calls : 0.0,
+                 recv.max_batch, recv.empty);
+        Set_player_message(pl, line);
+
+        Frame_get_shaping_stats(&shaping);
+        snprintf(line, sizeof(line),
+                 "frames: sent=%ld thinned=%ld skipped fps=%ld "
+                 "congestion=%ld [*Server reply*]",
+                 shaping.frames, shaping.thinned,
+                 shaping.skipped_fps, shaping.skipped_thin);
+        Set_player_message(pl, line);
+
+        Robot_get_lod_stats(&lod);
+        snprintf(line, sizeof(line),
+                 "robots: full=%ld reduced=%ld skipped=%ld deferred=%ld "
+                 "[*Server reply*]",
+                 lod.full, lod.reduced, lod.skipped, lod.deferred);
+        Set_player_message(pl, line);
+
+        Move_get_stats(&moves);
+        snprintf(line, sizeof(line),
+                 "moves: objects=%ld fast=%ld ships=%ld fast=%ld "
+                 "segments=%ld fast=%ld [*Server reply*]",
+                 moves.object_moves, moves.object_fast,
+                 moves.player_moves, moves.player_fast,
+                 moves.segments, moves.segments_fast);
+        Set_player_message(pl, line);
+    }
+
+    return CMD_RESULT_SUCCESS;
+}
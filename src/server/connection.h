@@ -31,6 +31,30 @@
 
 #include "net.h"
 #include "shipshape.h"
+#include "delta.h"
+
+/*
+ * The setup stream, the setup packet followed by the map data, is
+ * encoded once per map and transfer method.  Connections in the setup
+ * state transmit straight out of it by offset, so it is never changed
+ * after creation and is freed when the last reference is dropped.
+ */
+typedef struct
+{
+    int refcount;
+    int len;
+    char data[4];
+    /* plus more setup stream here (HACK) */
+} setup_blob_t;
+
+/*
+ * How much of the frames to a congested connection is left out.
+ */
+#define THIN_NONE 0   /* full frames */
+#define THIN_SPARKS 1 /* half the debris and sparks */
+#define THIN_DEBRIS 2 /* no debris and sparks */
+#define THIN_RADAR 3  /* only players on the radar */
+#define THIN_FRAMES 4 /* every other frame */
 
 /*
  * Different states a connection can be in.
@@ -94,8 +118,11 @@ typedef struct
     int rtt_dev;                 /* roundtrip time deviation */
     int rtt_retransmit;          /* retransmission time */
     int rtt_timeouts;            /* how many timeouts */
+    int rtt_min;                 /* lowest roundtrip time seen */
     int acks;                    /* good acknowledgements */
     int setup;                   /* amount of setup done */
+    setup_blob_t *setup_blob;    /* setup stream for this client */
+    long setup_base;             /* reliable offset of setup stream */
     int my_port;                 /* server port for this player */
     int his_port;                /* client port for this player */
     int id;                      /* index into GetInd[] or NO_ID */
@@ -116,6 +143,18 @@ typedef struct
     char *addr;                  /* address of players host */
     char *host;                  /* hostname of players host */
     int features;                /* supported features */
+    bool fake;                   /* no socket, output is discarded */
+    long bytes_sent;             /* frame bytes sent to client */
+    long delta_ack;              /* last frame the client acknowledged */
+    long delta_base;             /* frame this frame is coded against */
+    delta_frame_t *delta;        /* what the last frames contained */
+    int frame_thin;              /* THIN_* level of frames sent */
+    long thin_loops;             /* frame when frame_thin changed */
+    long congested_loops;        /* frame when last congested */
+    int fps_credit;              /* frames due at player's rate */
+    long byte_credit;            /* bytes left of clientByteRate */
+    long budget_loops;           /* frame when byte_credit updated */
+    long budget_bytes_sent;      /* bytes_sent when byte_credit updated */
 } connection_t;
 
 #endif
@@ -21,6 +21,8 @@
  * <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <vector>
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
@@ -38,6 +40,7 @@
 #include "strlcpy.h"
 
 #include "server.h"
+#include "profile.h"
 
 #define SERVER
 #include "xpconfig.h"
@@ -49,6 +52,7 @@
 #include "xperror.h"
 #include "xpmath.h"
 #include "player.h"
+#include "threadpool.h"
 
 #define MAX_SHUFFLE_INDEX 65535
 
@@ -94,21 +98,38 @@ typedef struct
     short x, y, size;
 } radar_t;
 
+typedef struct
+{
+    int cx, cy; /* position in clicks */
+    int size;
+} radar_object_t;
+
 extern time_t gameOverTime;
 long frame_loops = 1;
+static frame_shaping_stats_t shaping;
 static long last_frame_shuffle;
+static radar_object_t *radar_objects;
+static int num_radar_objects, max_radar_objects;
+static int *radar_players;
+static int num_radar_players, max_radar_players;
 static shuffle_t *object_shuffle_ptr;
 static int num_object_shuffle;
 static int max_object_shuffle;
 static shuffle_t *player_shuffle_ptr;
 static int num_player_shuffle;
 static int max_player_shuffle;
-static radar_t *radar_ptr;
-static int num_radar, max_radar;
 
-static pixel_visibility_t pv;
-static click_visibility_t cv;
-static int view_width,
+/*
+ * The state below is used while building the frame for one connection.
+ * Frames may be built on several threads at once, see Frame_update(),
+ * so each thread has its own copy.
+ */
+static thread_local radar_t *radar_ptr;
+static thread_local int num_radar, max_radar;
+
+static thread_local pixel_visibility_t pv;
+static thread_local click_visibility_t cv;
+static thread_local int view_width,
     view_height,
     view_click_width,
     view_click_height,
@@ -119,13 +140,62 @@ static int view_width,
     debris_areas,
     debris_colors,
     spark_rand;
-static debris_t *debris_ptr[DEBRIS_TYPES];
-static unsigned debris_num[DEBRIS_TYPES],
+static thread_local debris_t *debris_ptr[DEBRIS_TYPES];
+static thread_local unsigned debris_num[DEBRIS_TYPES],
     debris_max[DEBRIS_TYPES];
-static debris_t *fastshot_ptr[DEBRIS_TYPES * 2];
-static unsigned fastshot_num[DEBRIS_TYPES * 2],
+static thread_local debris_t *fastshot_ptr[DEBRIS_TYPES * 2];
+static thread_local unsigned fastshot_num[DEBRIS_TYPES * 2],
     fastshot_max[DEBRIS_TYPES * 2];
 
+/*
+ * Random numbers used while building a frame come from a generator
+ * which is seeded for each connection from frame_seed.  This keeps
+ * the frame contents independent of the order in which the
+ * connections are handled and leaves the game's own generator alone.
+ */
+static unsigned frame_seed;
+static thread_local unsigned frame_rand_state;
+
+static void Frame_rand_seed(connection_t *conn)
+{
+    frame_rand_state = frame_seed ^ ((conn->conn_index + 1) * 2654435761u);
+    if (frame_rand_state == 0)
+        frame_rand_state = 1;
+}
+
+static unsigned Frame_random(void)
+{
+    /* xorshift32 */
+    frame_rand_state ^= frame_rand_state << 13;
+    frame_rand_state ^= frame_rand_state >> 17;
+    frame_rand_state ^= frame_rand_state << 5;
+    return frame_rand_state;
+}
+
+static double Frame_rfrac(void)
+{
+    return (double)Frame_random() * (1.0 / 4294967296.0);
+}
+
+/*
+ * One frame to build: the connection to send it to,
+ * the player owning the connection and the player whose view is sent.
+ */
+typedef struct
+{
+    connection_t *conn;
+    int i;
+    int ind;
+    bool end_frame;      /* false if the frame should be dropped */
+    uint64_t build_time; /* nanoseconds, if profiling */
+} frame_job_t;
+
+static frame_job_t *frame_jobs;
+static int num_frame_jobs, max_frame_jobs;
+static int *frame_group_jobs;
+static int *frame_group_start;
+static int max_frame_groups;
+
 // #define inview(x_, y_)                                                  \
 //     ((((x_) > pv.world.x && (x_) < pv.world.x + view_width) ||          \
 //       ((x_) > pv.realWorld.x && (x_) < pv.realWorld.x + view_width)) && \
@@ -319,7 +389,7 @@ static void Frame_radar_buffer_send(connection_t *conn)
     /* permute. */
     for (i = 0; i < num_radar; i++)
     {
-        dest = (int)(rfrac() * num_radar);
+        dest = (int)(Frame_rfrac() * num_radar);
         tmp = radar_shuffle[i];
         radar_shuffle[i] = radar_shuffle[dest];
         radar_shuffle[dest] = tmp;
@@ -405,7 +475,7 @@ static int num2str(int num, char *str, int i)
 
 static int Frame_status(connection_t *conn, int ind)
 {
-    static char mods[MAX_CHARS];
+    static thread_local char mods[MAX_CHARS];
     player_t *pl = PlayersArray[ind];
     int n,
         lock_ind,
@@ -541,7 +611,6 @@ static void Frame_map(connection_t *conn, player_t *pl)
 {
     int i, k;
     // int bx, by;
-    int conn_bit = (1 << conn->conn_index);
     // block_visibility_t bv;
     const int fuel_packet_size = 5;
     const int cannon_packet_size = 5;
@@ -578,8 +647,9 @@ static void Frame_map(connection_t *conn, player_t *pl)
         if (++i >= world->NumTargets)
             i = 0;
         targ = &world->targets[i];
-        if (BIT(targ->update_mask, conn_bit) || (BIT(targ->conn_mask, conn_bit) == 0 &&
-                                                 click_inview(cv, targ->clk_pos.cx, targ->clk_pos.cy)))
+        if (Conn_mask_test(&targ->update_mask, conn->conn_index) ||
+            (!Conn_mask_test(&targ->conn_mask, conn->conn_index) &&
+             click_inview(cv, targ->clk_pos.cx, targ->clk_pos.cy)))
         {
             Send_target(conn, i, targ->dead_time, targ->damage);
             pl->last_target_update = i;
@@ -600,7 +670,7 @@ static void Frame_map(connection_t *conn, player_t *pl)
                          world->cannon[i].clk_pos.cx,
                          world->cannon[i].clk_pos.cy))
         {
-            if (BIT(world->cannon[i].conn_mask, conn_bit) == 0)
+            if (!Conn_mask_test(&world->cannon[i].conn_mask, conn->conn_index))
             {
                 Send_cannon(conn, i, world->cannon[i].dead_time);
                 pl->last_cannon_update = i;
@@ -618,7 +688,7 @@ static void Frame_map(connection_t *conn, player_t *pl)
     {
         if (++i >= world->NumFuels)
             i = 0;
-        if (BIT(world->fuel[i].conn_mask, conn_bit) == 0)
+        if (!Conn_mask_test(&world->fuel[i].conn_mask, conn->conn_index))
         {
             if (world->block[world->fuel[i].blk_pos.x]
                             [world->fuel[i].blk_pos.y] == FUEL)
@@ -747,25 +817,34 @@ static void Frame_shots(connection_t *conn, int ind)
 {
     player_t *pl = PlayersArray[ind];
     int x, y, cx, cy;
-    int i, k, color;
+    int i, k, s, color;
     int fuzz = 0, teamshot, len;
-    int obj_count;
+    int obj_count, num_spans;
     object_t *shot;
-    object_t **obj_list;
+    cell_span_t *spans;
+    /* running object count at the end of each span. */
+    static thread_local std::vector<int> span_end;
     int hori_blocks, vert_blocks;
 
     hori_blocks = (view_width + (BLOCK_SZ - 1)) / (2 * BLOCK_SZ);
     vert_blocks = (view_height + (BLOCK_SZ - 1)) / (2 * BLOCK_SZ);
-    Cell_get_objects(pl->pos.cx, pl->pos.cy,
-                     MAX(hori_blocks, vert_blocks), num_object_shuffle,
-                     &obj_list,
-                     &obj_count);
+    num_spans = Cell_get_spans(pl->pos.cx, pl->pos.cy,
+                               MAX(hori_blocks, vert_blocks), num_object_shuffle,
+                               &spans);
+    span_end.resize(num_spans);
+    obj_count = 0;
+    for (s = 0; s < num_spans; s++)
+    {
+        obj_count += spans[s].num;
+        span_end[s] = obj_count;
+    }
     for (k = 0; k < num_object_shuffle; k++)
     {
         i = object_shuffle_ptr[k];
         if (i >= obj_count)
             continue;
-        shot = obj_list[i];
+        s = std::upper_bound(span_end.begin(), span_end.end(), i) - span_end.begin();
+        shot = spans[s].objs[spans[s].num - (span_end[s] - i)];
         x = shot->pos.x;
         y = shot->pos.y;
         cx = shot->pos.cx;
@@ -783,7 +862,7 @@ static void Frame_shots(connection_t *conn, int ind)
         case OBJ_SPARK:
         case OBJ_DEBRIS:
             if ((fuzz >>= 7) < 0x40)
-                fuzz = randomMT();
+                fuzz = Frame_random();
             if ((fuzz & 0x7F) >= spark_rand)
                 /*
                  * produce a sparkling effect by not displaying
@@ -906,7 +985,7 @@ static void Frame_shots(connection_t *conn, int ind)
                 if (confused)
                 {
                     id = 0;
-                    laid_by_team = (rfrac() < 0.5f);
+                    laid_by_team = (Frame_rfrac() < 0.5f);
                 }
             }
             Send_mine(conn, x, y, laid_by_team, id);
@@ -918,7 +997,7 @@ static void Frame_shots(connection_t *conn, int ind)
             int item_type = shot->info;
 
             if (BIT(shot->status, RANDOM_ITEM))
-                item_type = Choose_random_item();
+                item_type = Choose_item_by_fraction(Frame_rfrac());
 
             Send_item(conn, x, y, item_type);
         }
@@ -1109,14 +1188,19 @@ static void Frame_ships(connection_t *conn, int ind)
     }
 }
 
-static void Frame_radar(connection_t *conn, int ind)
+/*
+ * Collect what may show up on the radar this frame.  This is the
+ * same for every viewer, so it is done once per frame and
+ * Frame_radar() only picks out what each player gets to see.
+ */
+static void Frame_radar_snapshot(void)
 {
-    int i, k, mask, shownuke, size;
-    player_t *pl = PlayersArray[ind];
+    int i, mask, shownuke, size;
     object_t *shot;
-    int cx, cy;
+    radar_object_t *ro;
 
-    Frame_radar_buffer_reset();
+    num_radar_objects = 0;
+    num_radar_players = 0;
 
 #ifndef NO_SMART_MIS_RADAR
     if (options.nukesOnRadar)
@@ -1167,32 +1251,62 @@ static void Frame_radar(connection_t *conn, int ind)
                     continue;
             }
 
-            if (Wrap_length(pl->pos.cx - shot->pos.cx,
-                            pl->pos.cy - shot->pos.cy) /
+            EXPAND(radar_objects, num_radar_objects, max_radar_objects,
+                   radar_object_t, 1);
+            ro = &radar_objects[num_radar_objects++];
+            ro->cx = shot->pos.cx;
+            ro->cy = shot->pos.cy;
+            ro->size = size;
+        }
+    }
+#endif
+
+    for (i = 0; i < num_player_shuffle; i++)
+    {
+        if (BIT(PlayersArray[player_shuffle_ptr[i]]->status, PLAYING | PAUSE | GAME_OVER) != PLAYING)
+            continue;
+        EXPAND(radar_players, num_radar_players, max_radar_players, int, 1);
+        radar_players[num_radar_players++] = player_shuffle_ptr[i];
+    }
+}
+
+static void Frame_radar(connection_t *conn, int ind)
+{
+    int i, k, size;
+    player_t *pl = PlayersArray[ind];
+    radar_object_t *ro;
+
+    Frame_radar_buffer_reset();
+
+    if (conn->frame_thin < THIN_RADAR)
+    {
+        for (k = 0; k < num_radar_objects; k++)
+        {
+            ro = &radar_objects[k];
+            if (Wrap_length(pl->pos.cx - ro->cx,
+                            pl->pos.cy - ro->cy) /
                     CLICK <=
                 pl->sensor_range)
-                Frame_radar_buffer_add(shot->pos.cx, shot->pos.cy, size);
+                Frame_radar_buffer_add(ro->cx, ro->cy, ro->size);
         }
     }
-#endif
 
     if (options.playersOnRadar ||
         BIT(world->rules->mode, TEAM_PLAY) ||
         NumPseudoPlayers > 0 ||
         NumAlliances > 0)
     {
-        for (k = 0; k < num_player_shuffle; k++)
+        for (k = 0; k < num_radar_players; k++)
         {
-            i = player_shuffle_ptr[k];
+            i = radar_players[k];
             /*
              * Don't show on the radar:
              *                Ourselves (not necessarily same as who we watch).
-             *                People who are not playing.
+             *                People who are not playing (left out of the snapshot).
              *                People in other teams or alliances if;
              *                        no playersOnRadar or if not visible
              */
             if (PlayersArray[i]->conn == conn ||
-                BIT(PlayersArray[i]->status, PLAYING | PAUSE | GAME_OVER) != PLAYING ||
                 (!Players_are_teammates(pl, PlayersArray[i]) && !Players_are_allies(pl, PlayersArray[i]) && !Player_owns_tank(pl, PlayersArray[i]) && (!options.playersOnRadar || !pl->visibility[i].canSee)))
                 continue;
             if (BIT(world->rules->mode, LIMITED_VISIBILITY) && Wrap_length(pl->pos.cx - PlayersArray[i]->pos.cx,
@@ -1251,6 +1365,11 @@ static void Frame_parameters(connection_t *conn, player_t *pl)
             pv.realWorld.y -= world->height;
     }
 
+    if (conn->frame_thin >= THIN_DEBRIS)
+        spark_rand = 0;
+    else if (conn->frame_thin >= THIN_SPARKS)
+        spark_rand /= 2;
+
     view_click_width = PIXEL_TO_CLICK(view_width);
     view_click_height = PIXEL_TO_CLICK(view_height);
 
@@ -1270,12 +1389,293 @@ static void Frame_parameters(connection_t *conn, player_t *pl)
     }
 }
 
-void Frame_update(void)
+/*
+ * Build the frame for one job, everything except the end of frame.
+ */
+static void Frame_build(frame_job_t *job)
+{
+    connection_t *conn = job->conn;
+    int ind = job->ind;
+    player_t *pl2 = PlayersArray[ind];
+    uint64_t start = Profile_start();
+
+    Frame_rand_seed(conn);
+    if (pl2->damaged > 0)
+        Send_damaged(conn, pl2->damaged);
+    else
+    {
+        Frame_parameters(conn, pl2);
+        if (Frame_status(conn, ind) <= 0)
+            job->end_frame = false;
+        else
+        {
+            Frame_map(conn, pl2);
+            Frame_ships(conn, ind);
+            Frame_shots(conn, ind);
+            Frame_radar(conn, ind);
+            Frame_lose_item_state(job->i);
+            debris_end(conn);
+            fastshot_end(conn);
+        }
+    }
+    job->build_time = start ? Profile_now() - start : 0;
+}
+
+/*
+ * Build the frames of all jobs that look through the eyes of the same
+ * player.  These update that player's lock and map state, so they have
+ * to be done in order by a single thread.
+ */
+static void Frame_build_group(int group, void *arg)
+{
+    int k;
+
+    UNUSED_PARAM(arg);
+    for (k = frame_group_start[group]; k < frame_group_start[group + 1]; k++)
+        Frame_build(&frame_jobs[frame_group_jobs[k]]);
+
+    Frame_radar_buffer_free();
+}
+
+/*
+ * Sort the jobs by the player whose view they send.
+ * Returns the number of groups.
+ */
+static int Frame_group_jobs(void)
+{
+    int i, k, num_groups;
+    int *count;
+
+    if (max_frame_groups < NumPlayers + 2)
+    {
+        XFREE(frame_group_jobs);
+        XFREE(frame_group_start);
+        max_frame_groups = NumPlayers + 2;
+        frame_group_jobs = XMALLOC(int, max_frame_groups);
+        frame_group_start = XMALLOC(int, max_frame_groups);
+        if (frame_group_jobs == NULL || frame_group_start == NULL)
+        {
+            error("No memory for frame groups");
+            XFREE(frame_group_jobs);
+            XFREE(frame_group_start);
+            max_frame_groups = 0;
+            return -1;
+        }
+    }
+
+    /* counting sort on ind, stable so each group keeps the job order. */
+    count = frame_group_start;
+    memset(count, 0, (NumPlayers + 1) * sizeof(int));
+    for (k = 0; k < num_frame_jobs; k++)
+        count[frame_jobs[k].ind + 1]++;
+    for (i = 0; i < NumPlayers; i++)
+        count[i + 1] += count[i];
+    for (k = 0; k < num_frame_jobs; k++)
+        frame_group_jobs[count[frame_jobs[k].ind]++] = k;
+
+    num_groups = 0;
+    for (k = 0; k < num_frame_jobs; k++)
+    {
+        if (k == 0 || frame_jobs[frame_group_jobs[k]].ind != frame_jobs[frame_group_jobs[k - 1]].ind)
+            frame_group_start[num_groups++] = k;
+    }
+    frame_group_start[num_groups] = num_frame_jobs;
+
+    return num_groups;
+}
+
+/*
+ * Find out whether a connection is congested: it has overdrawn its
+ * byte budget, reliable data to it had to be retransmitted, or its
+ * roundtrip time has grown well above the lowest one seen.
+ * The thinning of its frames goes up a step at a time while it is,
+ * and back down a step for every second it isn't.
+ */
+static void Frame_congestion(connection_t *conn)
+{
+    int rate = options.clientByteRate;
+    bool congested = false;
+
+    if (rate > 0)
+    {
+        conn->byte_credit += (long)rate * (frame_loops - conn->budget_loops) / FPS;
+        conn->byte_credit -= conn->bytes_sent - conn->budget_bytes_sent;
+        if (conn->byte_credit > rate / 4)
+            conn->byte_credit = rate / 4;
+        conn->budget_loops = frame_loops;
+        conn->budget_bytes_sent = conn->bytes_sent;
+        if (conn->byte_credit < 0)
+            congested = true;
+    }
+    if (!options.adaptiveFrames)
+    {
+        conn->frame_thin = THIN_NONE;
+        return;
+    }
+    if (conn->rtt_timeouts > 0)
+        congested = true;
+    if (conn->rtt_min > 0 && (conn->rtt_smoothed >> 3) > 2 * conn->rtt_min + 2)
+        congested = true;
+
+    if (congested)
+    {
+        conn->congested_loops = frame_loops;
+        if (conn->frame_thin < THIN_FRAMES && frame_loops - conn->thin_loops >= FPS / 4)
+        {
+            conn->frame_thin++;
+            conn->thin_loops = frame_loops;
+        }
+    }
+    else if (conn->frame_thin > THIN_NONE && frame_loops - conn->congested_loops >= FPS && frame_loops - conn->thin_loops >= FPS)
+    {
+        conn->frame_thin--;
+        conn->thin_loops = frame_loops;
+    }
+}
+
+/*
+ * Whether a connection gets a frame this time.  The frames are
+ * spread evenly over the second to honour the player's own frame
+ * rate, and dropped when the connection is congested badly.
+ */
+static bool Frame_due(connection_t *conn, player_t *pl)
+{
+    bool halved = (conn->frame_thin >= THIN_FRAMES);
+
+    conn->fps_credit += halved ? pl->player_fps / 2 : pl->player_fps;
+    if (conn->fps_credit > FPS)
+        conn->fps_credit = FPS;
+    if (conn->fps_credit < FPS)
+    {
+        if (halved)
+            shaping.skipped_thin++;
+        else
+            shaping.skipped_fps++;
+        return false;
+    }
+    conn->fps_credit -= FPS;
+
+    if (options.clientByteRate > 0 && conn->byte_credit < -options.clientByteRate / 4)
+    {
+        shaping.skipped_thin++;
+        return false;
+    }
+    shaping.frames++;
+    if (conn->frame_thin > THIN_NONE)
+        shaping.thinned++;
+    return true;
+}
+
+void Frame_get_shaping_stats(frame_shaping_stats_t *stats)
+{
+    *stats = shaping;
+}
+
+/*
+ * Decide which connections get a frame this time
+ * and send the start of their frames.
+ */
+static void Frame_collect_jobs(time_t newTimeLeft, time_t oldTimeLeft)
 {
     int i,
         ind;
     connection_t *conn;
-    player_t *pl, *pl2;
+    player_t *pl;
+    bool restart;
+
+    do
+    {
+        restart = false;
+        num_frame_jobs = 0;
+        for (i = 0; i < num_player_shuffle && i < NumPlayers; i++)
+        {
+            pl = PlayersArray[i];
+            conn = pl->conn;
+            if (conn == NULL)
+                continue;
+            Frame_congestion(conn);
+            if (BIT(pl->status, PAUSE | GAME_OVER) && !options.allowViewing && !pl->isowner)
+            {
+                /*
+                 * Lower the frame rate for non-playing players
+                 * to reduce network load.
+                 * Owner always gets full framerate even if paused.
+                 * With allowViewing on, everyone gets full framerate.
+                 */
+                if (BIT(pl->status, PAUSE))
+                {
+                    if (frame_loops & 0x03)
+                        continue;
+                }
+                else
+                {
+                    if (frame_loops & 0x01)
+                        continue;
+                }
+            }
+
+            /*
+             * Reduce frame rate to player's own rate.
+             */
+            if (!Frame_due(conn, pl))
+                continue;
+
+            if (Send_start_of_frame(conn) == -1)
+            {
+                /*
+                 * If the connection was destroyed the players have
+                 * been renumbered, so start over.
+                 */
+                if (conn->state == CONN_FREE)
+                {
+                    restart = true;
+                    break;
+                }
+                continue;
+            }
+            if (newTimeLeft != oldTimeLeft)
+                Send_time_left(conn, newTimeLeft);
+            else if (options.maxRoundTime > 0 && roundtime >= 0)
+                Send_time_left(conn, (roundtime + FPS - 1) / FPS);
+            /*
+             * If status is GAME_OVER or PAUSE'd, the user may look through the
+             * other players 'eyes'.  If PAUSE'd this only works on team members.
+             * We can't use Players_are_teammates() macro as PAUSE'd players are always on
+             * equivalent teams.
+             *
+             * This is done by using two indexes, one
+             * determining which data should be used (ind, set below) and
+             * one determining which connection to send it to (conn).
+             */
+            if (BIT(pl->lock.tagged, LOCK_PLAYER))
+            {
+                if ((BIT(pl->status, (GAME_OVER | PLAYING)) == (GAME_OVER | PLAYING)) ||
+                    (BIT(pl->status, PAUSE) &&
+                     ((BIT(world->rules->mode, TEAM_PLAY) && pl->team != TEAM_NOT_SET && pl->team == PlayersArray[GetInd[pl->lock.pl_id]]->team) ||
+                      pl->isowner ||
+                      options.allowViewing)))
+                    ind = GetInd[pl->lock.pl_id];
+                else
+                    ind = i;
+            }
+            else
+                ind = i;
+
+            EXPAND(frame_jobs, num_frame_jobs, max_frame_jobs, frame_job_t, 1);
+            frame_jobs[num_frame_jobs].conn = conn;
+            frame_jobs[num_frame_jobs].i = i;
+            frame_jobs[num_frame_jobs].ind = ind;
+            frame_jobs[num_frame_jobs].end_frame = true;
+            frame_jobs[num_frame_jobs].build_time = 0;
+            num_frame_jobs++;
+        }
+    } while (restart);
+}
+
+void Frame_update(void)
+{
+    int k,
+        num_groups = -1;
     time_t newTimeLeft = 0;
     static time_t oldTimeLeft;
     static bool game_over_called = false;
@@ -1284,6 +1684,7 @@ void Frame_update(void)
         frame_loops = 1;
 
     Frame_shuffle();
+    frame_seed = randomMT();
 
     if (options.gameDuration > 0.0 && game_over_called == false && oldTimeLeft != (newTimeLeft = gameOverTime - time(NULL)))
     {
@@ -1298,91 +1699,56 @@ void Frame_update(void)
         }
     }
 
-    for (i = 0; i < num_player_shuffle; i++)
-    {
-        pl = PlayersArray[i];
-        conn = pl->conn;
-        if (conn == NULL)
-            continue;
-        if (BIT(pl->status, PAUSE | GAME_OVER) && !options.allowViewing && !pl->isowner)
-        {
-            /*
-             * Lower the frame rate for non-playing players
-             * to reduce network load.
-             * Owner always gets full framerate even if paused.
-             * With allowViewing on, everyone gets full framerate.
-             */
-            if (BIT(pl->status, PAUSE))
-            {
-                if (frame_loops & 0x03)
-                    continue;
-            }
-            else
-            {
-                if (frame_loops & 0x01)
-                    continue;
-            }
-        }
+    Frame_collect_jobs(newTimeLeft, oldTimeLeft);
+    oldTimeLeft = newTimeLeft;
 
-        /*
-         * Reduce frame rate to player's own rate.
-         */
-        // if (... TODO...)
-        // {
-        //     continue;
-        // }
+    /* the object grid is shared by all frames, sort it only once. */
+    Cell_update();
+    if (num_frame_jobs > 0)
+        Frame_radar_snapshot();
 
-        if (Send_start_of_frame(conn) == -1)
-            continue;
-        if (newTimeLeft != oldTimeLeft)
-            Send_time_left(conn, newTimeLeft);
-        else if (options.maxRoundTime > 0 && roundtime >= 0)
-            Send_time_left(conn, (roundtime + FPS - 1) / FPS);
-        /*
-         * If status is GAME_OVER or PAUSE'd, the user may look through the
-         * other players 'eyes'.  If PAUSE'd this only works on team members.
-         * We can't use Players_are_teammates() macro as PAUSE'd players are always on
-         * equivalent teams.
-         *
-         * This is done by using two indexes, one
-         * determining which data should be used (ind, set below) and
-         * one determining which connection to send it to (conn).
-         */
-        if (BIT(pl->lock.tagged, LOCK_PLAYER))
-        {
-            if ((BIT(pl->status, (GAME_OVER | PLAYING)) == (GAME_OVER | PLAYING)) ||
-                (BIT(pl->status, PAUSE) &&
-                 ((BIT(world->rules->mode, TEAM_PLAY) && pl->team != TEAM_NOT_SET && pl->team == PlayersArray[GetInd[pl->lock.pl_id]]->team) ||
-                  pl->isowner ||
-                  options.allowViewing)))
-                ind = GetInd[pl->lock.pl_id];
-            else
-                ind = i;
-        }
-        else
-            ind = i;
-        pl2 = PlayersArray[ind];
-        if (pl2->damaged > 0)
-            Send_damaged(conn, pl2->damaged);
-        else
-        {
-            Frame_parameters(conn, pl2);
-            if (Frame_status(conn, ind) <= 0)
-                continue;
-            Frame_map(conn, pl2);
-            Frame_ships(conn, ind);
-            Frame_shots(conn, ind);
-            Frame_radar(conn, ind);
-            Frame_lose_item_state(i);
-            debris_end(conn);
-            fastshot_end(conn);
-        }
-        sound_play_queued(PlayersArray[ind]);
-        Send_end_of_frame(conn);
+    /*
+     * Building the frames only reads the game state, apart from
+     * some per player state which Frame_group_jobs() keeps on one
+     * thread, so it can be spread over frameThreads threads.
+     * The result is the same as when building them one by one.
+     */
+    if (options.frameThreads > 1 && num_frame_jobs > 1)
+        num_groups = Frame_group_jobs();
+    if (num_groups > 0)
+        Threadpool_run(options.frameThreads, num_groups,
+                       Frame_build_group, NULL);
+    else
+    {
+        for (k = 0; k < num_frame_jobs; k++)
+            Frame_build(&frame_jobs[k]);
+        Frame_radar_buffer_free();
     }
-    oldTimeLeft = newTimeLeft;
 
-    Frame_radar_buffer_free();
+    /*
+     * Sending may destroy connections, so do it afterwards in order.
+     */
+    for (k = 0; k < num_frame_jobs; k++)
+    {
+        if (frame_jobs[k].build_time)
+            Profile_add(PROFILE_FRAME_CONN, frame_jobs[k].build_time);
+#ifdef SOUND
+        if (frame_jobs[k].end_frame)
+            sound_play_queued(PlayersArray[frame_jobs[k].ind]);
+#endif
+    }
+    /*
+     * The datagrams are collected and sent in one go, those for
+     * the same socket with one system call where possible.
+     */
+    if (options.batchSend)
+        Sockbuf_batch_begin();
+    for (k = 0; k < num_frame_jobs; k++)
+    {
+        if (frame_jobs[k].end_frame)
+            Send_end_of_frame(frame_jobs[k].conn);
+    }
+    Send_frames_flush();
 }
 
 void Set_message(const char *message)
@@ -123,6 +123,15 @@ void Item_damage(int ind, double prob)
 }
 
 int Choose_random_item(void)
+{
+    return Choose_item_by_fraction(rfrac());
+}
+
+/*
+ * Choose an item type according to the item probabilities,
+ * frac being a random value in the range [0, 1).
+ */
+int Choose_item_by_fraction(double frac)
 {
     int i;
     double item_prob_sum = 0;
@@ -132,7 +141,7 @@ int Choose_random_item(void)
 
     if (item_prob_sum > 0.0)
     {
-        double sum = item_prob_sum * rfrac();
+        double sum = item_prob_sum * frac;
 
         for (i = 0; i < NUM_ITEMS; i++)
         {
@@ -702,7 +711,7 @@ void Do_general_transporter(player_t *pl, int cx, int cy, int target,
         sound_play_sensors(cx, cy, TRANSPORTER_SUCCESS_SOUND);
         if (NumTransporters < MAX_TOTAL_TRANSPORTERS)
         {
-            Transporters[NumTransporters] = (trans_t *)malloc(sizeof(trans_t));
+            Transporters[NumTransporters] = Transporter_allocate();
             if (Transporters[NumTransporters] != NULL)
             {
                 Transporters[NumTransporters]->clk_pos.cx = cx;
@@ -985,7 +994,7 @@ void Fire_general_ecm(int ind, unsigned short team, int cx, int cy)
 
     if (NumEcms >= MAX_TOTAL_ECMS)
         return;
-    Ecms[NumEcms] = (ecm_t *)malloc(sizeof(ecm_t));
+    Ecms[NumEcms] = Ecm_allocate();
     if (Ecms[NumEcms] == NULL)
         return;
     ecm = Ecms[NumEcms];
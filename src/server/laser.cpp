@@ -87,7 +87,7 @@ static void Laser_pulse_destroy_one(int pulse_index)
         pl->num_pulses--;
     }
 
-    free(pulse_ptr);
+    Pulse_free(pulse_ptr);
 
     if (--NumPulses > pulse_index)
     {
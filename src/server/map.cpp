@@ -30,6 +30,7 @@
 #include <sys/stat.h>
 #include <sys/file.h>
 
+#include "commonmacros.h"
 #include "strlcpy.h"
 
 #include "server.h"
@@ -42,6 +43,8 @@
 #include "bit.h"
 #include "xperror.h"
 #include "xpmath.h"
+#include "mapindex.h"
+#include "navigate.h"
 
 #define GRAV_RANGE 10
 
@@ -159,6 +162,8 @@ void Free_map(void)
         free(world->asteroidConcs);
         world->asteroidConcs = NULL;
     }
+    Free_map_index();
+    Free_navigation();
 }
 
 static void Alloc_map(void)
@@ -628,7 +633,7 @@ bool Grok_map(void)
                     world->cannon[world->NumCannons].clk_pos.cx = cx;
                     world->cannon[world->NumCannons].clk_pos.cy = (y + 0.333) * BLOCK_CLICKS;
                     world->cannon[world->NumCannons].dead_time = 0;
-                    world->cannon[world->NumCannons].conn_mask = (unsigned)-1;
+                    Conn_mask_set_all(&world->cannon[world->NumCannons].conn_mask);
                     world->cannon[world->NumCannons].team = TEAM_NOT_SET;
                     Cannon_init(world->NumCannons);
                     world->NumCannons++;
@@ -644,7 +649,7 @@ bool Grok_map(void)
                     world->cannon[world->NumCannons].clk_pos.cx = (x + 0.667) * BLOCK_CLICKS;
                     world->cannon[world->NumCannons].clk_pos.cy = cy;
                     world->cannon[world->NumCannons].dead_time = 0;
-                    world->cannon[world->NumCannons].conn_mask = (unsigned)-1;
+                    Conn_mask_set_all(&world->cannon[world->NumCannons].conn_mask);
                     world->cannon[world->NumCannons].team = TEAM_NOT_SET;
                     Cannon_init(world->NumCannons);
                     world->NumCannons++;
@@ -660,7 +665,7 @@ bool Grok_map(void)
                     world->cannon[world->NumCannons].clk_pos.cx = (x + 0.333) * BLOCK_CLICKS;
                     world->cannon[world->NumCannons].clk_pos.cy = cy;
                     world->cannon[world->NumCannons].dead_time = 0;
-                    world->cannon[world->NumCannons].conn_mask = (unsigned)-1;
+                    Conn_mask_set_all(&world->cannon[world->NumCannons].conn_mask);
                     world->cannon[world->NumCannons].team = TEAM_NOT_SET;
                     Cannon_init(world->NumCannons);
                     world->NumCannons++;
@@ -676,7 +681,7 @@ bool Grok_map(void)
                     world->cannon[world->NumCannons].clk_pos.cx = cx;
                     world->cannon[world->NumCannons].clk_pos.cy = (y + 0.667) * BLOCK_CLICKS;
                     world->cannon[world->NumCannons].dead_time = 0;
-                    world->cannon[world->NumCannons].conn_mask = (unsigned)-1;
+                    Conn_mask_set_all(&world->cannon[world->NumCannons].conn_mask);
                     world->cannon[world->NumCannons].team = TEAM_NOT_SET;
                     Cannon_init(world->NumCannons);
                     world->NumCannons++;
@@ -692,7 +697,7 @@ bool Grok_map(void)
                     world->fuel[world->NumFuels].clk_pos.cx = cx;
                     world->fuel[world->NumFuels].clk_pos.cy = cy;
                     world->fuel[world->NumFuels].fuel = START_STATION_FUEL;
-                    world->fuel[world->NumFuels].conn_mask = (unsigned)-1;
+                    Conn_mask_set_all(&world->fuel[world->NumFuels].conn_mask);
                     world->fuel[world->NumFuels].last_change = frame_loops;
                     world->fuel[world->NumFuels].team = TEAM_NOT_SET;
                     world->NumFuels++;
@@ -730,8 +735,8 @@ bool Grok_map(void)
                     world->targets[world->NumTargets].team = 0;
                     world->targets[world->NumTargets].dead_time = 0;
                     world->targets[world->NumTargets].damage = TARGET_DAMAGE;
-                    world->targets[world->NumTargets].conn_mask = (unsigned)-1;
-                    world->targets[world->NumTargets].update_mask = 0;
+                    Conn_mask_set_all(&world->targets[world->NumTargets].conn_mask);
+                    Conn_mask_clear_all(&world->targets[world->NumTargets].update_mask);
                     world->targets[world->NumTargets].last_change = frame_loops;
                     world->NumTargets++;
                     break;
@@ -1019,6 +1024,11 @@ bool Grok_map(void)
             CLR_BIT(world->rules->mode, TIMING);
         }
 
+        /*
+         * The features are all known now, index them by position.
+         */
+        Alloc_map_index();
+
         /*
          * Determine which team a treasure belongs to.
          */
@@ -1235,32 +1245,24 @@ void Find_base_direction(void)
     }
 }
 
+static bool Base_has_team(int ind, void *arg)
+{
+    UNUSED_PARAM(arg);
+    return world->base[ind].team != TEAM_NOT_SET;
+}
+
 /*
  * Return the team that is closest to this position.
  */
 unsigned short Find_closest_team(int cx, int cy)
 {
-    unsigned short team = TEAM_NOT_SET;
-    int i;
-    double closest = FLT_MAX, l;
+    int *list;
 
-    for (i = 0; i < world->NumBases; i++)
-    {
-        if (world->base[i].team == TEAM_NOT_SET)
-            continue;
-
-        l = Wrap_length(cx - world->base[i].clk_pos.cx,
-                        cy - world->base[i].clk_pos.cy) /
-            CLICK;
-
-        if (l < closest)
-        {
-            team = world->base[i].team;
-            closest = l;
-        }
-    }
+    if (Map_index_nearest(MAP_INDEX_BASE, cx, cy, 1,
+                          Base_has_team, NULL, &list) == 0)
+        return TEAM_NOT_SET;
 
-    return team;
+    return world->base[list[0]].team;
 }
 
 /*
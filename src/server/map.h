@@ -101,13 +101,55 @@
 #define DIR_LEFT (RES / 2)
 #define DIR_DOWN (3 * RES / 4)
 
+/*
+ * Upper limit on the number of simultaneous client connections.
+ * Each map object that is drawn differently depending on what a
+ * client has already seen (fuel stations, cannons, targets, polygon
+ * styles) keeps one bit per connection, indexed by conn_index.
+ */
+#define MAX_CONNECTIONS 256
+#define CONN_MASK_WORDS ((MAX_CONNECTIONS + 63) / 64)
+
+typedef struct
+{
+    uint64_t bits[CONN_MASK_WORDS];
+} conn_mask_t;
+
+static inline void Conn_mask_set(conn_mask_t *mask, int conn_index)
+{
+    mask->bits[conn_index >> 6] |= (uint64_t)1 << (conn_index & 63);
+}
+
+static inline void Conn_mask_clear(conn_mask_t *mask, int conn_index)
+{
+    mask->bits[conn_index >> 6] &= ~((uint64_t)1 << (conn_index & 63));
+}
+
+static inline bool Conn_mask_test(const conn_mask_t *mask, int conn_index)
+{
+    return (mask->bits[conn_index >> 6] >> (conn_index & 63)) & 1;
+}
+
+/* Forget all connections, e.g. when the object changes state. */
+static inline void Conn_mask_clear_all(conn_mask_t *mask)
+{
+    for (int i = 0; i < CONN_MASK_WORDS; i++)
+        mask->bits[i] = 0;
+}
+
+static inline void Conn_mask_set_all(conn_mask_t *mask)
+{
+    for (int i = 0; i < CONN_MASK_WORDS; i++)
+        mask->bits[i] = ~(uint64_t)0;
+}
+
 typedef struct
 {
     ipos_t blk_pos;
     position_t pix_pos;
     clpos_t clk_pos;
     long fuel;
-    unsigned conn_mask;
+    conn_mask_t conn_mask;
     long last_change;
     int team;
 } fuel_t;
@@ -140,7 +182,7 @@ typedef struct
     clpos_t clk_pos;
     int dir;
     int dead_time;
-    unsigned conn_mask;
+    conn_mask_t conn_mask;
     long last_change;
     int item[NUM_ITEMS];
     int damaged;
@@ -210,8 +252,8 @@ typedef struct
     unsigned short team;
     int dead_time;
     int damage;
-    unsigned conn_mask;
-    unsigned update_mask;
+    conn_mask_t conn_mask;
+    conn_mask_t update_mask;
     long last_change;
 } target_t;
 
@@ -0,0 +1,323 @@
+/*
+ * XPilot, a multiplayer gravity war game.  Copyright (C) 1991-2001 by
+ *
+ *      Bjørn Stabell
+ *      Ken Ronny Schouten
+ *      Bert Gijsbers
+ *      Dick Balaska
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <vector>
+
+#include "commonmacros.h"
+
+#include "server.h"
+
+#define SERVER
+#include "xpconfig.h"
+#include "serverconst.h"
+#include "global.h"
+#include "xperror.h"
+#include "mapindex.h"
+
+/* width and height of one index cell in blocks. */
+#define MAP_INDEX_BLOCKS 8
+
+/*
+ * One uniform grid per kind of feature.  Like the object cells this
+ * is a counting sort: the features of index cell c are
+ * items[start[c]] up to items[start[c + 1]], in ascending order
+ * because the features are sorted in array order.
+ */
+typedef struct
+{
+    int num;
+    int *start;
+    int *items;
+} map_index_t;
+
+typedef struct
+{
+    double dist;
+    int ind;
+} map_index_dist_t;
+
+static map_index_t map_index[NUM_MAP_INDICES];
+static int index_x, index_y; /* size of the grids in index cells */
+
+static ipos_t Map_index_blkpos(int kind, int i)
+{
+    switch (kind)
+    {
+    case MAP_INDEX_FUEL:
+        return world->fuel[i].blk_pos;
+    case MAP_INDEX_CANNON:
+        return world->cannon[i].blk_pos;
+    case MAP_INDEX_TARGET:
+        return world->targets[i].blk_pos;
+    case MAP_INDEX_BASE:
+        return world->base[i].blk_pos;
+    default:
+        return world->treasures[i].blk_pos;
+    }
+}
+
+static clpos_t Map_index_clkpos(int kind, int i)
+{
+    switch (kind)
+    {
+    case MAP_INDEX_FUEL:
+        return world->fuel[i].clk_pos;
+    case MAP_INDEX_CANNON:
+        return world->cannon[i].clk_pos;
+    case MAP_INDEX_TARGET:
+        return world->targets[i].clk_pos;
+    case MAP_INDEX_BASE:
+        return world->base[i].clk_pos;
+    default:
+        return world->treasures[i].clk_pos;
+    }
+}
+
+static int Map_index_count(int kind)
+{
+    switch (kind)
+    {
+    case MAP_INDEX_FUEL:
+        return world->NumFuels;
+    case MAP_INDEX_CANNON:
+        return world->NumCannons;
+    case MAP_INDEX_TARGET:
+        return world->NumTargets;
+    case MAP_INDEX_BASE:
+        return world->NumBases;
+    default:
+        return world->NumTreasures;
+    }
+}
+
+void Free_map_index(void)
+{
+    int kind;
+
+    for (kind = 0; kind < NUM_MAP_INDICES; kind++)
+    {
+        XFREE(map_index[kind].start);
+        XFREE(map_index[kind].items);
+        map_index[kind].num = 0;
+    }
+}
+
+void Alloc_map_index(void)
+{
+    int kind, i, cell, num_cells;
+    ipos_t blk;
+    map_index_t *mi;
+
+    Free_map_index();
+
+    index_x = (world->x + MAP_INDEX_BLOCKS - 1) / MAP_INDEX_BLOCKS;
+    index_y = (world->y + MAP_INDEX_BLOCKS - 1) / MAP_INDEX_BLOCKS;
+    num_cells = index_x * index_y;
+
+    for (kind = 0; kind < NUM_MAP_INDICES; kind++)
+    {
+        mi = &map_index[kind];
+        mi->num = Map_index_count(kind);
+        mi->start = XCALLOC(int, num_cells + 1);
+        mi->items = XMALLOC(int, MAX(mi->num, 1));
+        if (!mi->start || !mi->items)
+        {
+            error("No map index mem");
+            End_game();
+        }
+
+        for (i = 0; i < mi->num; i++)
+        {
+            blk = Map_index_blkpos(kind, i);
+            cell = (blk.x / MAP_INDEX_BLOCKS) * index_y + blk.y / MAP_INDEX_BLOCKS;
+            mi->start[cell + 1]++;
+        }
+        for (cell = 0; cell < num_cells; cell++)
+            mi->start[cell + 1] += mi->start[cell];
+        /* fill from the back so that each cell ends up in array order. */
+        for (i = mi->num - 1; i >= 0; i--)
+        {
+            blk = Map_index_blkpos(kind, i);
+            cell = (blk.x / MAP_INDEX_BLOCKS) * index_y + blk.y / MAP_INDEX_BLOCKS;
+            mi->items[--mi->start[cell + 1]] = i;
+        }
+        /* that left start[c + 1] at the first feature of cell c. */
+        for (cell = 0; cell < num_cells; cell++)
+            mi->start[cell] = mi->start[cell + 1];
+        mi->start[num_cells] = mi->num;
+    }
+}
+
+/*
+ * Turn the range [c - range, c + range] in clicks along one axis
+ * into at most two ranges of index cells.  The block range is found
+ * first because a feature can be anywhere in its block, then wrapped
+ * or clipped to the map.
+ */
+static int Map_index_span(int c, int range, int blocks, int cells,
+                          bool wrap, int lo[2], int hi[2])
+{
+    int blo, bhi;
+
+    blo = c - range;
+    blo = (blo >= 0) ? blo / BLOCK_CLICKS : -((BLOCK_CLICKS - 1 - blo) / BLOCK_CLICKS);
+    bhi = (c + range) / BLOCK_CLICKS;
+
+    if (!wrap)
+    {
+        blo = MAX(blo, 0);
+        bhi = MIN(bhi, blocks - 1);
+        if (blo > bhi)
+            return 0;
+        lo[0] = blo / MAP_INDEX_BLOCKS;
+        hi[0] = bhi / MAP_INDEX_BLOCKS;
+        return 1;
+    }
+
+    if (bhi - blo + 1 >= blocks)
+    {
+        lo[0] = 0;
+        hi[0] = cells - 1;
+        return 1;
+    }
+    bhi -= blo;
+    blo = ((blo % blocks) + blocks) % blocks;
+    bhi += blo;
+    if (bhi < blocks)
+    {
+        lo[0] = blo / MAP_INDEX_BLOCKS;
+        hi[0] = bhi / MAP_INDEX_BLOCKS;
+        return 1;
+    }
+    lo[0] = blo / MAP_INDEX_BLOCKS;
+    hi[0] = cells - 1;
+    lo[1] = 0;
+    hi[1] = (bhi - blocks) / MAP_INDEX_BLOCKS;
+    if (hi[1] >= lo[0])
+    {
+        /* both ends share a cell, take the whole axis once. */
+        lo[0] = 0;
+        return 1;
+    }
+    return 2;
+}
+
+static void Map_index_collect(int kind, int cx, int cy, int range,
+                              std::vector<int> &found)
+{
+    map_index_t *mi = &map_index[kind];
+    int xlo[2], xhi[2], ylo[2], yhi[2];
+    int nx, ny, i, j, x, y, k, cell;
+    bool wrap = (BIT(world->rules->mode, WRAP_PLAY) != 0);
+
+    found.clear();
+    if (mi->num == 0)
+        return;
+
+    nx = Map_index_span(cx, range, world->x, index_x, wrap, xlo, xhi);
+    ny = Map_index_span(cy, range, world->y, index_y, wrap, ylo, yhi);
+    for (i = 0; i < nx; i++)
+    {
+        for (x = xlo[i]; x <= xhi[i]; x++)
+        {
+            for (j = 0; j < ny; j++)
+            {
+                for (y = ylo[j]; y <= yhi[j]; y++)
+                {
+                    cell = x * index_y + y;
+                    for (k = mi->start[cell]; k < mi->start[cell + 1]; k++)
+                        found.push_back(mi->items[k]);
+                }
+            }
+        }
+    }
+    std::sort(found.begin(), found.end());
+}
+
+int Map_index_find(int kind, int cx, int cy, int range, int **list)
+{
+    /* one list per thread, robots may think on several threads. */
+    static thread_local std::vector<int> found;
+
+    Map_index_collect(kind, cx, cy, range, found);
+    *list = found.data();
+    return (int)found.size();
+}
+
+static bool Compare_map_index_dist(const map_index_dist_t &a,
+                                   const map_index_dist_t &b)
+{
+    if (a.dist != b.dist)
+        return a.dist < b.dist;
+    return a.ind < b.ind;
+}
+
+/*
+ * Look in ever larger squares until enough accepted features are
+ * inside the circle that fits in the square, or until the square
+ * covers the whole map.
+ */
+int Map_index_nearest(int kind, int cx, int cy, int num,
+                      bool (*accept)(int ind, void *arg), void *arg,
+                      int **list)
+{
+    static thread_local std::vector<int> found;
+    static thread_local std::vector<map_index_dist_t> near;
+    map_index_dist_t nd;
+    clpos_t pos;
+    double range;
+    size_t k;
+
+    range = MAP_INDEX_BLOCKS * BLOCK_CLICKS;
+    for (;;)
+    {
+        Map_index_collect(kind, cx, cy, (int)MIN(range, world->click_hypotenuse + 1), found);
+        near.clear();
+        for (k = 0; k < found.size(); k++)
+        {
+            if (accept && !accept(found[k], arg))
+                continue;
+            pos = Map_index_clkpos(kind, found[k]);
+            nd.dist = Wrap_length(pos.cx - cx, pos.cy - cy);
+            nd.ind = found[k];
+            if (nd.dist <= range || range > world->click_hypotenuse)
+                near.push_back(nd);
+        }
+        if ((int)near.size() >= num || range > world->click_hypotenuse)
+            break;
+        range *= 2;
+    }
+
+    std::sort(near.begin(), near.end(), Compare_map_index_dist);
+    if ((int)near.size() > num)
+        near.resize(num);
+
+    found.clear();
+    for (k = 0; k < near.size(); k++)
+        found.push_back(near[k].ind);
+    *list = found.data();
+    return (int)found.size();
+}
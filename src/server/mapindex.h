@@ -0,0 +1,65 @@
+/*
+ * XPilot, a multiplayer gravity war game.  Copyright (C) 1991-2001 by
+ *
+ *      Bjørn Stabell
+ *      Ken Ronny Schouten
+ *      Bert Gijsbers
+ *      Dick Balaska
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MAPINDEX_H
+#define MAPINDEX_H
+
+/*
+ * Grid indices over the map features that never move.
+ * They are built by Grok_map() once all features are known, and let
+ * robots, cannons and the map setup look at the features near a
+ * position instead of walking the whole feature array.
+ */
+enum
+{
+    MAP_INDEX_FUEL,
+    MAP_INDEX_CANNON,
+    MAP_INDEX_TARGET,
+    MAP_INDEX_BASE,
+    MAP_INDEX_TREASURE,
+    NUM_MAP_INDICES
+};
+
+void Free_map_index(void);
+void Alloc_map_index(void);
+
+/*
+ * Map_index_find() returns, in ascending order, the indices of all
+ * features of one kind that may be at most range clicks away from
+ * the position, taking edge wrap into account.  The list is a superset,
+ * the caller does the exact distance test.
+ *
+ * Map_index_nearest() returns the indices of at most num features
+ * accepted by the accept function, nearest first, with ties going to
+ * the lower index.  accept may be NULL to take every feature.
+ *
+ * Both return the number of indices.  The list is valid until the
+ * next query from the same thread.
+ */
+int Map_index_find(int kind, int cx, int cy, int range, int **list);
+int Map_index_nearest(int kind, int cx, int cy, int num,
+                      bool (*accept)(int ind, void *arg), void *arg,
+                      int **list);
+
+#endif
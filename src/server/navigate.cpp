@@ -0,0 +1,282 @@
+/*
+ * XPilot, a multiplayer gravity war game.  Copyright (C) 1991-2001 by
+ *
+ *      Bjørn Stabell
+ *      Ken Ronny Schouten
+ *      Bert Gijsbers
+ *      Dick Balaska
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <climits>
+#include <vector>
+
+#include "commonmacros.h"
+
+#include "server.h"
+
+#define SERVER
+#include "xpconfig.h"
+#include "serverconst.h"
+#include "global.h"
+#include "xperror.h"
+#include "walls.h"
+#include "navigate.h"
+
+/* how many blocks ahead Navigation_waypoint() looks. */
+#define NAV_LOOKAHEAD 4
+
+/* step values besides the eight directions. */
+#define NAV_GOAL 8
+#define NAV_NONE 255
+
+/* the eight directions, odd ones are diagonal. */
+static const int nav_dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+static const int nav_dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+typedef struct
+{
+    long built;          /* nav_generation the field was built in */
+    unsigned char *step; /* per block, direction of the next block */
+} nav_field_t;
+
+static nav_field_t *nav_fields[NUM_NAV_KINDS];
+static int nav_num[NUM_NAV_KINDS];
+static long nav_generation;
+
+/* scratch space for building a field. */
+static int *nav_dist;
+static unsigned char *nav_open;
+static long nav_rebuilt; /* frame_loops of the last rebuild */
+
+static int Navigation_count(int kind)
+{
+    switch (kind)
+    {
+    case NAV_FUEL:
+        return world->NumFuels;
+    default:
+        return world->NumTreasures;
+    }
+}
+
+static ipos_t Navigation_goal(int kind, int dest)
+{
+    switch (kind)
+    {
+    case NAV_FUEL:
+        return world->fuel[dest].blk_pos;
+    default:
+        return world->treasures[dest].blk_pos;
+    }
+}
+
+void Free_navigation(void)
+{
+    int kind, i;
+
+    for (kind = 0; kind < NUM_NAV_KINDS; kind++)
+    {
+        if (nav_fields[kind])
+        {
+            for (i = 0; i < nav_num[kind]; i++)
+                XFREE(nav_fields[kind][i].step);
+            XFREE(nav_fields[kind]);
+        }
+        nav_num[kind] = 0;
+    }
+    XFREE(nav_dist);
+    XFREE(nav_open);
+}
+
+void Navigation_changed(void)
+{
+    nav_generation++;
+}
+
+/*
+ * Find the block one step in direction k, taking edge wrap into
+ * account.  Returns false when that step leaves the map.
+ */
+static bool Navigation_neighbour(int x, int y, int k, int *nx, int *ny)
+{
+    x += nav_dx[k];
+    y += nav_dy[k];
+    if (!BIT(world->rules->mode, WRAP_PLAY) && (x < 0 || x >= world->x || y < 0 || y >= world->y))
+        return false;
+    *nx = WRAP_XBLOCK(x);
+    *ny = WRAP_YBLOCK(y);
+    return true;
+}
+
+/*
+ * Grow the field outwards from the destination like Walldist_init()
+ * does from the walls.  A straight step costs 2 and a diagonal one 3,
+ * so instead of one queue there is one bucket per distance modulo 4,
+ * and every block is settled the first time it comes out of a bucket.
+ * A diagonal step may not cut the corner of a wall.
+ */
+static void Navigation_build(int kind, int dest, nav_field_t *nf)
+{
+    static std::vector<int> bucket[4];
+    int num_blocks = world->x * world->y;
+    int i, k, x, y, wx, wy, w, dist, cur, pending;
+    size_t n;
+    ipos_t goal = Navigation_goal(kind, dest);
+
+    if (!nav_dist)
+    {
+        nav_dist = XMALLOC(int, num_blocks);
+        nav_open = XMALLOC(unsigned char, num_blocks);
+        if (!nav_dist || !nav_open)
+        {
+            error("No memory for navigation");
+            End_game();
+        }
+    }
+    for (x = 0; x < world->x; x++)
+    {
+        for (y = 0; y < world->y; y++)
+        {
+            i = x * world->y + y;
+            /* cannons and targets are space while they are destroyed. */
+            nav_open[i] = BIT(1U << world->block[x][y], SPACE_BLOCKS) != 0;
+            nav_dist[i] = INT_MAX;
+            nf->step[i] = NAV_NONE;
+        }
+    }
+
+    i = goal.x * world->y + goal.y;
+    nav_open[i] = 1;
+    nav_dist[i] = 0;
+    nf->step[i] = NAV_GOAL;
+    bucket[0].push_back(i);
+    pending = 1;
+
+    for (cur = 0; pending > 0; cur++)
+    {
+        std::vector<int> &b = bucket[cur & 3];
+
+        for (n = 0; n < b.size(); n++)
+        {
+            i = b[n];
+            pending--;
+            if (nav_dist[i] != cur)
+                continue; /* found a shorter way to it already */
+            x = i / world->y;
+            y = i % world->y;
+
+            for (k = 0; k < 8; k++)
+            {
+                if (!Navigation_neighbour(x, y, k, &wx, &wy))
+                    continue;
+                w = wx * world->y + wy;
+                if (!nav_open[w])
+                    continue;
+                if (k & 1)
+                {
+                    /* both blocks beside the diagonal must be open. */
+                    if (!nav_open[wx * world->y + y] || !nav_open[x * world->y + wy])
+                        continue;
+                    dist = cur + 3;
+                }
+                else
+                {
+                    dist = cur + 2;
+                }
+                if (dist >= nav_dist[w])
+                    continue;
+                nav_dist[w] = dist;
+                /* the way back is the opposite direction. */
+                nf->step[w] = (unsigned char)((k + 4) & 7);
+                bucket[dist & 3].push_back(w);
+                pending++;
+            }
+        }
+        b.clear();
+    }
+    nf->built = nav_generation;
+}
+
+static nav_field_t *Navigation_field(int kind, int dest)
+{
+    nav_field_t *nf;
+
+    if (!nav_fields[kind])
+    {
+        nav_num[kind] = Navigation_count(kind);
+        if (nav_num[kind] == 0)
+            return NULL;
+        nav_fields[kind] = XCALLOC(nav_field_t, nav_num[kind]);
+        if (!nav_fields[kind])
+        {
+            error("No memory for navigation");
+            End_game();
+        }
+    }
+    if (dest < 0 || dest >= nav_num[kind])
+        return NULL;
+
+    nf = &nav_fields[kind][dest];
+    if (!nf->step)
+    {
+        nf->step = XMALLOC(unsigned char, world->x * world->y);
+        if (!nf->step)
+        {
+            error("No memory for navigation");
+            End_game();
+        }
+        Navigation_build(kind, dest, nf);
+    }
+    else if (nf->built != nav_generation && nav_rebuilt != frame_loops)
+    {
+        /* one out of date field per frame, the others can wait. */
+        Navigation_build(kind, dest, nf);
+        nav_rebuilt = frame_loops;
+    }
+    return nf;
+}
+
+bool Navigation_waypoint(int kind, int dest, int bx, int by, ipos_t *wp)
+{
+    nav_field_t *nf;
+    int i, step, nx, ny;
+
+    if (bx < 0 || bx >= world->x || by < 0 || by >= world->y)
+        return false;
+    nf = Navigation_field(kind, dest);
+    if (!nf)
+        return false;
+
+    for (i = 0; i < NAV_LOOKAHEAD; i++)
+    {
+        step = nf->step[bx * world->y + by];
+        if (step == NAV_NONE || step == NAV_GOAL)
+            break;
+        Navigation_neighbour(bx, by, step, &nx, &ny);
+        if (nf->step[nx * world->y + ny] == NAV_GOAL)
+            break;
+        bx = nx;
+        by = ny;
+    }
+    if (i == 0)
+        return false;
+    wp->x = bx;
+    wp->y = by;
+    return true;
+}
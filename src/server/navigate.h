@@ -0,0 +1,58 @@
+/*
+ * XPilot, a multiplayer gravity war game.  Copyright (C) 1991-2001 by
+ *
+ *      Bjørn Stabell
+ *      Ken Ronny Schouten
+ *      Bert Gijsbers
+ *      Dick Balaska
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef NAVIGATE_H
+#define NAVIGATE_H
+
+/*
+ * Flow fields for robot navigation.  For every fuel station and
+ * treasure there is one byte per map block telling which of the eight
+ * neighbouring blocks is the next step along the shortest way around
+ * the walls.
+ * A field is built the first time a robot asks for it.  When cannons
+ * or targets have been destroyed or come back since, it is built again,
+ * though no more than one such field per frame.
+ */
+enum
+{
+    NAV_FUEL,
+    NAV_TREASURE,
+    NUM_NAV_KINDS
+};
+
+void Free_navigation(void);
+void Navigation_changed(void);
+
+/*
+ * Navigation_waypoint() follows the field of destination dest of the
+ * given kind a few blocks from block position (bx, by) and stores the
+ * block reached in wp.  It returns false if the destination can not be
+ * reached from there or is right next to it.
+ *
+ * Fields are cached without locking, so only call this from code that
+ * runs on the main thread, like the robot play functions.
+ */
+bool Navigation_waypoint(int kind, int dest, int bx, int by, ipos_t *wp);
+
+#endif
@@ -106,6 +106,12 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netdb.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "commonmacros.h"
 #include "const.h"
@@ -136,7 +142,6 @@
 #include "score.h"
 #include "polygon.h"
 
-#define MAX_SELECT_FD (sizeof(int) * 8 - 1)
 #define MAX_RELIABLE_DATA_PACKET_SIZE 1024
 
 #define MAX_MOTD_CHUNK 512
@@ -146,6 +151,7 @@
 static connection_t *Conn = NULL;
 static setup_t *Setup = NULL;
 static setup_t *Oldsetup = NULL;
+static setup_blob_t *Setup_blobs[SETUP_MAP_ZSTD + 1];
 static int max_connections = 0;
 static int (*playing_receive[256])(connection_t *connp),
     (*login_receive[256])(connection_t *connp),
@@ -155,6 +161,7 @@ int login_in_progress;
 static int num_logins, num_logouts;
 
 static int Compress_map(uint8_t *map, int size);
+static setup_blob_t *Compress_setup(int type, const uint8_t *map, int mapsize);
 static int Init_setup(void);
 static int Handle_listening(connection_t *connp);
 static int Handle_setup(connection_t *connp);
@@ -170,6 +177,7 @@ static int Receive_ack_cannon(connection_t *connp);
 static int Receive_ack_fuel(connection_t *connp);
 static int Receive_ack_target(connection_t *connp);
 static int Receive_ack_polystyle(connection_t *connp);
+static int Receive_ack_frame(connection_t *connp);
 static int Receive_discard(connection_t *connp);
 static int Receive_undefined(connection_t *connp);
 static int Receive_talk(connection_t *connp);
@@ -241,6 +249,8 @@ static void Feature_init(connection_t *connp)
             SET_BIT(features, F_FLOATSCORE);
         if (v >= 0x4501)
             SET_BIT(features, F_TEMPWORM);
+        if (v >= 0x4502 && options.deltaFrames)
+            SET_BIT(features, F_DELTA);
     }
     else
     {
@@ -273,6 +283,87 @@ static void Feature_init(connection_t *connp)
     return;
 }
 
+/*
+ * Allocate a setup structure holding the given map data.
+ */
+static setup_t *Make_setup(int type, const uint8_t *data, int size)
+{
+    setup_t *sp;
+
+    if ((sp = (setup_t *)malloc(sizeof(setup_t) + size)) == NULL)
+    {
+        error("No memory to hold setup");
+        return NULL;
+    }
+    memset(sp, 0, sizeof(setup_t) + size);
+    memcpy(sp->map_data, data, size);
+    sp->setup_size = ((char *)&sp->map_data[0] - (char *)sp) + size;
+    sp->map_data_len = size;
+    sp->map_order = type;
+    sp->frames_per_second = FPS;
+    sp->lives = world->rules->lives;
+    sp->mode = world->rules->mode;
+    sp->x = world->x;
+    sp->y = world->y;
+    strlcpy(sp->name, world->name, sizeof(sp->name));
+    strlcpy(sp->author, world->author, sizeof(sp->author));
+
+    return sp;
+}
+
+/*
+ * Encode the setup packet and the map data into one setup stream.
+ * The caller holds the only reference.
+ */
+static setup_blob_t *Encode_setup(setup_t *sp)
+{
+    sockbuf_t sbuf;
+    setup_blob_t *blob;
+    int len;
+
+    if (Sockbuf_init(&sbuf, (sock_t *)NULL, 1024,
+                     SOCKBUF_WRITE | SOCKBUF_LOCK) == -1)
+    {
+        error("No memory to encode setup");
+        return NULL;
+    }
+    if (Packet_write<pkt_ld,
+                     pkt_ld, pkt_hd,
+                     pkt_hd, pkt_hd,
+                     pkt_hd, pkt_hd,
+                     pkt_s, pkt_s>(&sbuf,
+                                   sp->map_data_len,
+                                   sp->mode, sp->lives,
+                                   sp->x, sp->y,
+                                   sp->frames_per_second, sp->map_order,
+                                   sp->name, sp->author) <= 0)
+    {
+        error("Cannot encode setup");
+        Sockbuf_cleanup(&sbuf);
+        return NULL;
+    }
+    len = sbuf.len + sp->map_data_len;
+    if ((blob = (setup_blob_t *)malloc(sizeof(setup_blob_t) + len)) == NULL)
+    {
+        error("No memory to hold setup");
+        Sockbuf_cleanup(&sbuf);
+        return NULL;
+    }
+    memcpy(blob->data, sbuf.buf, sbuf.len);
+    memcpy(blob->data + sbuf.len, sp->map_data, sp->map_data_len);
+    blob->refcount = 1;
+    blob->len = len;
+    Sockbuf_cleanup(&sbuf);
+
+    return blob;
+}
+
+static void Setup_blob_put(setup_blob_t *blob)
+{
+    if (blob != NULL && --blob->refcount == 0)
+        free(blob);
+}
+
 /*
  * Initialize the structure that gives the client information
  * about our setup.  Like the map and playing rules.
@@ -286,8 +377,9 @@ static int Init_setup(void)
         treasure = 0,
         target = 0,
         base = 0,
-        cannon = 0;
-    uint8_t *mapdata, *mapptr;
+        cannon = 0,
+        rawsize;
+    uint8_t *mapdata, *mapptr, *rawdata;
 
     if ((mapdata = (uint8_t *)malloc(world->x * world->y)) == NULL)
     {
@@ -502,6 +594,18 @@ static int Init_setup(void)
             }
         }
     }
+    /*
+     * Keep the plain map for the other transfer methods.
+     */
+    rawsize = world->x * world->y;
+    if ((rawdata = (uint8_t *)malloc(rawsize)) == NULL)
+    {
+        error("No memory for mapdata");
+        free(mapdata);
+        return -1;
+    }
+    memcpy(rawdata, mapdata, rawsize);
+
     if (compress_maps == 0)
     {
         type = SETUP_MAP_UNCOMPRESSED;
@@ -515,11 +619,13 @@ static int Init_setup(void)
         {
             warn("Map compression error (%d)", size);
             free(mapdata);
+            free(rawdata);
             return -1;
         }
         if ((mapdata = (uint8_t *)realloc(mapdata, size)) == NULL)
         {
             error("Cannot reallocate mapdata");
+            free(rawdata);
             return -1;
         }
     }
@@ -531,29 +637,138 @@ static int Init_setup(void)
                  100.0 * size / (world->x * world->y));
     }
 #endif
-    if ((Setup = (setup_t *)malloc(sizeof(setup_t) + size)) == NULL)
+    XFREE(Setup);
+    Setup = Make_setup(type, mapdata, size);
+    free(mapdata);
+    if (Setup == NULL)
     {
-        error("No memory to hold setup");
-        free(mapdata);
+        free(rawdata);
         return -1;
     }
-    memset(Setup, 0, sizeof(setup_t) + size);
-    memcpy(Setup->map_data, mapdata, size);
-    free(mapdata);
-    Setup->setup_size = ((char *)&Setup->map_data[0] - (char *)Setup) + size;
-    Setup->map_data_len = size;
-    Setup->map_order = type;
-    Setup->frames_per_second = FPS;
-    Setup->lives = world->rules->lives;
-    Setup->mode = world->rules->mode;
-    Setup->x = world->x;
-    Setup->y = world->y;
-    strlcpy(Setup->name, world->name, sizeof(Setup->name));
-    strlcpy(Setup->author, world->author, sizeof(Setup->author));
+
+    /*
+     * Encode the setup stream for every transfer method up front
+     * so that joining clients only get a reference to it.
+     * Connections still sending the setup of a previous map keep
+     * their own reference.
+     */
+    for (i = 0; i < NELEM(Setup_blobs); i++)
+    {
+        Setup_blob_put(Setup_blobs[i]);
+        Setup_blobs[i] = NULL;
+    }
+    Setup_blobs[type] = Encode_setup(Setup);
+    if (Setup_blobs[type] == NULL)
+    {
+        free(rawdata);
+        return -1;
+    }
+    Setup_blobs[SETUP_MAP_ZLIB] = Compress_setup(SETUP_MAP_ZLIB, rawdata, rawsize);
+    Setup_blobs[SETUP_MAP_ZSTD] = Compress_setup(SETUP_MAP_ZSTD, rawdata, rawsize);
+    free(rawdata);
 
     return 0;
 }
 
+/*
+ * Compress the map with zlib or zstd for clients which can handle it.
+ * Returns NULL if the method isn't available or doesn't beat the
+ * run length encoded map.
+ */
+static setup_blob_t *Compress_setup(int type, const uint8_t *map, int mapsize)
+{
+    uint8_t *data = NULL;
+    size_t size = 0;
+    setup_t *sp;
+    setup_blob_t *blob;
+
+    switch (type)
+    {
+#ifdef HAVE_ZLIB
+    case SETUP_MAP_ZLIB:
+    {
+        uLongf len = compressBound(mapsize);
+
+        if ((data = (uint8_t *)malloc(len)) == NULL)
+            break;
+        if (compress2(data, &len, map, mapsize,
+                      Z_BEST_COMPRESSION) != Z_OK)
+        {
+            warn("Map compression error (zlib)");
+            free(data);
+            return NULL;
+        }
+        size = len;
+        break;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case SETUP_MAP_ZSTD:
+    {
+        size_t len = ZSTD_compressBound(mapsize);
+
+        if ((data = (uint8_t *)malloc(len)) == NULL)
+            break;
+        size = ZSTD_compress(data, len, map, mapsize,
+                             ZSTD_maxCLevel());
+        if (ZSTD_isError(size))
+        {
+            warn("Map compression error (zstd: %s)", ZSTD_getErrorName(size));
+            free(data);
+            return NULL;
+        }
+        break;
+    }
+#endif
+    default:
+        return NULL;
+    }
+    if (data == NULL)
+    {
+        error("No memory for mapdata");
+        return NULL;
+    }
+    if ((long)size >= Setup->map_data_len)
+    {
+        free(data);
+        return NULL;
+    }
+#ifndef SILENT
+    xpprintf("%s Map compression ratio is %-4.2f%% (%s)\n", showtime(),
+             100.0 * size / mapsize,
+             type == SETUP_MAP_ZLIB ? "zlib" : "zstd");
+#endif
+    sp = Make_setup(type, data, size);
+    free(data);
+    if (sp == NULL)
+        return NULL;
+    blob = Encode_setup(sp);
+    free(sp);
+    return blob;
+}
+
+/*
+ * Get a reference to the smallest setup stream the client can decode
+ * from the transfer methods it announced.
+ */
+static setup_blob_t *Select_setup(int methods)
+{
+    static const int types[] = { SETUP_MAP_ZSTD, SETUP_MAP_ZLIB };
+    setup_blob_t *blob = Setup_blobs[Setup->map_order];
+    int i;
+
+    for (i = 0; i < NELEM(types); i++)
+    {
+        if ((methods & SETUP_MAP_METHOD(types[i])) && Setup_blobs[types[i]])
+        {
+            blob = Setup_blobs[types[i]];
+            break;
+        }
+    }
+    blob->refcount++;
+    return blob;
+}
+
 /*
  * Initialize the function dispatch tables for the various client
  * connection states.  Some states use the same table.
@@ -607,6 +822,7 @@ static void Init_receive(void)
     playing_receive[PKT_ACK_FUEL] = Receive_ack_fuel;
     playing_receive[PKT_ACK_TARGET] = Receive_ack_target;
     playing_receive[PKT_ACK_POLYSTYLE] = Receive_ack_polystyle;
+    playing_receive[PKT_ACK_FRAME] = Receive_ack_frame;
     playing_receive[PKT_TALK] = Receive_talk;
     playing_receive[PKT_DISPLAY] = Receive_display;
     playing_receive[PKT_MODIFIERBANK] = Receive_modifier_bank;
@@ -632,11 +848,11 @@ int Setup_net_server(void)
     }
     /*
      * The number of connections is limited by the number of bases
-     * and the max number of possible file descriptors to use in
-     * the select(2) call minus those for stdin, stdout, stderr,
-     * the contact socket, and the socket for the resolver library routines.
+     * and by the width of the per-connection bitsets kept in map
+     * objects (see conn_mask_t).  The scheduler no longer puts a
+     * limit on the file descriptors it can watch.
      */
-    max_connections = MIN(MAX_SELECT_FD - 5, world->NumBases);
+    max_connections = MIN(MAX_CONNECTIONS, world->NumBases);
     size = max_connections * sizeof(*Conn);
     if ((Conn = (connection_t *)malloc(size)) == NULL)
     {
@@ -696,7 +912,7 @@ static void Conn_set_state(connection_t *connp, int state, int drain_state)
  */
 void Destroy_connection(connection_t *connp, const char *reason)
 {
-    int id, len;
+    int id, len = 0;
     sock_t *sock;
     char pkt[MAX_CHARS];
 
@@ -707,15 +923,18 @@ void Destroy_connection(connection_t *connp, const char *reason)
     }
 
     sock = &connp->w.sock;
-    remove_input(sock->fd);
-
-    pkt[0] = PKT_QUIT;
-    strlcpy(&pkt[1], reason, sizeof(pkt) - 1);
-    len = strlen(pkt) + 1;
-    if (sock_write(sock, pkt, len) != len)
+    if (!connp->fake)
     {
-        sock_get_error(sock);
-        sock_write(sock, pkt, len);
+        remove_input(sock->fd);
+
+        pkt[0] = PKT_QUIT;
+        strlcpy(&pkt[1], reason, sizeof(pkt) - 1);
+        len = strlen(pkt) + 1;
+        if (sock_write(sock, pkt, len) != len)
+        {
+            sock_get_error(sock);
+            sock_write(sock, pkt, len);
+        }
     }
 #ifndef SILENT
     xpprintf("%s Goodbye %s=%s@%s|%s (\"%s\")\n",
@@ -746,15 +965,21 @@ void Destroy_connection(connection_t *connp, const char *reason)
     Sockbuf_cleanup(&connp->w);
     Sockbuf_cleanup(&connp->r);
     Sockbuf_cleanup(&connp->c);
+    XFREE(connp->delta);
+    Setup_blob_put(connp->setup_blob);
+    connp->setup_blob = NULL;
 
     num_logouts++;
 
-    if (sock_write(sock, pkt, len) != len)
+    if (!connp->fake)
     {
-        sock_get_error(sock);
-        sock_write(sock, pkt, len);
+        if (sock_write(sock, pkt, len) != len)
+        {
+            sock_get_error(sock);
+            sock_write(sock, pkt, len);
+        }
+        sock_close(sock);
     }
-    sock_close(sock);
 
     memset(connp, 0, sizeof(*connp));
 }
@@ -878,15 +1103,19 @@ int Setup_connection(char *user, char *nick, char *dpy, int team,
         sock_close(&sock);
         return -1;
     }
-    if (sock_set_receive_buffer_size(&sock, SERVER_RECV_SIZE + 256) == -1)
-        error("Cannot set receive buffer size to %d", SERVER_RECV_SIZE + 256);
+    /*
+     * Leave the kernel room to queue a batch of small input packets
+     * while we are busy with a tick, see Handle_input().
+     */
+    if (sock_set_receive_buffer_size(&sock, SOCKBUF_MAX_READS * SERVER_RECV_SIZE) == -1)
+        error("Cannot set receive buffer size to %d", SOCKBUF_MAX_READS * SERVER_RECV_SIZE);
     if (sock_set_send_buffer_size(&sock, SERVER_SEND_SIZE + 256) == -1)
         error("Cannot set send buffer size to %d", SERVER_SEND_SIZE + 256);
 
     Sockbuf_init(&connp->w, &sock, SERVER_SEND_SIZE,
                  SOCKBUF_WRITE | SOCKBUF_DGRAM);
 
-    Sockbuf_init(&connp->r, &sock, SERVER_RECV_SIZE,
+    Sockbuf_init(&connp->r, &sock, SOCKBUF_MAX_READS * SERVER_RECV_SIZE,
                  SOCKBUF_READ | SOCKBUF_DGRAM);
 
     Sockbuf_init(&connp->c, (sock_t *)NULL, MAX_SOCKBUF_SIZE,
@@ -914,14 +1143,29 @@ int Setup_connection(char *user, char *nick, char *dpy, int team,
     connp->rtt_smoothed = 0;
     connp->rtt_dev = 0;
     connp->rtt_timeouts = 0;
+    connp->rtt_min = 0;
     connp->acks = 0;
     connp->setup = 0;
+    connp->setup_blob = NULL;
+    connp->setup_base = 0;
     connp->motd_offset = -1;
     connp->motd_stop = 0;
     connp->view_width = DEF_VIEW_SIZE;
     connp->view_height = DEF_VIEW_SIZE;
     connp->debris_colors = 0;
     connp->spark_rand = DEF_SPARK_RAND;
+    connp->fake = false;
+    connp->bytes_sent = 0;
+    connp->delta_ack = 0;
+    connp->delta_base = 0;
+    connp->delta = NULL;
+    connp->frame_thin = THIN_NONE;
+    connp->thin_loops = 0;
+    connp->congested_loops = 0;
+    connp->fps_credit = 0;
+    connp->byte_credit = 0;
+    connp->budget_loops = 0;
+    connp->budget_bytes_sent = 0;
     Conn_set_state(connp, CONN_LISTENING, CONN_FREE);
     if (connp->w.buf == NULL || connp->r.buf == NULL || connp->c.buf == NULL || connp->user == NULL || connp->nick == NULL || connp->dpy == NULL || connp->addr == NULL || connp->host == NULL)
     {
@@ -936,15 +1180,109 @@ int Setup_connection(char *user, char *nick, char *dpy, int team,
     return my_port;
 }
 
+/*
+ * Log in a player without a client, as if it had just sent
+ * its play packet.  The frames built for it are only counted
+ * and thrown away, which lets the benchmark measure the whole
+ * frame path without any sockets.
+ * Returns the index of the connection or -1 on failure.
+ */
+int Setup_fake_connection(char *nick)
+{
+    int i;
+    connection_t *connp;
+    char errmsg[MAX_CHARS];
+
+    for (i = 0; i < max_connections; i++)
+    {
+        if (Conn[i].state == CONN_FREE)
+            break;
+    }
+    if (i >= max_connections)
+        return -1;
+
+    connp = &Conn[i];
+    connp->conn_index = i;
+    Sockbuf_init(&connp->w, (sock_t *)NULL, SERVER_SEND_SIZE,
+                 SOCKBUF_WRITE | SOCKBUF_DGRAM);
+    Sockbuf_init(&connp->r, (sock_t *)NULL, SERVER_RECV_SIZE,
+                 SOCKBUF_READ | SOCKBUF_DGRAM);
+    Sockbuf_init(&connp->c, (sock_t *)NULL, MAX_SOCKBUF_SIZE,
+                 SOCKBUF_WRITE | SOCKBUF_READ | SOCKBUF_LOCK);
+
+    connp->my_port = 0;
+    connp->user = xp_strdup(nick);
+    connp->nick = xp_strdup(nick);
+    connp->dpy = xp_strdup("");
+    connp->addr = xp_strdup("0.0.0.0");
+    connp->host = xp_strdup("localhost");
+    connp->ship = NULL;
+    connp->team = TEAM_NOT_SET;
+    connp->version = MY_VERSION;
+    connp->start = main_loops;
+    connp->magic = 0;
+    connp->id = NO_ID;
+    connp->last_key_change = 0;
+    connp->reliable_offset = 0;
+    connp->reliable_unsent = 0;
+    connp->last_send_loops = 0;
+    connp->retransmit_at_loop = 0;
+    connp->rtt_retransmit = DEFAULT_RETRANSMIT;
+    connp->rtt_smoothed = 0;
+    connp->rtt_dev = 0;
+    connp->rtt_timeouts = 0;
+    connp->rtt_min = 0;
+    connp->acks = 0;
+    connp->setup = 0;
+    connp->setup_blob = NULL;
+    connp->setup_base = 0;
+    connp->motd_offset = -1;
+    connp->motd_stop = 0;
+    connp->view_width = DEF_VIEW_SIZE;
+    connp->view_height = DEF_VIEW_SIZE;
+    connp->debris_colors = 0;
+    connp->spark_rand = DEF_SPARK_RAND;
+    connp->fake = true;
+    connp->bytes_sent = 0;
+    connp->delta_ack = 0;
+    connp->delta_base = 0;
+    connp->delta = NULL;
+    connp->frame_thin = THIN_NONE;
+    connp->thin_loops = 0;
+    connp->congested_loops = 0;
+    connp->fps_credit = 0;
+    connp->byte_credit = 0;
+    connp->budget_loops = 0;
+    connp->budget_bytes_sent = 0;
+    Conn_set_state(connp, CONN_LOGIN, CONN_PLAYING);
+    if (connp->w.buf == NULL || connp->r.buf == NULL || connp->c.buf == NULL || connp->user == NULL || connp->nick == NULL || connp->dpy == NULL || connp->addr == NULL || connp->host == NULL)
+    {
+        error("Not enough memory for connection");
+        Destroy_connection(connp, "no memory");
+        return -1;
+    }
+
+    strlcpy(errmsg, "login failed", sizeof(errmsg));
+    if (Handle_login(connp, errmsg, sizeof(errmsg)) == -1)
+    {
+        Destroy_connection(connp, errmsg);
+        return -1;
+    }
+    Conn_set_state(connp, CONN_PLAYING, CONN_PLAYING);
+
+    return i;
+}
+
 /*
  * Handle a connection that is in the listening state.
  */
 static int Handle_listening(connection_t *connp)
 {
-    uint8_t type;
+    uint8_t type, methods;
     int n;
     char nick[MAX_CHARS],
-        user[MAX_CHARS];
+        user[MAX_CHARS],
+        dpy[MAX_CHARS];
 
     if (connp->state != CONN_LISTENING)
     {
@@ -1004,14 +1342,25 @@ static int Handle_listening(connection_t *connp)
         Destroy_connection(connp, "not connecting");
         return -1;
     }
-    if ((n = Packet_scanf(&connp->r, "%c%s%s",
-                          &type, user, nick)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_s, pkt_s>(&connp->r,
+                                              &type, user, nick)) <= 0)
     {
         Send_reply(connp, PKT_VERIFY, PKT_FAILURE);
         Send_reliable(connp);
         Destroy_connection(connp, "verify incomplete");
         return -1;
     }
+    /*
+     * Newer clients append the map transfer methods they understand.
+     */
+    methods = 0;
+    if (connp->r.len - (connp->r.ptr - connp->r.buf) > 0)
+    {
+        if (Packet_read<pkt_s, pkt_c>(&connp->r, dpy, &methods) <= 0)
+            methods = 0;
+    }
+    Setup_blob_put(connp->setup_blob);
+    connp->setup_blob = Select_setup(methods);
     Fix_user_name(user);
     Fix_nick_name(nick);
     if (strcmp(user, connp->user))
@@ -1026,82 +1375,83 @@ static int Handle_listening(connection_t *connp)
         return -1;
     }
     Sockbuf_clear(&connp->w);
-    if (Send_reply(connp, PKT_VERIFY, PKT_SUCCESS) == -1 || Packet_printf(&connp->c, "%c%u", PKT_MAGIC, connp->magic) <= 0 || Send_reliable(connp) <= 0)
+    if (Send_reply(connp, PKT_VERIFY, PKT_SUCCESS) == -1 || Packet_write<pkt_c, pkt_u>(&connp->c, PKT_MAGIC, connp->magic) <= 0 || Send_reliable(connp) <= 0)
     {
         Destroy_connection(connp, "confirm failed");
         return -1;
     }
+    /* The setup stream follows the reply and the magic. */
+    connp->setup_base = connp->reliable_offset + connp->c.len;
 
     Conn_set_state(connp, CONN_DRAIN, CONN_SETUP);
 
     return 1; /* success! */
 }
 
+/*
+ * Return the unacknowledged reliable data of a connection.
+ * While the setup is being transmitted that is a window into the
+ * shared setup stream instead of the connection's own buffer.
+ */
+static int Reliable_pending(connection_t *connp, char **bufp)
+{
+    long off;
+
+    if (connp->c.len > 0 || connp->setup_blob == NULL)
+    {
+        if (bufp)
+            *bufp = connp->c.buf;
+        return connp->c.len;
+    }
+    off = connp->reliable_offset - connp->setup_base;
+    if (bufp)
+        *bufp = &connp->setup_blob->data[off];
+    return connp->setup - off;
+}
+
 /*
  * Handle a connection that is in the transmit-server-configuration-data state.
+ * The setup stream isn't copied, we only move the window of it that
+ * Send_reliable() may transmit.
  */
 static int Handle_setup(connection_t *connp)
 {
-    char *buf;
-    int n,
-        len;
+    setup_blob_t *blob = connp->setup_blob;
+    int len;
 
-    if (connp->state != CONN_SETUP)
+    if (connp->state != CONN_SETUP || blob == NULL)
     {
         Destroy_connection(connp, "not setup");
         return -1;
     }
-
-    if (connp->setup == 0)
+    if (connp->c.len > 0)
     {
-        n = Packet_printf(&connp->c,
-                          "%ld"
-                          "%ld%hd"
-                          "%hd%hd"
-                          "%hd%hd"
-                          "%s%s",
-                          Setup->map_data_len,
-                          Setup->mode, Setup->lives,
-                          Setup->x, Setup->y,
-                          Setup->frames_per_second, Setup->map_order,
-                          Setup->name, Setup->author);
-        if (n <= 0)
-        {
-            Destroy_connection(connp, "setup 0 write error");
-            return -1;
-        }
-        connp->setup = (char *)&Setup->map_data[0] - (char *)Setup;
+        /* Nothing may be queued in the middle of the setup stream. */
+        Destroy_connection(connp, "reliable data during setup");
+        return -1;
     }
-    else if (connp->setup < Setup->setup_size)
+
+    if (connp->setup > 0 && Reliable_pending(connp, NULL) > 0)
     {
-        if (connp->c.len > 0)
-        {
-            /* If there is still unacked reliable data test for acks. */
-            Handle_input(-1, (void *)connp);
-            if (connp->state == CONN_FREE)
-                return -1;
-        }
+        /* If there is still unacked reliable data test for acks. */
+        Handle_input(-1, (void *)connp);
+        if (connp->state == CONN_FREE)
+            return -1;
     }
-    if (connp->setup < Setup->setup_size)
+    if (connp->setup < blob->len)
     {
-        len = MIN(connp->c.size, 4096) - connp->c.len;
+        len = MIN(connp->c.size, 4096) - Reliable_pending(connp, NULL);
         if (len <= 0)
             /* Wait for acknowledgement of previously transmitted data. */
             return 0;
-        if (len > Setup->setup_size - connp->setup)
-            len = Setup->setup_size - connp->setup;
+        if (len > blob->len - connp->setup)
+            len = blob->len - connp->setup;
 
-        buf = (char *)Setup;
-        if (Sockbuf_write(&connp->c, &buf[connp->setup], len) != len)
-        {
-            Destroy_connection(connp, "sockbuf write setup error");
-            return -1;
-        }
         connp->setup += len;
         if (len >= 512)
             connp->start += (len * FPS) / (8 * 512) + 1;
     }
-    if (connp->setup >= Setup->setup_size)
+    if (connp->setup >= blob->len)
         Conn_set_state(connp, CONN_DRAIN, CONN_LOGIN);
 
     return 0;
@@ -1117,8 +1467,7 @@ static int Handle_login(connection_t *connp, char *errmsg, int errsize)
 {
     player_t *pl;
     int i,
-        war_on_id,
-        conn_bit;
+        war_on_id;
     char msg[MSG_LEN];
 
     if (NumPlayers - NumPseudoPlayers >= world->NumBases)
@@ -1177,6 +1526,7 @@ static int Handle_login(connection_t *connp, char *errmsg, int errsize)
     if (connp->team != TEAM_NOT_SET)
         pl->team = connp->team;
     pl->version = connp->version;
+    Feature_init(connp);
 
     Pick_startpos(NumPlayers);
     Go_home(NumPlayers);
@@ -1189,6 +1539,14 @@ static int Handle_login(connection_t *connp, char *errmsg, int errsize)
     memset(pl->last_keyv, 0, sizeof(pl->last_keyv));
     memset(pl->prev_keyv, 0, sizeof(pl->prev_keyv));
 
+    /*
+     * Acks during the setup come back at once, in the game they wait
+     * for the client's frame handling and perhaps its jitter buffer.
+     * Measure the lowest roundtrip time anew so that doesn't look
+     * like congestion.
+     */
+    connp->rtt_min = 0;
+
     Conn_set_state(connp, CONN_READY, CONN_PLAYING);
 
     if (Send_reply(connp, PKT_PLAY, PKT_SUCCESS) <= 0)
@@ -1274,16 +1632,15 @@ static int Handle_login(connection_t *connp, char *errmsg, int errsize)
         // }
     }
 
-    conn_bit = (1 << connp->conn_index);
     for (i = 0; i < world->NumCannons; i++)
     {
         /*
          * The client assumes at startup that all cannons are active.
          */
         if (world->cannon[i].dead_time == 0)
-            SET_BIT(world->cannon[i].conn_mask, conn_bit);
+            Conn_mask_set(&world->cannon[i].conn_mask, connp->conn_index);
         else
-            CLR_BIT(world->cannon[i].conn_mask, conn_bit);
+            Conn_mask_clear(&world->cannon[i].conn_mask, connp->conn_index);
     }
     for (i = 0; i < world->NumFuels; i++)
     {
@@ -1291,9 +1648,9 @@ static int Handle_login(connection_t *connp, char *errmsg, int errsize)
          * The client assumes at startup that all fuelstations are filled.
          */
         if (world->fuel[i].fuel == MAX_STATION_FUEL)
-            SET_BIT(world->fuel[i].conn_mask, conn_bit);
+            Conn_mask_set(&world->fuel[i].conn_mask, connp->conn_index);
         else
-            CLR_BIT(world->fuel[i].conn_mask, conn_bit);
+            Conn_mask_clear(&world->fuel[i].conn_mask, connp->conn_index);
     }
     for (i = 0; i < world->NumTargets; i++)
     {
@@ -1302,13 +1659,13 @@ static int Handle_login(connection_t *connp, char *errmsg, int errsize)
          */
         if (world->targets[i].dead_time == 0 && world->targets[i].damage == TARGET_DAMAGE)
         {
-            SET_BIT(world->targets[i].conn_mask, conn_bit);
-            CLR_BIT(world->targets[i].update_mask, conn_bit);
+            Conn_mask_set(&world->targets[i].conn_mask, connp->conn_index);
+            Conn_mask_clear(&world->targets[i].update_mask, connp->conn_index);
         }
         else
         {
-            CLR_BIT(world->targets[i].conn_mask, conn_bit);
-            SET_BIT(world->targets[i].update_mask, conn_bit);
+            Conn_mask_clear(&world->targets[i].conn_mask, connp->conn_index);
+            Conn_mask_set(&world->targets[i].update_mask, connp->conn_index);
         }
     }
 
@@ -1353,74 +1710,76 @@ static int Handle_login(connection_t *connp, char *errmsg, int errsize)
 static void Handle_input(int fd, void *arg)
 {
     connection_t *connp = (connection_t *)arg;
-    int type,
+    int k, n,
+        type,
         result,
+        lens[SOCKBUF_MAX_READS],
         (**receive_tbl)(connection_t *connp);
 
-    if (connp->state & (CONN_PLAYING | CONN_READY))
-    {
-        receive_tbl = &playing_receive[0];
-    }
-    else if (connp->state == CONN_LOGIN)
-    {
-        receive_tbl = &login_receive[0];
-    }
-    else if (connp->state & (CONN_DRAIN | CONN_SETUP))
-    {
-        receive_tbl = &drain_receive[0];
-    }
-    else if (connp->state == CONN_LISTENING)
+    if (connp->state == CONN_LISTENING)
     {
         Handle_listening(connp);
         return;
     }
-    else
+    if (!(connp->state & (CONN_PLAYING | CONN_READY | CONN_LOGIN | CONN_DRAIN | CONN_SETUP)))
     {
         if (connp->state != CONN_FREE)
             Destroy_connection(connp, "not input");
         return;
     }
-    connp->num_keyboard_updates = 0;
 
-    Sockbuf_clear(&connp->r);
-    if (Sockbuf_read(&connp->r) == -1)
+    /*
+     * Take everything that is waiting in one go and handle the
+     * datagrams in the order they arrived, each where it was read.
+     */
+    n = Sockbuf_read_many(&connp->r, SERVER_RECV_SIZE, lens, SOCKBUF_MAX_READS);
+    if (n == -1)
     {
         Destroy_connection(connp, "input error");
         return;
     }
-    if (connp->r.len <= 0)
-    {
-        /*
-         * No input.
-         */
-        return;
-    }
-    while (connp->r.ptr < connp->r.buf + connp->r.len)
+    for (k = 0; k < n; k++)
     {
-        type = (connp->r.ptr[0] & 0xFF);
-        result = (*receive_tbl[type])(connp);
-        if (result == -1)
-        {
-            /*
-             * Unrecoverable error.
-             * Connection has been destroyed.
-             */
-            return;
-        }
-        if (result == 0)
-        {
-            /*
-             * Incomplete client packet.
-             * Drop rest of packet.
-             */
-            Sockbuf_clear(&connp->r);
+        /* A packet may have changed the state of the connection. */
+        if (connp->state & (CONN_PLAYING | CONN_READY))
+            receive_tbl = &playing_receive[0];
+        else if (connp->state == CONN_LOGIN)
+            receive_tbl = &login_receive[0];
+        else if (connp->state & (CONN_DRAIN | CONN_SETUP))
+            receive_tbl = &drain_receive[0];
+        else
             break;
-        }
-        if (connp->state == CONN_PLAYING)
+
+        connp->num_keyboard_updates = 0;
+        connp->r.ptr = connp->r.buf + k * SERVER_RECV_SIZE;
+        connp->r.len = k * SERVER_RECV_SIZE + lens[k];
+        while (connp->r.ptr < connp->r.buf + connp->r.len)
         {
-            connp->start = main_loops;
+            type = (connp->r.ptr[0] & 0xFF);
+            result = (*receive_tbl[type])(connp);
+            if (result == -1)
+            {
+                /*
+                 * Unrecoverable error.
+                 * Connection has been destroyed.
+                 */
+                return;
+            }
+            if (result == 0)
+            {
+                /*
+                 * Incomplete client packet.
+                 * Drop rest of packet.
+                 */
+                break;
+            }
+            if (connp->state == CONN_PLAYING)
+            {
+                connp->start = main_loops;
+            }
         }
     }
+    Sockbuf_clear(&connp->r);
 }
 
 int Input(void)
@@ -1428,7 +1787,7 @@ int Input(void)
     int i,
         ind,
         num_reliable = 0,
-        input_reliable[MAX_SELECT_FD];
+        input_reliable[MAX_CONNECTIONS];
     connection_t *connp;
     char msg[MSG_LEN];
 
@@ -1471,7 +1830,7 @@ int Input(void)
         connp = &Conn[ind];
         if (connp->state & (CONN_DRAIN | CONN_READY | CONN_SETUP | CONN_LOGIN))
         {
-            if (connp->c.len > 0)
+            if (Reliable_pending(connp, NULL) > 0)
             {
                 if (Send_reliable(connp) == -1)
                 {
@@ -1502,7 +1861,7 @@ int Send_reply(connection_t *connp, int replyto, int result)
 {
     int n;
 
-    n = Packet_printf(&connp->c, "%c%c%c", PKT_REPLY, replyto, result);
+    n = Packet_write<pkt_c, pkt_c, pkt_c>(&connp->c, PKT_REPLY, replyto, result);
     if (n == -1)
     {
         Destroy_connection(connp, "write error");
@@ -1511,9 +1870,83 @@ int Send_reply(connection_t *connp, int replyto, int result)
     return n;
 }
 
+/*
+ * Start remembering what this frame contains and tell the client
+ * which acknowledged frame the deltas in it are relative to.
+ */
+static int Send_delta_base(connection_t *connp)
+{
+    delta_frame_t *cur;
+    long base = connp->delta_ack;
+
+    if (connp->delta == NULL)
+    {
+        if ((connp->delta = XCALLOC(delta_frame_t, DELTA_FRAMES)) == NULL)
+        {
+            error("No memory for delta frames");
+            CLR_BIT(connp->features, F_DELTA);
+            return 0;
+        }
+    }
+    if (base <= 0 || frame_loops - base >= DELTA_FRAMES || connp->delta[base % DELTA_FRAMES].loops != base)
+        base = 0;
+    connp->delta_base = base;
+
+    cur = &connp->delta[frame_loops % DELTA_FRAMES];
+    cur->loops = frame_loops;
+    cur->has_self = false;
+    cur->num_ships = 0;
+
+    return Packet_write<pkt_c, pkt_c>(&connp->w, PKT_DELTA_BASE,
+                                      base ? (int)(frame_loops - base) : 0);
+}
+
+static delta_frame_t *Delta_base(connection_t *connp)
+{
+    if (connp->delta_base == 0)
+        return NULL;
+    return &connp->delta[connp->delta_base % DELTA_FRAMES];
+}
+
+static delta_frame_t *Delta_current(connection_t *connp)
+{
+    return &connp->delta[frame_loops % DELTA_FRAMES];
+}
+
+/*
+ * Send the self fields which differ from the base frame.
+ */
+static int Send_self_delta(connection_t *connp, const short *base, const short *self)
+{
+    char buf[4 + 3 * NUM_SELF_FIELDS];
+    unsigned mask = 0;
+    int i, n = 4;
+
+    for (i = 0; i < NUM_SELF_FIELDS; i++)
+    {
+        if (self[i] == base[i])
+            continue;
+        mask |= (1 << i);
+        if (SELF_SHORT_FIELDS & (1 << i))
+            n += Packet_put_delta(&buf[n], self[i] - base[i]);
+        else
+            buf[n++] = (char)self[i];
+    }
+    buf[0] = PKT_SELF_DELTA;
+    buf[1] = (char)mask;
+    buf[2] = (char)(mask >> 8);
+    buf[3] = (char)(mask >> 16);
+
+    if (connp->w.size - connp->w.len < n + SOCKBUF_WRITE_SPARE)
+        return 0;
+    memcpy(connp->w.buf + connp->w.len, buf, n);
+    connp->w.len += n;
+    return n;
+}
+
 static int Send_modifiers(connection_t *connp, char *mods)
 {
-    return Packet_printf(&connp->w, "%c%s", PKT_MODIFIERS, mods);
+    return Packet_write<pkt_c, pkt_s>(&connp->w, PKT_MODIFIERS, mods);
 }
 
 /*
@@ -1548,7 +1981,7 @@ static int Send_self_items(connection_t *connp, player_t *pl)
         return 0;
 
     /* build the header. */
-    n = Packet_printf(&connp->w, "%c%u", PKT_SELF_ITEMS, item_mask);
+    n = Packet_write<pkt_c, pkt_u>(&connp->w, PKT_SELF_ITEMS, item_mask);
     if (n <= 0)
         return n;
 
@@ -1578,35 +2011,104 @@ int Send_self(connection_t *connp,
     uint8_t stat = (uint8_t)status;
     int sbuf_len = connp->w.len;
 
+    if (FEATURE(connp, F_DELTA))
+    {
+        delta_frame_t *base = Delta_base(connp),
+                      *cur = Delta_current(connp);
+        short *self = cur->self;
+
+        self[SELF_X] = (short)(pl->pos.x + 0.5);
+        self[SELF_Y] = (short)(pl->pos.y + 0.5);
+        self[SELF_VX] = (short)pl->vel.x;
+        self[SELF_VY] = (short)pl->vel.y;
+        self[SELF_DIR] = (uint8_t)pl->dir;
+        self[SELF_POWER] = (uint8_t)(int)(pl->power + 0.5);
+        self[SELF_TURNSPEED] = (uint8_t)(int)(pl->turnspeed + 0.5);
+        self[SELF_TURNRESISTANCE] = (uint8_t)(int)(pl->turnresistance * 255.0 + 0.5);
+        self[SELF_LOCK_ID] = (short)lock_id;
+        self[SELF_LOCK_DIST] = (short)lock_dist;
+        self[SELF_LOCK_DIR] = (uint8_t)lock_dir;
+        self[SELF_CHECK] = (uint8_t)pl->check;
+        self[SELF_FUEL_CURRENT] = (uint8_t)pl->fuel.current;
+        self[SELF_FUEL_SUM] = (short)(pl->fuel.sum >> FUEL_SCALE_BITS);
+        self[SELF_FUEL_MAX] = (short)(pl->fuel.max >> FUEL_SCALE_BITS);
+        self[SELF_VIEW_WIDTH] = (short)connp->view_width;
+        self[SELF_VIEW_HEIGHT] = (short)connp->view_height;
+        self[SELF_DEBRIS_COLORS] = (uint8_t)connp->debris_colors;
+        self[SELF_STAT] = stat;
+        self[SELF_AUTOPILOT] = (uint8_t)autopilotlight;
+
+        if (base != NULL && base->has_self)
+            n = Send_self_delta(connp, base->self, self);
+        else
+            n = Packet_write<pkt_c,
+                             pkt_hd, pkt_hd, pkt_hd, pkt_hd, pkt_c,
+                             pkt_c, pkt_c, pkt_c,
+                             pkt_hd, pkt_hd, pkt_c, pkt_c,
+                             pkt_c, pkt_hd, pkt_hd,
+                             pkt_hd, pkt_hd, pkt_c,
+                             pkt_c, pkt_c>(&connp->w,
+                                           PKT_SELF,
+                                           self[SELF_X], self[SELF_Y],
+                                           self[SELF_VX], self[SELF_VY],
+                                           self[SELF_DIR],
+                                           self[SELF_POWER],
+                                           self[SELF_TURNSPEED],
+                                           self[SELF_TURNRESISTANCE],
+                                           self[SELF_LOCK_ID], self[SELF_LOCK_DIST],
+                                           self[SELF_LOCK_DIR],
+                                           self[SELF_CHECK],
+
+                                           self[SELF_FUEL_CURRENT],
+                                           self[SELF_FUEL_SUM],
+                                           self[SELF_FUEL_MAX],
+
+                                           self[SELF_VIEW_WIDTH], self[SELF_VIEW_HEIGHT],
+                                           self[SELF_DEBRIS_COLORS],
+
+                                           self[SELF_STAT],
+                                           self[SELF_AUTOPILOT]);
+        if (n <= 0)
+        {
+            return n;
+        }
+        cur->has_self = true;
+        n = Send_self_items(connp, pl);
+        if (n <= 0)
+        {
+            return n;
+        }
+        return Send_modifiers(connp, mods);
+    }
+
     if (connp->version >= 0x4203)
     {
-        n = Packet_printf(&connp->w,
-                          "%c"
-                          "%hd%hd%hd%hd%c"
-                          "%c%c%c"
-                          "%hd%hd%c%c"
-                          "%c%hd%hd"
-                          "%hd%hd%c"
-                          "%c%c",
-                          PKT_SELF,
-                          (int)(pl->pos.x + 0.5), (int)(pl->pos.y + 0.5),
-                          (int)pl->vel.x, (int)pl->vel.y,
-                          pl->dir,
-                          (int)(pl->power + 0.5),
-                          (int)(pl->turnspeed + 0.5),
-                          (int)(pl->turnresistance * 255.0 + 0.5),
-                          lock_id, lock_dist, lock_dir,
-                          pl->check,
-
-                          pl->fuel.current,
-                          pl->fuel.sum >> FUEL_SCALE_BITS,
-                          pl->fuel.max >> FUEL_SCALE_BITS,
-
-                          connp->view_width, connp->view_height,
-                          connp->debris_colors,
-
-                          stat,
-                          autopilotlight
+        n = Packet_write<pkt_c,
+                         pkt_hd, pkt_hd, pkt_hd, pkt_hd, pkt_c,
+                         pkt_c, pkt_c, pkt_c,
+                         pkt_hd, pkt_hd, pkt_c, pkt_c,
+                         pkt_c, pkt_hd, pkt_hd,
+                         pkt_hd, pkt_hd, pkt_c,
+                         pkt_c, pkt_c>(&connp->w,
+                                       PKT_SELF,
+                                       (int)(pl->pos.x + 0.5), (int)(pl->pos.y + 0.5),
+                                       (int)pl->vel.x, (int)pl->vel.y,
+                                       pl->dir,
+                                       (int)(pl->power + 0.5),
+                                       (int)(pl->turnspeed + 0.5),
+                                       (int)(pl->turnresistance * 255.0 + 0.5),
+                                       lock_id, lock_dist, lock_dir,
+                                       pl->check,
+
+                                       pl->fuel.current,
+                                       pl->fuel.sum >> FUEL_SCALE_BITS,
+                                       pl->fuel.max >> FUEL_SCALE_BITS,
+
+                                       connp->view_width, connp->view_height,
+                                       connp->debris_colors,
+
+                                       stat,
+                                       autopilotlight
 
         );
         if (n <= 0)
@@ -1621,53 +2123,52 @@ int Send_self(connection_t *connp,
         return Send_modifiers(connp, mods);
     }
 
-    n = Packet_printf(&connp->w,
-                      "%c"
-                      "%hd%hd%hd%hd%c"
-                      "%c%c%c"
-                      "%hd%hd%c%c"
-                      "%c%c%c%c%c"
-                      "%c%c%c%c%c"
-                      "%c%c%c%c"
-                      "%c%hd%hd"
-                      "%hd%hd%c"
-                      "%c%c",
-                      PKT_SELF,
-                      (int)(pl->pos.x + 0.5), (int)(pl->pos.y + 0.5),
-                      (int)pl->vel.x, (int)pl->vel.y,
-                      pl->dir,
-                      (int)(pl->power + 0.5),
-                      (int)(pl->turnspeed + 0.5),
-                      (int)(pl->turnresistance * 255.0 + 0.5),
-                      lock_id, lock_dist, lock_dir,
-                      pl->check,
-
-                      pl->item[ITEM_CLOAK],
-                      pl->item[ITEM_SENSOR],
-                      pl->item[ITEM_MINE],
-                      pl->item[ITEM_MISSILE],
-                      pl->item[ITEM_ECM],
-
-                      pl->item[ITEM_TRANSPORTER],
-                      pl->item[ITEM_WIDEANGLE],
-                      pl->item[ITEM_REARSHOT],
-                      pl->item[ITEM_AFTERBURNER],
-                      pl->fuel.num_tanks,
-
-                      pl->item[ITEM_LASER],
-                      pl->item[ITEM_EMERGENCY_THRUST],
-                      pl->item[ITEM_TRACTOR_BEAM],
-                      pl->item[ITEM_AUTOPILOT],
-
-                      pl->fuel.current,
-                      pl->fuel.sum >> FUEL_SCALE_BITS,
-                      pl->fuel.max >> FUEL_SCALE_BITS,
-
-                      connp->view_width, connp->view_height,
-                      connp->debris_colors,
-
-                      stat,
-                      autopilotlight
+    n = Packet_write<pkt_c,
+                     pkt_hd, pkt_hd, pkt_hd, pkt_hd, pkt_c,
+                     pkt_c, pkt_c, pkt_c,
+                     pkt_hd, pkt_hd, pkt_c, pkt_c,
+                     pkt_c, pkt_c, pkt_c, pkt_c, pkt_c,
+                     pkt_c, pkt_c, pkt_c, pkt_c, pkt_c,
+                     pkt_c, pkt_c, pkt_c, pkt_c,
+                     pkt_c, pkt_hd, pkt_hd,
+                     pkt_hd, pkt_hd, pkt_c,
+                     pkt_c, pkt_c>(&connp->w,
+                                   PKT_SELF,
+                                   (int)(pl->pos.x + 0.5), (int)(pl->pos.y + 0.5),
+                                   (int)pl->vel.x, (int)pl->vel.y,
+                                   pl->dir,
+                                   (int)(pl->power + 0.5),
+                                   (int)(pl->turnspeed + 0.5),
+                                   (int)(pl->turnresistance * 255.0 + 0.5),
+                                   lock_id, lock_dist, lock_dir,
+                                   pl->check,
+
+                                   pl->item[ITEM_CLOAK],
+                                   pl->item[ITEM_SENSOR],
+                                   pl->item[ITEM_MINE],
+                                   pl->item[ITEM_MISSILE],
+                                   pl->item[ITEM_ECM],
+
+                                   pl->item[ITEM_TRANSPORTER],
+                                   pl->item[ITEM_WIDEANGLE],
+                                   pl->item[ITEM_REARSHOT],
+                                   pl->item[ITEM_AFTERBURNER],
+                                   pl->fuel.num_tanks,
+
+                                   pl->item[ITEM_LASER],
+                                   pl->item[ITEM_EMERGENCY_THRUST],
+                                   pl->item[ITEM_TRACTOR_BEAM],
+                                   pl->item[ITEM_AUTOPILOT],
+
+                                   pl->fuel.current,
+                                   pl->fuel.sum >> FUEL_SCALE_BITS,
+                                   pl->fuel.max >> FUEL_SCALE_BITS,
+
+                                   connp->view_width, connp->view_height,
+                                   connp->debris_colors,
+
+                                   stat,
+                                   autopilotlight
 
     );
     if (n <= 0)
@@ -1676,14 +2177,11 @@ int Send_self(connection_t *connp,
     }
     if (connp->version >= 0x3800)
     {
-        n = Packet_printf(&connp->w,
-                          "%c%c%c%c", /* %c", */
-                          pl->item[ITEM_EMERGENCY_SHIELD],
-                          pl->item[ITEM_DEFLECTOR],
-                          pl->item[ITEM_HYPERJUMP],
-                          pl->item[ITEM_PHASING] /* ,
-                          pl->item[ITEM_MIRROR] */
-        );
+        n = Packet_write<pkt_c, pkt_c, pkt_c, pkt_c>(&connp->w,
+                                                     pl->item[ITEM_EMERGENCY_SHIELD],
+                                                     pl->item[ITEM_DEFLECTOR],
+                                                     pl->item[ITEM_HYPERJUMP],
+                                                     pl->item[ITEM_PHASING]);
         if (n <= 0)
         {
             connp->w.len = sbuf_len;
@@ -1691,9 +2189,8 @@ int Send_self(connection_t *connp,
         }
         if (connp->version >= 0x4100)
         {
-            n = Packet_printf(&connp->w,
-                              "%c",
-                              pl->item[ITEM_MIRROR]);
+            n = Packet_write<pkt_c>(&connp->w,
+                                    pl->item[ITEM_MIRROR]);
             if (n <= 0)
             {
                 connp->w.len = sbuf_len;
@@ -1701,9 +2198,8 @@ int Send_self(connection_t *connp,
             }
             if (connp->version >= 0x4201)
             {
-                n = Packet_printf(&connp->w,
-                                  "%c",
-                                  pl->item[ITEM_ARMOR]);
+                n = Packet_write<pkt_c>(&connp->w,
+                                        pl->item[ITEM_ARMOR]);
                 if (n <= 0)
                 {
                     connp->w.len = sbuf_len;
@@ -1714,9 +2210,8 @@ int Send_self(connection_t *connp,
     }
     else if (connp->version >= 0x3200)
     {
-        n = Packet_printf(&connp->w,
-                          "%c",
-                          pl->item[ITEM_EMERGENCY_SHIELD]);
+        n = Packet_write<pkt_c>(&connp->w,
+                                pl->item[ITEM_EMERGENCY_SHIELD]);
         if (n <= 0)
         {
             connp->w.len = sbuf_len;
@@ -1738,7 +2233,7 @@ int Send_leave(connection_t *connp, int id)
              connp->state, connp->id);
         return 0;
     }
-    return Packet_printf(&connp->c, "%c%hd", PKT_LEAVE, id);
+    return Packet_write<pkt_c, pkt_hd>(&connp->c, PKT_LEAVE, id);
 }
 
 /*
@@ -1752,8 +2247,8 @@ int Send_war(connection_t *connp, int robot_id, int killer_id)
              connp->state, connp->id);
         return 0;
     }
-    return Packet_printf(&connp->c, "%c%hd%hd", PKT_WAR,
-                         robot_id, killer_id);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd>(&connp->c, PKT_WAR,
+                                               robot_id, killer_id);
 }
 
 /*
@@ -1767,8 +2262,8 @@ int Send_seek(connection_t *connp, int programmer_id, int robot_id, int sought_i
              connp->state, connp->id);
         return 0;
     }
-    return Packet_printf(&connp->c, "%c%hd%hd%hd", PKT_SEEK,
-                         programmer_id, robot_id, sought_id);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_hd>(&connp->c, PKT_SEEK,
+                                                       programmer_id, robot_id, sought_id);
 }
 
 /*
@@ -1788,20 +2283,19 @@ int Send_player(connection_t *connp, int id)
         return 0;
     }
     Convert_ship_2_string(pl->ship, buf, ext, 0x3200);
-    n = Packet_printf(&connp->c,
-                      "%c%hd"
-                      "%c%c"
-                      "%s%s%s"
-                      "%S",
-                      PKT_PLAYER, pl->id,
-                      pl->team, pl->mychar,
-                      pl->name, pl->username, pl->hostname,
-                      buf);
+    n = Packet_write<pkt_c, pkt_hd,
+                     pkt_c, pkt_c,
+                     pkt_s, pkt_s, pkt_s,
+                     pkt_S>(&connp->c,
+                            PKT_PLAYER, pl->id,
+                            pl->team, pl->mychar,
+                            pl->name, pl->username, pl->hostname,
+                            buf);
     if (connp->version > 0x3200)
     {
         if (n > 0)
         {
-            n = Packet_printf(&connp->c, "%S", ext);
+            n = Packet_write<pkt_S>(&connp->c, ext);
             if (n <= 0)
             {
                 connp->c.len = sbuf_len;
@@ -1827,9 +2321,9 @@ int Send_score(connection_t *connp, int id, int score,
     {
         printf("THIS NEVER HAPPENS: 2tkjgfkljadfjsjafj\n");
         /* older clients don't get alliance info or decimals of the score */
-        return Packet_printf(&connp->c, "%c%hd%hd%hd%c", PKT_SCORE,
-                             id, (int)(score + (score > 0 ? 0.5 : -0.5)),
-                             life, mychar);
+        return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_hd, pkt_c>(&connp->c, PKT_SCORE,
+                                                                  id, (int)(score + (score > 0 ? 0.5 : -0.5)),
+                                                                  life, mychar);
     }
     else
     {
@@ -1846,9 +2340,9 @@ int Send_score(connection_t *connp, int id, int score,
                     allchar = '+';
             }
         }
-        return Packet_printf(&connp->c, "%c%hd%d%hd%c%c", PKT_SCORE, id,
-                             (int)(score * 100 + (score > 0 ? 0.5 : -0.5)),
-                             life, mychar, allchar);
+        return Packet_write<pkt_c, pkt_hd, pkt_d, pkt_hd, pkt_c, pkt_c>(&connp->c, PKT_SCORE, id,
+                                                                        (int)(score * 100 + (score > 0 ? 0.5 : -0.5)),
+                                                                        life, mychar, allchar);
     }
 }
 
@@ -1863,8 +2357,8 @@ int Send_timing(connection_t *connp, int id, int check, int round)
              connp->state, connp->id);
         return 0;
     }
-    return Packet_printf(&connp->c, "%c%hd%hu", PKT_TIMING,
-                         id, round * MAX_CHECKS + check);
+    return Packet_write<pkt_c, pkt_hd, pkt_hu>(&connp->c, PKT_TIMING,
+                                               id, round * MAX_CHECKS + check);
 }
 
 /*
@@ -1878,7 +2372,7 @@ int Send_base(connection_t *connp, int id, int num)
              connp->state, connp->id);
         return 0;
     }
-    return Packet_printf(&connp->c, "%c%hd%hu", PKT_BASE, id, num);
+    return Packet_write<pkt_c, pkt_hd, pkt_hu>(&connp->c, PKT_BASE, id, num);
 }
 
 /*
@@ -1886,8 +2380,8 @@ int Send_base(connection_t *connp, int id, int num)
  */
 int Send_fuel(connection_t *connp, int num, int fuel)
 {
-    return Packet_printf(&connp->w, "%c%hu%hu", PKT_FUEL,
-                         num, fuel >> FUEL_SCALE_BITS);
+    return Packet_write<pkt_c, pkt_hu, pkt_hu>(&connp->w, PKT_FUEL,
+                                               num, fuel >> FUEL_SCALE_BITS);
 }
 
 int Send_score_object(connection_t *connp, int score, int x, int y, const char *string)
@@ -1902,48 +2396,48 @@ int Send_score_object(connection_t *connp, int score, int x, int y, const char *
     {
         printf("THIS NEVER HAPPENS: vgklaj4u20\n");
         /* older clients don't get decimals of the score */
-        return Packet_printf(&connp->c, "%c%hd%hu%hu%s", PKT_SCORE_OBJECT,
-                             (int)(score + (score > 0 ? 0.5 : -0.5)),
-                             x, y, string);
+        return Packet_write<pkt_c, pkt_hd, pkt_hu, pkt_hu, pkt_s>(&connp->c, PKT_SCORE_OBJECT,
+                                                                  (int)(score + (score > 0 ? 0.5 : -0.5)),
+                                                                  x, y, string);
     }
     else
     {
-        return Packet_printf(&connp->c, "%c%d%hu%hu%s", PKT_SCORE_OBJECT,
-                             (int)(score * 100 + (score > 0 ? 0.5 : -0.5)),
-                             x, y, string);
+        return Packet_write<pkt_c, pkt_d, pkt_hu, pkt_hu, pkt_s>(&connp->c, PKT_SCORE_OBJECT,
+                                                                 (int)(score * 100 + (score > 0 ? 0.5 : -0.5)),
+                                                                 x, y, string);
     }
 }
 
 int Send_cannon(connection_t *connp, int num, int dead_time)
 {
-    return Packet_printf(&connp->w, "%c%hu%hu", PKT_CANNON,
-                         num, dead_time);
+    return Packet_write<pkt_c, pkt_hu, pkt_hu>(&connp->w, PKT_CANNON,
+                                               num, dead_time);
 }
 
 int Send_destruct(connection_t *connp, int count)
 {
-    return Packet_printf(&connp->w, "%c%hd", PKT_DESTRUCT, count);
+    return Packet_write<pkt_c, pkt_hd>(&connp->w, PKT_DESTRUCT, count);
 }
 
 int Send_shutdown(connection_t *connp, int count, int delay)
 {
-    return Packet_printf(&connp->w, "%c%hd%hd", PKT_SHUTDOWN,
-                         count, delay);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd>(&connp->w, PKT_SHUTDOWN,
+                                               count, delay);
 }
 
 int Send_thrusttime(connection_t *connp, int count, int max)
 {
-    return Packet_printf(&connp->w, "%c%hd%hd", PKT_THRUSTTIME, count, max);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd>(&connp->w, PKT_THRUSTTIME, count, max);
 }
 
 int Send_shieldtime(connection_t *connp, int count, int max)
 {
-    return Packet_printf(&connp->w, "%c%hd%hd", PKT_SHIELDTIME, count, max);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd>(&connp->w, PKT_SHIELDTIME, count, max);
 }
 
 int Send_phasingtime(connection_t *connp, int count, int max)
 {
-    return Packet_printf(&connp->w, "%c%hd%hd", PKT_PHASINGTIME, count, max);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd>(&connp->w, PKT_PHASINGTIME, count, max);
 }
 
 int Send_debris(connection_t *connp, int type, uint8_t *p, int n)
@@ -1994,8 +2488,8 @@ int Send_wreckage(connection_t *connp, int x, int y, uint8_t wrtype, uint8_t siz
         wrtype &= ~0x80;
     }
 
-    return Packet_printf(&connp->w, "%c%hd%hd%c%c%c", PKT_WRECKAGE,
-                         x, y, wrtype, size, rot);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_c, pkt_c, pkt_c>(&connp->w, PKT_WRECKAGE,
+                                                                    x, y, wrtype, size, rot);
 }
 
 int Send_asteroid(connection_t *connp, int x, int y, uint8_t type, uint8_t size, uint8_t rot)
@@ -2010,8 +2504,8 @@ int Send_asteroid(connection_t *connp, int x, int y, uint8_t type, uint8_t size,
 
     type_size = ((type & 0x0F) << 4) | (size & 0x0F);
 
-    return Packet_printf(&connp->w, "%c%hd%hd%c%c", PKT_ASTEROID,
-                         x, y, type_size, rot);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_c, pkt_c>(&connp->w, PKT_ASTEROID,
+                                                             x, y, type_size, rot);
 }
 
 int Send_fastshot(connection_t *connp, int type, uint8_t *p, int n)
@@ -2047,25 +2541,25 @@ int Send_fastshot(connection_t *connp, int type, uint8_t *p, int n)
 
 int Send_missile(connection_t *connp, int x, int y, int len, int dir)
 {
-    return Packet_printf(&connp->w, "%c%hd%hd%c%c",
-                         PKT_MISSILE, x, y, len, dir);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_c, pkt_c>(&connp->w,
+                                                             PKT_MISSILE, x, y, len, dir);
 }
 
 int Send_ball(connection_t *connp, int x, int y, int id)
 {
-    return Packet_printf(&connp->w, "%c%hd%hd%hd", PKT_BALL, x, y, id);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_hd>(&connp->w, PKT_BALL, x, y, id);
 }
 
 int Send_mine(connection_t *connp, int x, int y, int teammine, int id)
 {
-    return Packet_printf(&connp->w, "%c%hd%hd%c%hd", PKT_MINE, x, y,
-                         teammine, id);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_c, pkt_hd>(&connp->w, PKT_MINE, x, y,
+                                                              teammine, id);
 }
 
 int Send_target(connection_t *connp, int num, int dead_time, int damage)
 {
-    return Packet_printf(&connp->w, "%c%hu%hu%hu", PKT_TARGET,
-                         num, dead_time, damage);
+    return Packet_write<pkt_c, pkt_hu, pkt_hu, pkt_hu>(&connp->w, PKT_TARGET,
+                                                       num, dead_time, damage);
 }
 
 int Send_wormhole(connection_t *connp, int x, int y)
@@ -2089,7 +2583,7 @@ int Send_wormhole(connection_t *connp, int x, int y)
                         (int)(y + 2 * wormStep * tsin(wormAngle)),
                         BLOCK_SZ - 2 - 4 * wormStep);
     }
-    return Packet_printf(&connp->w, "%c%hd%hd", PKT_WORMHOLE, x, y);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd>(&connp->w, PKT_WORMHOLE, x, y);
 }
 
 int Send_item(connection_t *connp, int x, int y, int type)
@@ -2102,23 +2596,23 @@ int Send_item(connection_t *connp, int x, int y, int type)
             return 1;
         }
     }
-    return Packet_printf(&connp->w, "%c%hd%hd%c", PKT_ITEM, x, y, type);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_c>(&connp->w, PKT_ITEM, x, y, type);
 }
 
 int Send_paused(connection_t *connp, int x, int y, int count)
 {
-    return Packet_printf(&connp->w, "%c%hd%hd%hd", PKT_PAUSED, x, y, count);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_hd>(&connp->w, PKT_PAUSED, x, y, count);
 }
 
 int Send_ecm(connection_t *connp, int x, int y, int size)
 {
-    return Packet_printf(&connp->w, "%c%hd%hd%hd", PKT_ECM, x, y, size);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_hd>(&connp->w, PKT_ECM, x, y, size);
 }
 
 int Send_trans(connection_t *connp, int x1, int y1, int x2, int y2)
 {
-    return Packet_printf(&connp->w, "%c%hd%hd%hd%hd",
-                         PKT_TRANS, x1, y1, x2, y2);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_hd, pkt_hd>(&connp->w,
+                                                               PKT_TRANS, x1, y1, x2, y2);
 }
 
 int Send_ship(connection_t *connp, int x, int y, int id, int dir,
@@ -2131,33 +2625,99 @@ int Send_ship(connection_t *connp, int x, int y, int id, int dir,
         (static_cast<uint8_t>(phased) << 3) |
         (static_cast<uint8_t>(deflector) << 4);
 
-    return Packet_printf(&connp->w,
-                         "%c%hd%hd%hd"
-                         "%c"
-                         "%c",
-                         PKT_SHIP, x, y, id,
-                         dir,
-                         flags);
+    delta_frame_t *base, *cur;
+    delta_ship_t ship, *old = NULL;
+    int i, n;
+
+    if (!FEATURE(connp, F_DELTA))
+        return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_hd,
+                            pkt_c,
+                            pkt_c>(&connp->w,
+                                   PKT_SHIP, x, y, id,
+                                   dir,
+                                   flags);
+
+    ship.id = (short)id;
+    ship.x = (short)x;
+    ship.y = (short)y;
+    ship.dir = (uint8_t)dir;
+    ship.flags = flags;
+
+    if ((base = Delta_base(connp)) != NULL)
+    {
+        for (i = 0; i < base->num_ships; i++)
+        {
+            if (base->ships[i].id == ship.id)
+            {
+                old = &base->ships[i];
+                break;
+            }
+        }
+    }
+    if (old != NULL)
+    {
+        char buf[16];
+        unsigned mask = 0;
+
+        n = 2;
+        buf[0] = PKT_SHIP_DELTA;
+        n += Packet_put_delta(&buf[n], ship.id);
+        if (ship.x != old->x)
+        {
+            mask |= SHIP_DELTA_X;
+            n += Packet_put_delta(&buf[n], ship.x - old->x);
+        }
+        if (ship.y != old->y)
+        {
+            mask |= SHIP_DELTA_Y;
+            n += Packet_put_delta(&buf[n], ship.y - old->y);
+        }
+        if (ship.dir != old->dir)
+        {
+            mask |= SHIP_DELTA_DIR;
+            buf[n++] = (char)ship.dir;
+        }
+        if (ship.flags != old->flags)
+        {
+            mask |= SHIP_DELTA_FLAGS;
+            buf[n++] = (char)ship.flags;
+        }
+        buf[1] = (char)mask;
+        if (connp->w.size - connp->w.len < n + SOCKBUF_WRITE_SPARE)
+            return 0;
+        memcpy(connp->w.buf + connp->w.len, buf, n);
+        connp->w.len += n;
+    }
+    else if ((n = Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_hd,
+                               pkt_c,
+                               pkt_c>(&connp->w,
+                                      PKT_SHIP, x, y, id,
+                                      dir,
+                                      flags)) <= 0)
+        return n;
+
+    cur = Delta_current(connp);
+    if (cur->num_ships < DELTA_MAX_SHIPS)
+        cur->ships[cur->num_ships++] = ship;
+    return n;
 }
 
 int Send_refuel(connection_t *connp, int x0, int y0, int x1, int y1)
 {
-    return Packet_printf(&connp->w,
-                         "%c%hd%hd%hd%hd",
-                         PKT_REFUEL, x0, y0, x1, y1);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_hd, pkt_hd>(&connp->w,
+                                                               PKT_REFUEL, x0, y0, x1, y1);
 }
 
 int Send_connector(connection_t *connp, int x0, int y0, int x1, int y1, int tractor)
 {
-    return Packet_printf(&connp->w,
-                         "%c%hd%hd%hd%hd%c",
-                         PKT_CONNECTOR, x0, y0, x1, y1, tractor);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_hd, pkt_hd, pkt_c>(&connp->w,
+                                                                      PKT_CONNECTOR, x0, y0, x1, y1, tractor);
 }
 
 int Send_laser(connection_t *connp, int color, int x, int y, int len, int dir)
 {
-    return Packet_printf(&connp->w, "%c%c%hd%hd%hd%c", PKT_LASER,
-                         color, x, y, len, dir);
+    return Packet_write<pkt_c, pkt_c, pkt_hd, pkt_hd, pkt_hd, pkt_c>(&connp->w, PKT_LASER,
+                                                                     color, x, y, len, dir);
 }
 
 int Send_radar(connection_t *connp, int x, int y, int size)
@@ -2169,7 +2729,7 @@ int Send_radar(connection_t *connp, int x, int y, int size)
         printf("THIS NEVER HAPPENS: jtj4kj3kl4j3k4j\n");
         size &= ~0x80;
     }
-    return Packet_printf(&connp->w, "%c%hd%hd%c", PKT_RADAR, x, y, size);
+    return Packet_write<pkt_c, pkt_hd, pkt_hd, pkt_c>(&connp->w, PKT_RADAR, x, y, size);
 }
 
 int Send_fastradar(connection_t *connp, uint8_t *buf, int n)
@@ -2200,7 +2760,7 @@ int Send_fastradar(connection_t *connp, uint8_t *buf, int n)
 
 int Send_damaged(connection_t *connp, int damaged)
 {
-    return Packet_printf(&connp->w, "%c%c", PKT_DAMAGED, damaged);
+    return Packet_write<pkt_c, pkt_c>(&connp->w, PKT_DAMAGED, damaged);
 }
 
 int Send_audio(connection_t *connp, int type, int vol)
@@ -2209,17 +2769,17 @@ int Send_audio(connection_t *connp, int type, int vol)
     {
         return 0;
     }
-    return Packet_printf(&connp->w, "%c%c%c", PKT_AUDIO, type, vol);
+    return Packet_write<pkt_c, pkt_c, pkt_c>(&connp->w, PKT_AUDIO, type, vol);
 }
 
 int Send_time_left(connection_t *connp, long sec)
 {
-    return Packet_printf(&connp->w, "%c%ld", PKT_TIME_LEFT, sec);
+    return Packet_write<pkt_c, pkt_ld>(&connp->w, PKT_TIME_LEFT, sec);
 }
 
 int Send_eyes(connection_t *connp, int id)
 {
-    return Packet_printf(&connp->w, "%c%hd", PKT_EYES, id);
+    return Packet_write<pkt_c, pkt_hd>(&connp->w, PKT_EYES, id);
 }
 
 int Send_message(connection_t *connp, const char *msg)
@@ -2230,12 +2790,12 @@ int Send_message(connection_t *connp, const char *msg)
              connp->state, connp->id);
         return 0;
     }
-    return Packet_printf(&connp->c, "%c%S", PKT_MESSAGE, msg);
+    return Packet_write<pkt_c, pkt_S>(&connp->c, PKT_MESSAGE, msg);
 }
 
 int Send_loseitem(int lose_item_index, connection_t *connp)
 {
-    return Packet_printf(&connp->w, "%c%c", PKT_LOSEITEM, lose_item_index);
+    return Packet_write<pkt_c, pkt_c>(&connp->w, PKT_LOSEITEM, lose_item_index);
 }
 
 int Send_start_of_frame(connection_t *connp)
@@ -2254,9 +2814,13 @@ int Send_start_of_frame(connection_t *connp)
      * which keyboard update we have last received.
      */
     Sockbuf_clear(&connp->w);
-    if (Packet_printf(&connp->w,
-                      "%c%ld%ld",
-                      PKT_START, frame_loops, connp->last_key_change) <= 0)
+    if (Packet_write<pkt_c, pkt_ld, pkt_ld>(&connp->w,
+                                            PKT_START, frame_loops, connp->last_key_change) <= 0)
+    {
+        Destroy_connection(connp, "write error");
+        return -1;
+    }
+    if (FEATURE(connp, F_DELTA) && Send_delta_base(connp) == -1)
     {
         Destroy_connection(connp, "write error");
         return -1;
@@ -2271,7 +2835,7 @@ int Send_end_of_frame(connection_t *connp)
     int n;
 
     last_packet_of_frame = 1;
-    n = Packet_printf(&connp->w, "%c%ld", PKT_END, frame_loops);
+    n = Packet_write<pkt_c, pkt_ld>(&connp->w, PKT_END, frame_loops);
     last_packet_of_frame = 0;
     if (n == -1)
     {
@@ -2287,6 +2851,19 @@ int Send_end_of_frame(connection_t *connp)
         Sockbuf_clear(&connp->w);
         return 0;
     }
+    if (connp->fake)
+    {
+        /*
+         * Nobody is listening, so count the frame and
+         * treat the reliable data and the frame as acknowledged
+         * at once.
+         */
+        connp->bytes_sent += connp->w.len + connp->c.len;
+        connp->delta_ack = frame_loops;
+        Sockbuf_clear(&connp->w);
+        Sockbuf_clear(&connp->c);
+        return 0;
+    }
     while (connp->motd_offset >= 0 && connp->c.len + connp->w.len < MAX_RELIABLE_DATA_PACKET_SIZE)
     {
         Send_motd(connp);
@@ -2302,6 +2879,7 @@ int Send_end_of_frame(connection_t *connp)
             return 1;
         }
     }
+    connp->bytes_sent += connp->w.len;
     if (Sockbuf_flush(&connp->w) == -1)
     {
         Destroy_connection(connp, "flush error");
@@ -2311,9 +2889,29 @@ int Send_end_of_frame(connection_t *connp)
     return 0;
 }
 
+/*
+ * Send what Send_end_of_frame() left in the datagram batch and
+ * close the connections whose sockets failed.
+ */
+void Send_frames_flush(void)
+{
+    int i;
+    connection_t *connp;
+
+    if (Sockbuf_batch_flush() == 0)
+        return;
+    for (i = 0; i < max_connections; i++)
+    {
+        connp = &Conn[i];
+        if (connp->state != CONN_FREE && BIT(connp->w.state, SOCKBUF_ERROR))
+            Destroy_connection(connp, "flush error");
+    }
+}
+
 static int Receive_keyboard(connection_t *connp)
 {
     player_t *pl;
+    int n;
     long change;
     uint8_t ch;
     int size = KEYBOARD_SIZE;
@@ -2331,7 +2929,12 @@ static int Receive_keyboard(connection_t *connp)
          */
         return 0;
     }
-    Packet_scanf(&connp->r, "%c%ld", &ch, &change);
+    if ((n = Packet_read<pkt_c, pkt_ld>(&connp->r, &ch, &change)) <= 0)
+    {
+        if (n == -1)
+            Destroy_connection(connp, "read error");
+        return n;
+    }
     if (change <= connp->last_key_change)
     {
         /*
@@ -2370,7 +2973,7 @@ static int Receive_play(connection_t *connp)
     int n;
     char errmsg[MAX_CHARS];
 
-    if ((n = Packet_scanf(&connp->r, "%c", &ch)) != 1)
+    if ((n = Packet_read<pkt_c>(&connp->r, &ch)) != 1)
     {
         warn("Cannot receive play packet");
         Destroy_connection(connp, "receive error");
@@ -2421,7 +3024,7 @@ static int Receive_power(connection_t *connp)
     double power;
     int autopilot;
 
-    if ((n = Packet_scanf(&connp->r, "%c%hd", &ch, &tmp)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd>(&connp->r, &ch, &tmp)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read error");
@@ -2495,13 +3098,12 @@ int Send_reliable(connection_t *connp)
     const int max_packet_size = MAX_RELIABLE_DATA_PACKET_SIZE,
               min_send_size = 1; /* was 4 in 3.0.7, 1 in 3.1.0 */
 
-    if (connp->c.len <= 0 || connp->last_send_loops == main_loops)
+    max_todo = Reliable_pending(connp, &read_buf);
+    if (max_todo <= 0 || connp->last_send_loops == main_loops)
     {
         connp->last_send_loops = main_loops;
         return 0;
     }
-    read_buf = connp->c.buf;
-    max_todo = connp->c.len;
     rel_off = connp->reliable_offset;
     if (connp->w.len > 0)
     {
@@ -2545,8 +3147,8 @@ int Send_reliable(connection_t *connp)
     for (i = 0; i <= connp->acks && todo > 0; i++)
     {
         len = (todo > max_packet_size) ? max_packet_size : todo;
-        if (Packet_printf(&connp->w, "%c%hd%ld%ld", PKT_RELIABLE,
-                          len, rel_off, main_loops) <= 0 ||
+        if (Packet_write<pkt_c, pkt_hd, pkt_ld, pkt_ld>(&connp->w, PKT_RELIABLE,
+                                                        len, rel_off, main_loops) <= 0 ||
             Sockbuf_write(&connp->w, read_buf, len) != len)
         {
             error("Cannot write reliable data");
@@ -2615,7 +3217,7 @@ int Send_reliable(connection_t *connp)
 
 static int Receive_ack(connection_t *connp)
 {
-    int n;
+    int n, len;
     uint8_t ch;
     long rel,
         rtt, /* RoundTrip Time */
@@ -2623,8 +3225,8 @@ static int Receive_ack(connection_t *connp)
         delta,
         rel_loops;
 
-    if ((n = Packet_scanf(&connp->r, "%c%ld%ld",
-                          &ch, &rel, &rel_loops)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld, pkt_ld>(&connp->r,
+                                                &ch, &rel, &rel_loops)) <= 0)
     {
         warn("Cannot read ack packet (%d)", n);
         Destroy_connection(connp, "read error");
@@ -2639,6 +3241,8 @@ static int Receive_ack(connection_t *connp)
     rtt = main_loops - rel_loops;
     if (rtt > 0 && rtt <= MAX_RTT)
     {
+        if (connp->rtt_min == 0 || rtt < connp->rtt_min)
+            connp->rtt_min = rtt;
         /*
          * These roundtrip estimation calculations are derived from Comer's
          * books "Internetworking with TCP/IP" parts I & II.
@@ -2688,11 +3292,11 @@ static int Receive_ack(connection_t *connp)
         }
     }
     diff = rel - connp->reliable_offset;
-    if (diff > connp->c.len)
+    if (diff > (len = Reliable_pending(connp, NULL)))
     {
         /* Impossible to ack data that has not been send */
         warn("Bad ack (diff=%ld,cru=%ld,c=%ld,len=%d)",
-             diff, rel, connp->reliable_offset, connp->c.len);
+             diff, rel, connp->reliable_offset, len);
         Destroy_connection(connp, "bad ack");
         return -1;
     }
@@ -2701,8 +3305,15 @@ static int Receive_ack(connection_t *connp)
         /* Late or duplicate ack of old data.  Discard. */
         return 1;
     }
-    Sockbuf_advance(&connp->c, (int)diff);
+    if (connp->c.len > 0)
+        Sockbuf_advance(&connp->c, (int)diff);
     connp->reliable_offset += diff;
+    if (connp->setup_blob != NULL && connp->reliable_offset - connp->setup_base >= connp->setup_blob->len)
+    {
+        /* All of the setup has arrived. */
+        Setup_blob_put(connp->setup_blob);
+        connp->setup_blob = NULL;
+    }
     if ((n = ((diff + 512 - 1) / 512)) > connp->acks)
     {
         connp->acks = n;
@@ -2754,8 +3365,8 @@ static int Receive_ack_cannon(connection_t *connp)
     int n;
     unsigned short num;
 
-    if ((n = Packet_scanf(&connp->r, "%c%ld%hu",
-                          &ch, &loops_ack, &num)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld, pkt_hu>(&connp->r,
+                                                &ch, &loops_ack, &num)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read error");
@@ -2767,7 +3378,7 @@ static int Receive_ack_cannon(connection_t *connp)
         return -1;
     }
     if (loops_ack > world->cannon[num].last_change)
-        SET_BIT(world->cannon[num].conn_mask, 1 << connp->conn_index);
+        Conn_mask_set(&world->cannon[num].conn_mask, connp->conn_index);
 
     return 1;
 }
@@ -2779,8 +3390,8 @@ static int Receive_ack_fuel(connection_t *connp)
     int n;
     unsigned short num;
 
-    if ((n = Packet_scanf(&connp->r, "%c%ld%hu",
-                          &ch, &loops_ack, &num)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld, pkt_hu>(&connp->r,
+                                                &ch, &loops_ack, &num)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read error");
@@ -2792,7 +3403,7 @@ static int Receive_ack_fuel(connection_t *connp)
         return -1;
     }
     if (loops_ack > world->fuel[num].last_change)
-        SET_BIT(world->fuel[num].conn_mask, 1 << connp->conn_index);
+        Conn_mask_set(&world->fuel[num].conn_mask, connp->conn_index);
     return 1;
 }
 
@@ -2803,8 +3414,8 @@ static int Receive_ack_target(connection_t *connp)
     int n;
     unsigned short num;
 
-    if ((n = Packet_scanf(&connp->r, "%c%ld%hu",
-                          &ch, &loops_ack, &num)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld, pkt_hu>(&connp->r,
+                                                &ch, &loops_ack, &num)) <= 0)
     {
         if (n == -1)
         {
@@ -2831,8 +3442,8 @@ static int Receive_ack_target(connection_t *connp)
      */
     if (loops_ack > world->targets[num].last_change)
     {
-        SET_BIT(world->targets[num].conn_mask, 1 << connp->conn_index);
-        CLR_BIT(world->targets[num].update_mask, 1 << connp->conn_index);
+        Conn_mask_set(&world->targets[num].conn_mask, connp->conn_index);
+        Conn_mask_clear(&world->targets[num].update_mask, connp->conn_index);
     }
     return 1;
 }
@@ -2845,8 +3456,8 @@ static int Receive_ack_polystyle(connection_t *connp)
     unsigned short num;
     poly_t *poly;
 
-    if ((n = Packet_scanf(&connp->r, "%c%ld%hu",
-                          &ch, &loops_ack, &num)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld, pkt_hu>(&connp->r,
+                                                &ch, &loops_ack, &num)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read error");
@@ -2859,7 +3470,27 @@ static int Receive_ack_polystyle(connection_t *connp)
     }
     poly = &pdata[num];
     if (loops_ack > poly->last_change)
-        CLR_BIT(poly->update_mask, 1 << connp->ind);
+        Conn_mask_clear(&poly->update_mask, connp->conn_index);
+    return 1;
+}
+
+/*
+ * The client has frame loops_ack, deltas can be made against it.
+ */
+static int Receive_ack_frame(connection_t *connp)
+{
+    long loops_ack;
+    uint8_t ch;
+    int n;
+
+    if ((n = Packet_read<pkt_c, pkt_ld>(&connp->r, &ch, &loops_ack)) <= 0)
+    {
+        if (n == -1)
+            Destroy_connection(connp, "read error");
+        return n;
+    }
+    if (loops_ack > connp->delta_ack && loops_ack <= frame_loops)
+        connp->delta_ack = loops_ack;
     return 1;
 }
 
@@ -2968,7 +3599,7 @@ static int Receive_talk(connection_t *connp)
     long seq;
     char str[MAX_CHARS];
 
-    if ((n = Packet_scanf(&connp->r, "%c%ld%s", &ch, &seq, str)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld, pkt_s>(&connp->r, &ch, &seq, str)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read error");
@@ -2976,7 +3607,7 @@ static int Receive_talk(connection_t *connp)
     }
     if (seq > connp->talk_sequence_num)
     {
-        if ((n = Packet_printf(&connp->c, "%c%ld", PKT_TALK_ACK, seq)) <= 0)
+        if ((n = Packet_write<pkt_c, pkt_ld>(&connp->c, PKT_TALK_ACK, seq)) <= 0)
         {
             if (n == -1)
                 Destroy_connection(connp, "write error");
@@ -2997,8 +3628,8 @@ static int Receive_display(connection_t *connp)
     short width, height;
     int n;
 
-    if ((n = Packet_scanf(&connp->r, "%c%hd%hd%c%c", &ch, &width, &height,
-                          &debris_colors, &spark_rand)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd, pkt_hd, pkt_c, pkt_c>(&connp->r, &ch, &width, &height,
+                                                              &debris_colors, &spark_rand)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read error");
@@ -3039,7 +3670,7 @@ static int Receive_modifier_bank(connection_t *connp)
     modifiers_t mods;
     int n;
 
-    if ((n = Packet_scanf(&connp->r, "%c%c%s", &ch, &bank, str)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_c, pkt_s>(&connp->r, &ch, &bank, str)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read modbank");
@@ -3155,13 +3786,13 @@ static int Receive_shape(connection_t *connp)
     char ch;
     char str[2 * MSG_LEN];
 
-    if ((n = Packet_scanf(&connp->r, "%c%S", &ch, str)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_S>(&connp->r, &ch, str)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read shape");
         return n;
     }
-    if ((n = Packet_scanf(&connp->r, "%S", &str[strlen(str)])) <= 0)
+    if ((n = Packet_read<pkt_S>(&connp->r, &str[strlen(str)])) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read shape ext");
@@ -3181,9 +3812,8 @@ static int Receive_motd(connection_t *connp)
     int n;
     long bytes;
 
-    if ((n = Packet_scanf(&connp->r,
-                          "%c%ld%ld",
-                          &ch, &offset, &bytes)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_ld, pkt_ld>(&connp->r,
+                                                &ch, &offset, &bytes)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read error");
@@ -3305,9 +3935,8 @@ static int Send_motd(connection_t *connp)
             len = 0;
             connp->motd_offset = -1;
         }
-        if (Packet_printf(&connp->c,
-                          "%c%ld%hd%ld",
-                          PKT_MOTD, off, len, size) <= 0)
+        if (Packet_write<pkt_c, pkt_ld, pkt_hd, pkt_ld>(&connp->c,
+                                                        PKT_MOTD, off, len, size) <= 0)
         {
             Destroy_connection(connp, "motd header");
             return -1;
@@ -3335,7 +3964,7 @@ static int Receive_pointer_move(connection_t *connp)
     int n;
     double turnspeed, turndir;
 
-    if ((n = Packet_scanf(&connp->r, "%c%hd", &ch, &movement)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_hd>(&connp->r, &ch, &movement)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read error");
@@ -3381,7 +4010,7 @@ static int Receive_fps_request(connection_t *connp)
     uint8_t ch;
     uint8_t fps;
 
-    if ((n = Packet_scanf(&connp->r, "%c%c", &ch, &fps)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_c>(&connp->r, &ch, &fps)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read error");
@@ -3412,7 +4041,7 @@ static int Receive_audio_request(connection_t *connp)
     uint8_t ch;
     uint8_t onoff;
 
-    if ((n = Packet_scanf(&connp->r, "%c%c", &ch, &onoff)) <= 0)
+    if ((n = Packet_read<pkt_c, pkt_c>(&connp->r, &ch, &onoff)) <= 0)
     {
         if (n == -1)
             Destroy_connection(connp, "read error");
@@ -33,6 +33,7 @@ void Destroy_connection(connection_t *connp, const char *reason);
 int Check_connection(char *real, char *nick, char *dpy, char *addr);
 int Setup_connection(char *real, char *nick, char *dpy, int team,
                      char *addr, char *host, unsigned version);
+int Setup_fake_connection(char *nick);
 int Input(void);
 int Send_reply(connection_t *connp, int replyto, int result);
 int Send_self(connection_t *connp, player_t *pl,
@@ -84,6 +85,7 @@ int Send_message(connection_t *connp, const char *msg);
 int Send_loseitem(int lose_item_index, connection_t *connp);
 int Send_start_of_frame(connection_t *connp);
 int Send_end_of_frame(connection_t *connp);
+void Send_frames_flush(void);
 int Send_reliable(connection_t *connp);
 int Send_time_left(connection_t *connp, long sec);
 int Send_eyes(connection_t *connp, int id);
@@ -111,5 +113,6 @@ int Check_max_clients_per_IP(char *host_addr);
 #define F_CUMULATIVETURN (1 << 9)
 #define F_BALLSTYLE (1 << 10)
 #define F_POLYSTYLE (1 << 11)
+#define F_DELTA (1 << 12)
 
 #endif
@@ -118,6 +118,127 @@ void Object_free_ptr(object_t *obj)
 
 static anyobject_t *objArray;
 
+/*
+ * Ecms, transporters and laser pulses only live for a few frames.
+ * Rather than a malloc() and a free() for each of them they come
+ * from a fixed pool per type, allocated together with the shots.
+ * A freed record goes on the free list of its pool and is handed
+ * out again by the next allocation, so a running game does not
+ * touch the heap for them at all.
+ */
+typedef struct
+{
+    const char *name;
+    size_t size;      /* size of one record */
+    int capacity;     /* number of records in the slab */
+    char *slab;       /* memory of all records */
+    void **free_list; /* unused records, last freed on top */
+    int num_free;
+    int high_water;   /* most records in use at once */
+    long allocs;
+} pool_t;
+
+static pool_t pools[NUM_POOLS] = {
+    {"ecm", sizeof(ecm_t), MAX_TOTAL_ECMS, NULL, NULL, 0, 0, 0},
+    {"transporter", sizeof(trans_t), MAX_TOTAL_TRANSPORTERS, NULL, NULL, 0, 0, 0},
+    {"pulse", sizeof(pulse_t), MAX_TOTAL_PULSES, NULL, NULL, 0, 0, 0},
+};
+
+static void Pool_init(pool_t *pool)
+{
+    int i;
+
+    pool->slab = XCALLOC(char, pool->size * pool->capacity);
+    pool->free_list = XMALLOC(void *, pool->capacity);
+    if (!pool->slab || !pool->free_list)
+    {
+        error("Not enough memory for %s pool.", pool->name);
+        exit(1);
+    }
+    /* Hand out the records in address order. */
+    for (i = 0; i < pool->capacity; i++)
+        pool->free_list[i] = pool->slab + (pool->capacity - 1 - i) * pool->size;
+    pool->num_free = pool->capacity;
+    pool->high_water = 0;
+    pool->allocs = 0;
+}
+
+static void Pool_cleanup(pool_t *pool)
+{
+    if (pool->slab)
+        xpinfo("Pool %s: %d of %d used at most, %ld allocations",
+               pool->name, pool->high_water, pool->capacity, pool->allocs);
+    XFREE(pool->slab);
+    XFREE(pool->free_list);
+    pool->num_free = 0;
+}
+
+static void *Pool_allocate(pool_t *pool)
+{
+    int in_use;
+
+    if (pool->num_free <= 0)
+        return NULL;
+
+    in_use = pool->capacity - pool->num_free + 1;
+    if (in_use > pool->high_water)
+        pool->high_water = in_use;
+    pool->allocs++;
+
+    return pool->free_list[--pool->num_free];
+}
+
+static void Pool_free(pool_t *pool, void *ptr)
+{
+    if (pool->num_free >= pool->capacity)
+    {
+        warn("Pool_free: %s pool is already full", pool->name);
+        return;
+    }
+    pool->free_list[pool->num_free++] = ptr;
+}
+
+ecm_t *Ecm_allocate(void)
+{
+    return (ecm_t *)Pool_allocate(&pools[POOL_ECM]);
+}
+
+void Ecm_free(ecm_t *ecm)
+{
+    Pool_free(&pools[POOL_ECM], ecm);
+}
+
+trans_t *Transporter_allocate(void)
+{
+    return (trans_t *)Pool_allocate(&pools[POOL_TRANSPORTER]);
+}
+
+void Transporter_free(trans_t *trans)
+{
+    Pool_free(&pools[POOL_TRANSPORTER], trans);
+}
+
+pulse_t *Pulse_allocate(void)
+{
+    return (pulse_t *)Pool_allocate(&pools[POOL_PULSE]);
+}
+
+void Pulse_free(pulse_t *pulse)
+{
+    Pool_free(&pools[POOL_PULSE], pulse);
+}
+
+void Pool_get_stats(int pool, pool_stats_t *stats)
+{
+    pool_t *p = &pools[pool];
+
+    stats->name = p->name;
+    stats->in_use = p->capacity - p->num_free;
+    stats->high_water = p->high_water;
+    stats->capacity = p->capacity;
+    stats->allocs = p->allocs;
+}
+
 #define SHOWTYPESIZE(T) warn("sizeof(" #T ") = %d", sizeof(T))
 
 void Alloc_shots(int number)
@@ -161,11 +282,18 @@ void Alloc_shots(int number)
         Cell_init_object(Obj[i]);
         x++;
     }
+
+    for (i = 0; i < NUM_POOLS; i++)
+        Pool_init(&pools[i]);
 }
 
 void Free_shots(void)
 {
+    int i;
+
     XFREE(objArray);
+    for (i = 0; i < NUM_POOLS; i++)
+        Pool_cleanup(&pools[i]);
 }
 
 // TODO: Remove pixel positions, store only subpixel position (i.e. clicks)
@@ -139,16 +139,6 @@ struct _objposition
 #define OBJ_X_IN_BLOCKS(obj) CLICK_TO_BLOCK((obj)->pos.cx)
 #define OBJ_Y_IN_BLOCKS(obj) CLICK_TO_BLOCK((obj)->pos.cy)
 
-/*
- * Node within a Cell list.
- */
-typedef struct cell_node cell_node_t;
-struct cell_node
-{
-    cell_node_t *next;
-    cell_node_t *prev;
-};
-
 #define OBJECT_BASE                                      \
     short id;            /* For shots => id of player */ \
     unsigned short team; /* Team of player or cannon */  \
@@ -167,11 +157,11 @@ struct cell_node
     /* up to here all object types are the same as all player types. */
 
 #define OBJECT_EXTEND                              \
-    cell_node cell; /* node in cell linked list */ \
-    long info;      /* Miscellaneous info */       \
-    long fuselife;  /* fuse duration ticks */      \
-    int pl_range;   /* distance for collision */   \
-    int pl_radius;  /* distance for hit */         \
+    int cell;      /* grid cell, -1 if not in grid */ \
+    long info;     /* Miscellaneous info */         \
+    long fuselife; /* fuse duration ticks */        \
+    int pl_range;  /* distance for collision */     \
+    int pl_radius; /* distance for hit */           \
 /* up to here all object types are the same. */
 
 /*
@@ -193,6 +183,15 @@ struct _object
 #define OBJ_PTR(ptr) ((object_t *)(ptr))
 };
 
+/*
+ * Run of objects sharing one grid cell, see Cell_get_spans().
+ */
+typedef struct
+{
+    object_t **objs;
+    int num;
+} cell_span_t;
+
 /*
  * Mine object
  */
@@ -409,6 +408,26 @@ typedef struct
     int count;
 } trans_t;
 
+/*
+ * Pools of the short lived ecm, transporter and pulse records.
+ */
+enum
+{
+    POOL_ECM,
+    POOL_TRANSPORTER,
+    POOL_PULSE,
+    NUM_POOLS
+};
+
+typedef struct
+{
+    const char *name;
+    int in_use;     /* records handed out now */
+    int high_water; /* most records in use at once */
+    int capacity;
+    long allocs;    /* allocations since startup */
+} pool_stats_t;
+
 /*
  * Shove-information.
  *
@@ -256,6 +256,21 @@ typedef struct options
     int roundsToPlay; /* # of rounds to play. */
 
     int maxVisibleObject; /* how many objects a player can see */
+    int frameThreads;     /* threads used for building frames */
+    int robotThreads;     /* threads used for robots looking around */
+
+    double robotTimeBudget;  /* ms per frame for off screen robots */
+    double robotLodDistance; /* off screen robots this near play more */
+    int robotLodNearRate;    /* frames between turns of near robots */
+    int robotLodFarRate;     /* frames between turns of far robots */
+
+    bool batchSend;       /* send frame datagrams in batches */
+    bool deltaFrames;     /* delta code self and ships if client can */
+    bool adaptiveFrames;  /* thin frames of congested clients */
+    int clientByteRate;   /* max. bytes per second to one client */
+    bool profile;          /* time the phases of each tick */
+    char *profileFileName; /* where to append the timings */
+    int profileInterval;   /* seconds between timing dumps */
     bool pLockServer;     /* Is server swappable out of memory?  */
     bool ignore20MaxFPS;  /* ignore client maxFPS request if 20 */
     int timerResolution;  /* OS timer resolution (times/sec) */
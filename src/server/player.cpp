@@ -44,6 +44,7 @@
 #include "xperror.h"
 #include "object.h"
 #include "xpmath.h"
+#include "navigate.h"
 
 bool updateScores = true;
 
@@ -753,10 +754,11 @@ void Reset_all_players(void)
                 if (world->targets[i].damage != TARGET_DAMAGE || world->targets[i].dead_time != 0)
                 {
                     world->block[world->targets[i].blk_pos.x][world->targets[i].blk_pos.y] = TARGET;
+                    Navigation_changed();
                     world->targets[i].dead_time = 0;
                     world->targets[i].damage = TARGET_DAMAGE;
-                    world->targets[i].conn_mask = 0;
-                    world->targets[i].update_mask = (unsigned)-1;
+                    Conn_mask_clear_all(&world->targets[i].conn_mask);
+                    Conn_mask_set_all(&world->targets[i].update_mask);
                     world->targets[i].last_change = frame_loops;
                 }
             }
@@ -1764,7 +1766,7 @@ void Delete_player(int ind)
         {
             if (Pulses[i]->id == pl->id)
             {
-                free(Pulses[i]);
+                Pulse_free(Pulses[i]);
                 if (--NumPulses > i)
                 {
                     Pulses[i] = Pulses[NumPulses];
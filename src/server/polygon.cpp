@@ -167,7 +167,7 @@ void P_start_polygon(clpos_t pos, int style)
     t.estyles_start = ecount;
     t.is_decor = is_decor;
 
-    t.update_mask = 0;
+    Conn_mask_clear_all(&t.update_mask);
     t.last_change = frame_loops;
 
     current_estyle = pstyles[style].defedge_id;
@@ -27,6 +27,7 @@
 #include <cstdint>
 
 #include "click.h"
+#include "map.h"
 #include "object.h"
 
 // From walls2
@@ -67,7 +68,7 @@ typedef struct
     int estyles_start;
     int num_echanges;
     int is_decor;
-    unsigned update_mask;
+    conn_mask_t update_mask;
     long last_change;
 } poly_t;
 
@@ -0,0 +1,219 @@
+/*
+ * XPilot, a multiplayer gravity war game.  Copyright (C) 1991-2001 by
+ *
+ *      Bjørn Stabell
+ *      Ken Ronny Schouten
+ *      Bert Gijsbers
+ *      Dick Balaska
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+#include <algorithm>
+
+#include "commonmacros.h"
+#include "strdup.h"
+
+#define SERVER
+#include "xpconfig.h"
+#include "serverconst.h"
+#include "global.h"
+#include "xperror.h"
+#include "profile.h"
+
+/*
+ * Number of recent durations kept per phase.  For the per tick phases
+ * this is more than a minute at normal frame rates.
+ */
+#define PROFILE_SAMPLES 1024
+
+typedef struct
+{
+    uint32_t samples[PROFILE_SAMPLES]; /* nanoseconds, ring buffer */
+    int num_samples;
+    int next_sample;
+    long count;
+} profile_phase_t;
+
+static profile_phase_t phases[NUM_PROFILE_PHASES];
+static const char *phase_names[NUM_PROFILE_PHASES] = {
+    "input",
+    "robots",
+    "shots",
+    "asteroids",
+    "collision",
+    "frames",
+    "frameconn",
+    "queue",
+    "tick",
+};
+static FILE *profile_fp;
+static char *profile_fp_name;
+static time_t last_dump_time;
+
+uint64_t Profile_now(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/*
+ * Returns 0 when profiling is off, so that the clock is only read
+ * when the result is used.
+ */
+uint64_t Profile_start(void)
+{
+    if (!options.profile)
+        return 0;
+    return Profile_now();
+}
+
+void Profile_stop(int phase, uint64_t start)
+{
+    if (start == 0)
+        return;
+    Profile_add(phase, Profile_now() - start);
+}
+
+void Profile_add(int phase, uint64_t nsec)
+{
+    profile_phase_t *ph = &phases[phase];
+
+    if (!options.profile)
+        return;
+    ph->samples[ph->next_sample] = (uint32_t)MIN(nsec, (uint64_t)UINT32_MAX);
+    if (++ph->next_sample >= PROFILE_SAMPLES)
+        ph->next_sample = 0;
+    if (ph->num_samples < PROFILE_SAMPLES)
+        ph->num_samples++;
+    ph->count++;
+}
+
+void Profile_reset(void)
+{
+    memset(phases, 0, sizeof(phases));
+}
+
+const char *Profile_phase_name(int phase)
+{
+    return phase_names[phase];
+}
+
+int Profile_phase_by_name(const char *name)
+{
+    int i;
+
+    for (i = 0; i < NUM_PROFILE_PHASES; i++)
+    {
+        if (!strcasecmp(name, phase_names[i]))
+            return i;
+    }
+    return -1;
+}
+
+void Profile_get_stats(int phase, profile_stats_t *stats)
+{
+    profile_phase_t *ph = &phases[phase];
+    uint32_t sorted[PROFILE_SAMPLES];
+    double sum = 0;
+    int i, n = ph->num_samples;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = ph->count;
+    if (n == 0)
+        return;
+    memcpy(sorted, ph->samples, n * sizeof(sorted[0]));
+    std::sort(sorted, sorted + n);
+    for (i = 0; i < n; i++)
+        sum += sorted[i];
+    stats->mean = sum / n / 1e3;
+    stats->p50 = sorted[(n - 1) / 2] / 1e3;
+    stats->p99 = sorted[(n - 1) * 99 / 100] / 1e3;
+    stats->max = sorted[n - 1] / 1e3;
+}
+
+static void Profile_close_file(void)
+{
+    if (profile_fp)
+    {
+        fclose(profile_fp);
+        profile_fp = NULL;
+    }
+    XFREE(profile_fp_name);
+}
+
+/*
+ * Append one line per phase to the profile file.
+ */
+static void Profile_dump(time_t now)
+{
+    profile_stats_t stats;
+    int i;
+
+    if (!profile_fp_name || strcmp(profile_fp_name, options.profileFileName))
+    {
+        Profile_close_file();
+        if ((profile_fp = fopen(options.profileFileName, "a")) == NULL)
+        {
+            error("Can't open profile file \"%s\"", options.profileFileName);
+            /* don't try again until the option is changed. */
+            profile_fp_name = xp_strdup(options.profileFileName);
+            return;
+        }
+        profile_fp_name = xp_strdup(options.profileFileName);
+        if (ftell(profile_fp) == 0)
+            fprintf(profile_fp, "time,loops,phase,count,mean_us,p50_us,p99_us,max_us\n");
+    }
+    if (!profile_fp)
+        return;
+
+    for (i = 0; i < NUM_PROFILE_PHASES; i++)
+    {
+        Profile_get_stats(i, &stats);
+        fprintf(profile_fp, "%ld,%ld,%s,%ld,%.1f,%.1f,%.1f,%.1f\n",
+                (long)now, main_loops, phase_names[i], stats.count,
+                stats.mean, stats.p50, stats.p99, stats.max);
+    }
+    fflush(profile_fp);
+}
+
+/*
+ * Called once at the end of each tick.
+ */
+void Profile_tick(void)
+{
+    time_t now;
+
+    if (!options.profile || !options.profileFileName || !*options.profileFileName || options.profileInterval <= 0)
+        return;
+
+    now = time(NULL);
+    if (last_dump_time == 0)
+        last_dump_time = now;
+    if (now - last_dump_time < options.profileInterval)
+        return;
+    last_dump_time = now;
+    Profile_dump(now);
+}
+
+void Profile_cleanup(void)
+{
+    Profile_close_file();
+}
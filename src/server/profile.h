@@ -0,0 +1,70 @@
+/*
+ * XPilot, a multiplayer gravity war game.  Copyright (C) 1991-2001 by
+ *
+ *      Bjørn Stabell
+ *      Ken Ronny Schouten
+ *      Bert Gijsbers
+ *      Dick Balaska
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Timing of the phases of a server tick.
+ * When the profile option is on, each phase keeps its most recent
+ * durations so that percentiles can be shown with the /profile
+ * command and written to profileFileName every profileInterval seconds.
+ */
+enum
+{
+    PROFILE_INPUT,
+    PROFILE_ROBOTS,
+    PROFILE_SHOTS,
+    PROFILE_ASTEROIDS,
+    PROFILE_COLLISION,
+    PROFILE_FRAMES,
+    PROFILE_FRAME_CONN, /* building one frame for one connection */
+    PROFILE_QUEUE,
+    PROFILE_TICK,
+    NUM_PROFILE_PHASES
+};
+
+typedef struct
+{
+    long count;   /* durations recorded since the last reset */
+    double mean;  /* all in microseconds, over the recent window */
+    double p50;
+    double p99;
+    double max;
+} profile_stats_t;
+
+uint64_t Profile_start(void);
+void Profile_stop(int phase, uint64_t start);
+void Profile_add(int phase, uint64_t nsec);
+uint64_t Profile_now(void);
+void Profile_tick(void);
+void Profile_reset(void);
+int Profile_phase_by_name(const char *name);
+const char *Profile_phase_name(int phase);
+void Profile_get_stats(int phase, profile_stats_t *stats);
+void Profile_cleanup(void);
+
+#endif
@@ -31,8 +31,11 @@
 
 #include <unistd.h>
 
+#include "commonmacros.h"
 #include "const.h"
 #include "strlcpy.h"
+#include "threadpool.h"
+#include "profile.h"
 
 #define SERVER
 #include "xpconfig.h"
@@ -654,7 +657,7 @@ static void Robot_talks(enum robot_talk_t says_what,
     Set_message(msg);
 }
 
-static void Robot_create(void)
+void Robot_create(void)
 {
     player_t *robot;
     robot_t *rob;
@@ -677,6 +680,7 @@ static void Robot_create(void)
         return;
     }
     new_data->private_data = NULL;
+    new_data->last_play = frame_loops;
 
     most_used = 0;
     for (i = 0; i < MAX_ROBOTS; i++)
@@ -1051,19 +1055,223 @@ static void Tank_play(int ind)
     }
 }
 
+/*
+ * Robots which look around this loop.
+ */
+static int think_ind[NUM_IDS];
+static int num_think;
+
+/*
+ * Level of detail.  Robots on somebody's screen play every loop.
+ * Robots off screen play every robotLodNearRate loops when they are
+ * within robotLodDistance of what some player is looking at, and every
+ * robotLodFarRate loops otherwise.  Their turns are spread over the
+ * loops by id, and a robot keeps its controls between turns.
+ * With a robotTimeBudget the off screen robots whose turn it is
+ * only play as long as the estimated time allows, the most overdue
+ * ones first; the others try again on the next loop.
+ */
+typedef struct
+{
+    double x, y; /* pixels */
+    double w, h; /* half the view size plus a margin */
+} robot_viewer_t;
+
+typedef struct
+{
+    int ind;
+    long overdue;
+} robot_due_t;
+
+#define ROBOT_VIEW_MARGIN (4 * BLOCK_SZ)
+
+static bool robot_plays[NUM_IDS];
+static robot_viewer_t robot_viewers[NUM_IDS];
+static int num_robot_viewers;
+static double robot_play_nsec; /* running mean time per robot turn */
+static robot_lod_stats_t lod_stats;
+
+void Robot_get_lod_stats(robot_lod_stats_t *stats)
+{
+    *stats = lod_stats;
+}
+
+static void Robot_find_viewers(void)
+{
+    int i, width, height, debris_colors, spark_rand;
+    player_t *pl, *view;
+    robot_viewer_t *v;
+
+    num_robot_viewers = 0;
+    for (i = 0; i < NumPlayers; i++)
+    {
+        pl = PlayersArray[i];
+        if (pl->conn == NULL)
+            continue;
+
+        /* dead or paused players may look through somebody else. */
+        view = pl;
+        if (BIT(pl->status, PLAYING | GAME_OVER | PAUSE) != PLAYING && BIT(pl->lock.tagged, LOCK_PLAYER) && GetInd[pl->lock.pl_id] >= 0 && GetInd[pl->lock.pl_id] < NumPlayers)
+            view = PlayersArray[GetInd[pl->lock.pl_id]];
+
+        Get_display_parameters(pl->conn, &width, &height,
+                               &debris_colors, &spark_rand);
+        v = &robot_viewers[num_robot_viewers++];
+        v->x = view->pos.x;
+        v->y = view->pos.y;
+        v->w = width / 2 + ROBOT_VIEW_MARGIN;
+        v->h = height / 2 + ROBOT_VIEW_MARGIN;
+    }
+}
+
+/*
+ * How many loops pass between the turns of this robot.
+ */
+static int Robot_lod_rate(player_t *pl)
+{
+    int i;
+    double dx, dy;
+    bool near = false;
+    robot_viewer_t *v;
+
+    if (options.robotLodNearRate <= 1 && options.robotLodFarRate <= 1)
+        return 1;
+
+    for (i = 0; i < num_robot_viewers; i++)
+    {
+        v = &robot_viewers[i];
+        dx = WRAP_DX(pl->pos.x - v->x);
+        dy = WRAP_DY(pl->pos.y - v->y);
+        if (ABS(dx) < v->w && ABS(dy) < v->h)
+            return 1;
+        if (!near && LENGTH(dx, dy) < options.robotLodDistance)
+            near = true;
+    }
+
+    return MAX(1, near ? options.robotLodNearRate : options.robotLodFarRate);
+}
+
+static int Compare_robot_due(const void *a, const void *b)
+{
+    const robot_due_t *da = (const robot_due_t *)a;
+    const robot_due_t *db = (const robot_due_t *)b;
+
+    if (da->overdue != db->overdue)
+        return (da->overdue > db->overdue) ? -1 : 1;
+    return da->ind - db->ind;
+}
+
+/*
+ * Decide which robots play this loop and collect the ones
+ * among them that look around first.
+ */
+static int Robot_lod_select(void)
+{
+    static robot_due_t due[NUM_IDS];
+    int i, rate, num_due, num_full, allowed, num_play;
+    long since;
+    player_t *pl;
+    robot_data_t *data;
+
+    Robot_find_viewers();
+
+    num_due = 0;
+    num_full = 0;
+    for (i = 0; i < NumPlayers; i++)
+    {
+        pl = PlayersArray[i];
+        robot_plays[i] = false;
+        if (!Player_is_robot(pl) || BIT(pl->status, PLAYING | GAME_OVER) != PLAYING)
+            continue;
+
+        data = pl->robot_data_ptr;
+        since = frame_loops - data->last_play;
+        rate = Robot_lod_rate(pl);
+        if (rate <= 1)
+        {
+            robot_plays[i] = true;
+            num_full++;
+        }
+        else if ((frame_loops + pl->id) % rate == 0 || since >= rate)
+        {
+            due[num_due].ind = i;
+            due[num_due].overdue = since - rate;
+            num_due++;
+        }
+        else
+            lod_stats.skipped++;
+    }
+
+    allowed = num_due;
+    if (options.robotTimeBudget > 0 && robot_play_nsec > 0 && num_due > 0)
+    {
+        allowed = (int)(options.robotTimeBudget * 1e6 / robot_play_nsec) - num_full;
+        /* the most overdue robot always plays, so nobody waits forever. */
+        LIMIT(allowed, 1, num_due);
+        if (allowed < num_due)
+            qsort(due, num_due, sizeof(due[0]), Compare_robot_due);
+    }
+    for (i = 0; i < num_due; i++)
+    {
+        if (i < allowed)
+            robot_plays[due[i].ind] = true;
+        else
+            lod_stats.deferred++;
+    }
+    lod_stats.full += num_full;
+    lod_stats.reduced += allowed;
+
+    num_think = 0;
+    num_play = 0;
+    for (i = 0; i < NumPlayers; i++)
+    {
+        if (!robot_plays[i])
+            continue;
+        pl = PlayersArray[i];
+        pl->robot_data_ptr->last_play = frame_loops;
+        num_play++;
+        if (robot_types[pl->robot_data_ptr->robot_types_ind].think)
+            think_ind[num_think++] = i;
+    }
+
+    return num_play;
+}
+
+static void Robot_think(int job, void *arg)
+{
+    int ind = think_ind[job];
+
+    UNUSED_PARAM(arg);
+    (*robot_types[PlayersArray[ind]->robot_data_ptr->robot_types_ind].think)(ind);
+}
+
+/*
+ * Whether another robot may join now: the robot limits allow it, there
+ * is a free base, and with restrictRobots one on the robot team.
+ */
+bool Robot_may_join(void)
+{
+    int num_any_ships = NumPlayers + login_in_progress;
+    int num_playing_ships = num_any_ships - NumPseudoPlayers;
+
+    return (num_playing_ships < options.maxRobots ||
+            NumRobots < options.minRobots) &&
+           num_playing_ships < world->NumBases && num_any_ships < NUM_IDS && NumRobots < MAX_ROBOTS && !(BIT(world->rules->mode, TEAM_PLAY) && options.restrictRobots && world->teams[options.robotTeam].NumMembers >= world->teams[options.robotTeam].NumBases);
+}
+
 void Robot_update(void)
 {
     player_t *pl;
-    int i;
+    int i, num_play;
+    uint64_t start;
+    double nsec;
     static int new_robot_delay;
     int num_playing_ships;
     int num_any_ships;
 
     num_any_ships = NumPlayers + login_in_progress;
     num_playing_ships = num_any_ships - NumPseudoPlayers;
-    if ((num_playing_ships < options.maxRobots ||
-         NumRobots < options.minRobots) &&
-        num_playing_ships < world->NumBases && num_any_ships < NUM_IDS && NumRobots < MAX_ROBOTS && !(BIT(world->rules->mode, TEAM_PLAY) && options.restrictRobots && world->teams[options.robotTeam].NumMembers >= world->teams[options.robotTeam].NumBases))
+    if (Robot_may_join())
     {
 
         if (++new_robot_delay >= ROBOT_CREATE_DELAY)
@@ -1091,40 +1299,68 @@ void Robot_update(void)
 
     Robot_round_tick();
 
+    /*
+     * Robots leaving renumber the players, so let them go first.
+     */
     for (i = 0; i < NumPlayers; i++)
     {
         pl = PlayersArray[i];
 
-        if (Player_is_tank(pl))
-        {
-            Tank_play(i);
-            continue;
-        }
-
         if (!Player_is_robot(pl))
             /* Ignore non-robots. */
             continue;
 
-        if (BIT(pl->status, PLAYING | GAME_OVER) != PLAYING)
-        {
-            /* Only check for leave if not being transported to homebase. */
-            if (!pl->count)
-            {
-                if (Robot_check_leave(i))
-                    i--;
-            }
+        /* Only check for leave if not being transported to homebase. */
+        if (BIT(pl->status, PLAYING | GAME_OVER) != PLAYING && pl->count)
             continue;
-        }
 
         if (Robot_check_leave(i))
         {
             i--;
             continue;
         }
+    }
+
+    num_play = Robot_lod_select();
+    start = (options.robotTimeBudget > 0) ? Profile_now() : 0;
+
+    /*
+     * Looking around only reads the game state, so all robots can do
+     * it at once before any of them plays.  They all see the world as
+     * it was at the start of the loop, whatever the number of threads.
+     */
+    if (num_think > 0)
+    {
+        Cell_update();
+        Threadpool_run(options.robotThreads, num_think, Robot_think, NULL);
+    }
+
+    for (i = 0; i < NumPlayers; i++)
+    {
+        pl = PlayersArray[i];
+
+        if (Player_is_tank(pl))
+        {
+            Tank_play(i);
+            continue;
+        }
+
+        /* Not a robot, or not its turn. */
+        if (!robot_plays[i])
+            continue;
 
         /*
          * Let the robot code control this robot.
          */
         Robot_play(i);
     }
+
+    if (start != 0 && num_play > 0)
+    {
+        nsec = (double)(Profile_now() - start) / num_play;
+        if (robot_play_nsec <= 0)
+            robot_play_nsec = nsec;
+        else
+            robot_play_nsec += (nsec - robot_play_nsec) / 16;
+    }
 }
@@ -81,6 +81,13 @@
  *    9) The cleanup function should free any allocated resources
  *       for this specific robot instance.
  *
+ *   10) The optional think function is called each loop for all
+ *       playing robots before any of them plays, possibly on several
+ *       threads at once.  It may only read the game state and write
+ *       to the robot's private data, where the playing function can
+ *       find what it worked out.  This is the place for looking
+ *       around the map, which takes most of the time.
+ *
  * The recommended practice is to define your new robot types
  * in a separate file and to only declare your robot type
  * specific initialisation function prototype in robot.c and add one
@@ -98,6 +105,7 @@ typedef struct
     void (*message)(int ind, const char *str);
     void (*destroy)(int ind);
     void (*invite)(int ind, int inv_ind);
+    void (*think)(int ind);
 } robot_type_t;
 
 /*
@@ -134,8 +142,19 @@ typedef struct robot_data
     int robots_ind;      /* index into Robots[] */
     int robot_types_ind; /* index into robot_types[] */
     void *private_data;  /* robot type private data */
+    long last_play;      /* frame_loops of the last turn */
 } robot_data_t;
 
+/*
+ * An object the default robot may have to react to,
+ * j is its number among all the objects it looked at.
+ */
+typedef struct
+{
+    object_t *obj;
+    int j;
+} robot_threat_t;
+
 /*
  * The private robot instance data for the default robot.
  */
@@ -157,6 +176,17 @@ typedef struct robot_default_data
     int longterm_mode;        /* long term robot mode */
     int lock_last_seen;       /* last time robot saw target */
     position_t lock_last_pos; /* last known position of target */
+
+    /* What Robot_default_think() found at the start of the loop. */
+    int fuel_i, fuel_dist;     /* nearest fuel station */
+    int target_i, target_dist; /* nearest enemy target */
+    int cannon_i;              /* nearest enemy cannon */
+    object_t *item_obj;        /* most wanted item */
+    int item_i, item_dist, item_imp;
+    bool ball_seen;
+    robot_threat_t *threats; /* dangerous objects nearby */
+    int num_threats, max_threats;
+    int num_laser_threats; /* laser pulses about to hit us */
 } robot_default_data_t;
 
 #endif
@@ -31,6 +31,8 @@
 
 #include <unistd.h>
 
+#include "commonmacros.h"
+
 #include "server.h"
 
 #define SERVER
@@ -50,8 +52,11 @@
 #include "xpmath.h"
 #include "object.h"
 #include "walls.h"
+#include "mapindex.h"
+#include "navigate.h"
 
 #define ROB_LOOK_AH 2
+#define ROBOT_MINE_DIST (SHIP_SZ + 200) /* mines further away are ignored */
 
 #define WITHIN(NOW, THEN, DIFF) (NOW <= THEN && (THEN - NOW) < DIFF)
 
@@ -91,6 +96,7 @@ static int Robot_default_war_on_player(int ind);
 static void Robot_default_message(int ind, const char *str);
 static void Robot_default_destroy(int ind);
 static void Robot_default_invite(int ind, int inv_ind);
+static void Robot_default_think(int ind);
 int Robot_default_setup(robot_type_t *type_ptr);
 
 /*
@@ -112,7 +118,8 @@ static robot_type_t robot_default_type = {
     Robot_default_war_on_player,
     Robot_default_message,
     Robot_default_destroy,
-    Robot_default_invite};
+    Robot_default_invite,
+    Robot_default_think};
 
 /*
  * The only thing we export from this file.
@@ -136,7 +143,13 @@ int Robot_default_setup(robot_type_t *type_ptr)
  */
 /*static bool Check_robot_navigate(int ind, bool * num_evade);*/
 static bool Check_robot_evade(int ind, int mine_i, int ship_i);
+static void Robot_default_think_map(player_t *pl,
+                                    robot_default_data_t *my_data);
+static void Robot_default_think_lasers(player_t *pl,
+                                       robot_default_data_t *my_data);
 static bool Check_robot_target(int ind, int item_x, int item_y, int new_mode);
+static bool Check_robot_destination(int ind, int nav_kind, int nav_dest,
+                                    int item_x, int item_y, int new_mode);
 static bool Detect_hunt(int ind, int j);
 static int Rank_item_value(int ind, Item_t itemtype);
 static bool Ball_handler(int ind);
@@ -169,6 +182,9 @@ static void Robot_default_create(int ind, char *str)
     my_data->robot_lock = LOCK_NONE;
     my_data->robot_lock_id = 0;
     my_data->longterm_mode = 0;
+    my_data->threats = NULL;
+    my_data->num_threats = 0;
+    my_data->max_threats = 0;
 
     if (str != NULL && *str != '\0' && sscanf(str, " %d %d", &my_data->attack, &my_data->defense) != 2)
     {
@@ -303,7 +319,9 @@ static void Robot_default_message(int ind, const char *message)
 static void Robot_default_destroy(int ind)
 {
     player_t *pl = PlayersArray[ind];
+    robot_default_data_t *my_data = Robot_default_get_data(pl);
 
+    XFREE(my_data->threats);
     free(pl->robot_data_ptr->private_data);
     pl->robot_data_ptr->private_data = NULL;
 }
@@ -843,6 +861,17 @@ static void Choose_weapon_modifier(player_t *pl, int weapon_type)
 static bool Check_robot_target(int ind,
                                int item_x, int item_y,
                                int new_mode)
+{
+    return Check_robot_destination(ind, -1, -1, item_x, item_y, new_mode);
+}
+
+/*
+ * Like Check_robot_target(), but when the way to the item is blocked
+ * and nav_dest is a destination of kind nav_kind, fly towards the next
+ * few blocks of the flow field of that destination instead.
+ */
+static bool Check_robot_destination(int ind, int nav_kind, int nav_dest,
+                                    int item_x, int item_y, int new_mode)
 {
     player_t *pl = PlayersArray[ind],
              *ship;
@@ -907,6 +936,20 @@ static bool Check_robot_target(int ind,
         }
     }
 
+    if (!clear_path && nav_dest >= 0)
+    {
+        ipos_t wp;
+
+        if (Navigation_waypoint(nav_kind, nav_dest,
+                                OBJ_X_IN_BLOCKS(pl), OBJ_Y_IN_BLOCKS(pl), &wp))
+        {
+            return Check_robot_destination(ind, -1, -1,
+                                           (int)((wp.x + 0.5) * BLOCK_SZ),
+                                           (int)((wp.y + 0.5) * BLOCK_SZ),
+                                           RM_NAVIGATE);
+        }
+    }
+
     if (new_mode == RM_CANNON_KILL)
         item_dist -= 4 * BLOCK_SZ;
 
@@ -1576,10 +1619,10 @@ static bool Ball_handler(int ind)
         else
         {
             SET_BIT(my_data->longterm_mode, FETCH_TREASURE);
-            return (Check_robot_target(ind,
-                                       ((int)(world->treasures[closest_t].blk_pos.x + 0.5) * BLOCK_SZ),
-                                       ((int)(world->treasures[closest_t].blk_pos.y + 0.5) * BLOCK_SZ),
-                                       RM_NAVIGATE));
+            return (Check_robot_destination(ind, NAV_TREASURE, closest_t,
+                                            ((int)(world->treasures[closest_t].blk_pos.x + 0.5) * BLOCK_SZ),
+                                            ((int)(world->treasures[closest_t].blk_pos.y + 0.5) * BLOCK_SZ),
+                                            RM_NAVIGATE));
         }
     }
     else
@@ -1610,10 +1653,10 @@ static bool Ball_handler(int ind)
         if (closest_ball == -1 && closest_nt_dist < (my_data->robot_count / 10) * BLOCK_SZ)
         {
             SET_BIT(my_data->longterm_mode, FETCH_TREASURE);
-            return (Check_robot_target(ind,
-                                       ((int)(world->treasures[closest_nt].blk_pos.x + 0.5) * BLOCK_SZ),
-                                       ((int)(world->treasures[closest_nt].blk_pos.y + 0.5) * BLOCK_SZ),
-                                       RM_NAVIGATE));
+            return (Check_robot_destination(ind, NAV_TREASURE, closest_nt,
+                                            ((int)(world->treasures[closest_nt].blk_pos.x + 0.5) * BLOCK_SZ),
+                                            ((int)(world->treasures[closest_nt].blk_pos.y + 0.5) * BLOCK_SZ),
+                                            RM_NAVIGATE));
         }
         else if (closest_ball_dist < (my_data->robot_count / 10) * BLOCK_SZ && closest_ball_dist > options.ballConnectorLength)
         {
@@ -1626,27 +1669,31 @@ static bool Ball_handler(int ind)
     return false;
 }
 
-static int Robot_default_play_check_map(int ind)
+/*
+ * Find the nearest fuel station, enemy target and enemy cannon.
+ */
+static void Robot_default_think_map(player_t *pl,
+                                    robot_default_data_t *my_data)
 {
-    player_t *pl = PlayersArray[ind];
-    int j;
-    int cannon_i, fuel_i, target_i;
+    int j, k, num, range;
+    int *list;
     int dx, dy;
     int distance, cannon_dist, fuel_dist, target_dist;
-    bool fuel_checked;
-    robot_default_data_t *my_data = Robot_default_get_data(pl);
-
-    fuel_checked = false;
 
-    cannon_i = -1;
+    my_data->cannon_i = -1;
     cannon_dist = Visibility_distance;
-    fuel_i = -1;
+    my_data->fuel_i = -1;
     fuel_dist = Visibility_distance;
-    target_i = -1;
+    my_data->target_i = -1;
     target_dist = Visibility_distance;
 
-    for (j = 0; j < world->NumFuels; j++)
+    /* the distance tests below truncate to whole pixels. */
+    range = (int)((Visibility_distance + 2) * CLICK);
+
+    num = Map_index_find(MAP_INDEX_FUEL, pl->pos.cx, pl->pos.cy, range, &list);
+    for (k = 0; k < num; k++)
     {
+        j = list[k];
 
         if (world->fuel[j].fuel < 100 * FUEL_SCALE_FACT)
             continue;
@@ -1663,14 +1710,16 @@ static int Robot_default_play_check_map(int ind)
             if (world->block[world->fuel[j].blk_pos.x]
                             [world->fuel[j].blk_pos.y] == FUEL)
             {
-                fuel_i = j;
+                my_data->fuel_i = j;
                 fuel_dist = distance;
             }
         }
     }
 
-    for (j = 0; j < world->NumTargets; j++)
+    num = Map_index_find(MAP_INDEX_TARGET, pl->pos.cx, pl->pos.cy, range, &list);
+    for (k = 0; k < num; k++)
     {
+        j = list[k];
 
         /* Ignore dead or owned targets */
         if (world->targets[j].dead_time > 0 || pl->team == world->targets[j].team || world->teams[world->targets[j].team].NumMembers == 0)
@@ -1682,11 +1731,54 @@ static int Robot_default_play_check_map(int ind)
              dy = WRAP_DY(dy), ABS(dy)) < target_dist &&
             (distance = (int)LENGTH(dx, dy)) < target_dist)
         {
-            target_i = j;
+            my_data->target_i = j;
             target_dist = distance;
         }
     }
 
+    num = Map_index_find(MAP_INDEX_CANNON, pl->pos.cx, pl->pos.cy, range, &list);
+    for (k = 0; k < num; k++)
+    {
+        j = list[k];
+
+        if (world->cannon[j].dead_time > 0)
+            continue;
+
+        if (BIT(world->rules->mode, TEAM_PLAY) && world->cannon[j].team == pl->team)
+            continue;
+
+        if ((dx = world->cannon[j].pix_pos.x - pl->pos.x,
+             dx = WRAP_DX(dx), ABS(dx)) < cannon_dist &&
+            (dy = world->cannon[j].pix_pos.y - pl->pos.y,
+             dy = WRAP_DY(dy), ABS(dy)) < cannon_dist &&
+            (distance = (int)LENGTH(dx, dy)) < cannon_dist)
+        {
+            my_data->cannon_i = j;
+            cannon_dist = distance;
+        }
+    }
+
+    my_data->fuel_dist = fuel_dist;
+    my_data->target_dist = target_dist;
+}
+
+static int Robot_default_play_check_map(int ind)
+{
+    player_t *pl = PlayersArray[ind];
+    int cannon_i, fuel_i, target_i;
+    int dx, dy;
+    int fuel_dist, target_dist;
+    bool fuel_checked;
+    robot_default_data_t *my_data = Robot_default_get_data(pl);
+
+    fuel_checked = false;
+
+    cannon_i = my_data->cannon_i;
+    fuel_i = my_data->fuel_i;
+    fuel_dist = my_data->fuel_dist;
+    target_i = my_data->target_i;
+    target_dist = my_data->target_dist;
+
     if (fuel_i >= 0 && (target_dist > fuel_dist || !BIT(world->rules->mode, TEAM_PLAY)) && BIT(my_data->longterm_mode, NEED_FUEL))
     {
 
@@ -1697,7 +1789,7 @@ static int Robot_default_play_check_map(int ind)
         SET_BIT(pl->used, HAS_REFUEL);
         pl->fs = fuel_i;
 
-        if (Check_robot_target(ind, dx, dy, RM_REFUEL))
+        if (Check_robot_destination(ind, NAV_FUEL, fuel_i, dx, dy, RM_REFUEL))
         {
             return 1;
         }
@@ -1715,26 +1807,6 @@ static int Robot_default_play_check_map(int ind)
         CLR_BIT(my_data->longterm_mode, TARGET_KILL);
     }
 
-    for (j = 0; j < world->NumCannons; j++)
-    {
-
-        if (world->cannon[j].dead_time > 0)
-            continue;
-
-        if (BIT(world->rules->mode, TEAM_PLAY) && world->cannon[j].team == pl->team)
-            continue;
-
-        if ((dx = world->cannon[j].pix_pos.x - pl->pos.x,
-             dx = WRAP_DX(dx), ABS(dx)) < cannon_dist &&
-            (dy = world->cannon[j].pix_pos.y - pl->pos.y,
-             dy = WRAP_DY(dy), ABS(dy)) < cannon_dist &&
-            (distance = (int)LENGTH(dx, dy)) < cannon_dist)
-        {
-            cannon_i = j;
-            cannon_dist = distance;
-        }
-    }
-
     if (cannon_i >= 0)
     {
 
@@ -1758,7 +1830,7 @@ static int Robot_default_play_check_map(int ind)
         SET_BIT(pl->used, HAS_REFUEL);
         pl->fs = fuel_i;
 
-        if (Check_robot_target(ind, dx, dy, RM_REFUEL))
+        if (Check_robot_destination(ind, NAV_FUEL, fuel_i, dx, dy, RM_REFUEL))
         {
             return 1;
         }
@@ -1767,19 +1839,44 @@ static int Robot_default_play_check_map(int ind)
     return 0;
 }
 
-static void Robot_default_play_check_objects(int ind,
-                                             int *item_i, int *item_dist,
-                                             int *item_imp,
-                                             int *mine_i, int *mine_dist)
+/*
+ * Whether a dangerous object is close enough to become the nearest
+ * mine or to make us put up shields, or is of a kind we react to
+ * at any distance.
+ */
+static bool Robot_default_threat(player_t *pl, object_t *shot)
+{
+    int dx, dy;
+    int range = MAX(ROBOT_MINE_DIST, 21 + SHIP_SZ + shot->pl_range);
+
+    if (BIT(shot->type, OBJ_SMART_SHOT | OBJ_MINE | OBJ_HEAT_SHOT | OBJ_ASTEROID))
+        return true;
+
+    dx = WRAP_DX(shot->pos.x - pl->pos.x);
+    dy = WRAP_DY(shot->pos.y - pl->pos.y);
+    if (ABS(dx) < range && ABS(dy) < range)
+        return true;
+
+    dx = WRAP_DX(shot->pos.x - pl->pos.x + shot->vel.x - pl->vel.x);
+    dy = WRAP_DY(shot->pos.y - pl->pos.y + shot->vel.y - pl->vel.y);
+    return (ABS(dx) < range && ABS(dy) < range);
+}
+
+/*
+ * Look through the objects nearby for the most wanted item and for
+ * the dangerous objects Robot_default_play_check_objects() has to
+ * deal with.
+ */
+static void Robot_default_think_objects(int ind,
+                                        robot_default_data_t *my_data)
 {
     player_t *pl = PlayersArray[ind];
-    int j;
-    object_t *shot, **obj_list;
-    int distance, obj_count;
+    int s, k, j, num_spans;
+    cell_span_t *spans;
+    object_t *shot;
     int dx, dy;
-    int shield_range;
     long killing_shots;
-    robot_default_data_t *my_data = Robot_default_get_data(pl);
+    robot_threat_t t;
 
     /*-BA Neural overload - if NumObjs too high, only consider
      *-BA max_objs many objects - improves performance under nukes
@@ -1796,6 +1893,13 @@ static void Robot_default_play_check_objects(int ind,
      */
     const int max_objs = 1000;
 
+    my_data->item_obj = NULL;
+    my_data->item_i = -1;
+    my_data->item_dist = (int)Visibility_distance;
+    my_data->item_imp = ROBOT_IGNORE_ITEM;
+    my_data->ball_seen = false;
+    my_data->num_threats = 0;
+
     killing_shots = KILLING_SHOTS;
     if (options.treasureCollisionMayKill)
         killing_shots |= OBJ_BALL;
@@ -1804,102 +1908,120 @@ static void Robot_default_play_check_objects(int ind,
     if (options.asteroidCollisionMayKill)
         killing_shots |= OBJ_ASTEROID;
 
-    Cell_get_objects(pl->pos.cx, pl->pos.cy,
-                     (int)(Visibility_distance / BLOCK_SZ), max_objs,
-                     &obj_list, &obj_count);
+    num_spans = Cell_get_spans(pl->pos.cx, pl->pos.cy,
+                               (int)(Visibility_distance / BLOCK_SZ), max_objs,
+                               &spans);
 
-    for (j = 0; j < obj_count; j++)
+    /* j counts the objects seen so far, item_i and mine_i refer to it. */
+    j = -1;
+    for (s = 0; s < num_spans; s++)
     {
+        for (k = 0; k < spans[s].num; k++)
+        {
+            shot = spans[s].objs[k];
+            j++;
 
-        shot = obj_list[j];
-
-        /* Get rid of the most common object types first for speed. */
-        if (BIT(shot->type, OBJ_DEBRIS | OBJ_SPARK))
-            continue;
+            /* Get rid of the most common object types first for speed. */
+            if (BIT(shot->type, OBJ_DEBRIS | OBJ_SPARK))
+                continue;
 
-        dx = WRAP_DX(shot->pos.x - pl->pos.x);
-        dy = WRAP_DY(shot->pos.y - pl->pos.y);
+            dx = WRAP_DX(shot->pos.x - pl->pos.x);
+            dy = WRAP_DY(shot->pos.y - pl->pos.y);
 
-        if (BIT(shot->type, OBJ_BALL) && !WITHIN(my_data->last_thrown_ball,
-                                                 my_data->robot_count,
-                                                 3 * FPS))
-            SET_BIT(pl->used, HAS_CONNECTOR);
+            if (BIT(shot->type, OBJ_BALL) && !WITHIN(my_data->last_thrown_ball,
+                                                     my_data->robot_count,
+                                                     3 * FPS))
+                my_data->ball_seen = true;
 
-        /* Ignore shots if shields already up - nothing else to do anyway */
-        if (BIT(shot->type, OBJ_SHOT | OBJ_CANNON_SHOT) && BIT(pl->used, HAS_SHIELD))
-            continue;
-
-        /*-BA This code shouldn't be executed for `friendly` shots
-         *-BA Moved down 2 paragraphs
-         *        if (BIT(shot->type, OBJ_SMART_SHOT|OBJ_HEAT_SHOT|OBJ_MINE)) {
-         *            fx = shot->pos.x - pl->pos.x;
-         *            fy = shot->pos.y - pl->pos.y;
-         *            if ((dx = fx, dx = WRAP_DX(dx), ABS(dx)) < mine_dist
-         *                && (dy = fy, dy = WRAP_DY(dy), ABS(dy)) < mine_dist
-         *                && (distance = LENGTH(dx, dy)) < mine_dist) {
-         *                mine_i = j;
-         *                mine_dist = distance;
-         *            }
-         *            if ((dx = fx + (shot->vel.x - pl->vel.x) * ROB_LOOK_AH,
-         *                    dx = WRAP_DX(dx), ABS(dx)) < mine_dist
-         *                && (dy = fy + (shot->vel.y - pl->vel.y) * ROB_LOOK_AH,
-         *                    dy = WRAP_DY(dy), ABS(dy)) < mine_dist
-         *                && (distance = LENGTH(dx, dy)) < mine_dist) {
-         *                mine_i = j;
-         *                mine_dist = distance;
-         *            }
-         *        }
-         */
-
-        /*
-         * The only thing left to do regarding objects is to check if
-         * this robot needs to put up shields to protect against objects.
-         */
-        if (!BIT(shot->type, killing_shots))
-        {
-
-            /* Find closest item */
-            if (BIT(shot->type, OBJ_ITEM))
+            if (!BIT(shot->type, killing_shots))
             {
-                if (ABS(dx) < *item_dist && ABS(dy) < *item_dist)
-                {
-                    int imp;
 
-                    if (BIT(shot->status, RANDOM_ITEM))
-                    {
-                        imp = ROBOT_HANDY_ITEM; /* It doesn't know what it is, so get it if it can */
-                    }
-                    else
-                    {
-                        imp = Rank_item_value(ind, (Item_t)obj_list[j]->info);
-                    }
-                    if (imp > ROBOT_IGNORE_ITEM && imp >= *item_imp)
+                /* Find closest item */
+                if (BIT(shot->type, OBJ_ITEM))
+                {
+                    if (ABS(dx) < my_data->item_dist && ABS(dy) < my_data->item_dist)
                     {
-                        *item_imp = imp;
-                        *item_dist = (int)LENGTH(dx, dy);
-                        *item_i = j;
+                        int imp;
+
+                        if (BIT(shot->status, RANDOM_ITEM))
+                        {
+                            imp = ROBOT_HANDY_ITEM; /* It doesn't know what it is, so get it if it can */
+                        }
+                        else
+                        {
+                            imp = Rank_item_value(ind, (Item_t)shot->info);
+                        }
+                        if (imp > ROBOT_IGNORE_ITEM && imp >= my_data->item_imp)
+                        {
+                            my_data->item_imp = imp;
+                            my_data->item_dist = (int)LENGTH(dx, dy);
+                            my_data->item_i = j;
+                            my_data->item_obj = shot;
+                        }
                     }
                 }
+
+                continue;
             }
 
-            continue;
-        }
+            /*
+             * Any shot of team members excluding self are passive.
+             */
+            if (Team_immune(shot->id, pl->id))
+            {
+                continue;
+            }
 
-        /*
-         * Any shot of team members excluding self are passive.
-         */
-        if (Team_immune(shot->id, pl->id))
-        {
-            continue;
+            /*
+             * Self shots may be passive too...
+             */
+            if (shot->id == pl->id && options.selfImmunity)
+            {
+                continue;
+            }
+
+            if (!Robot_default_threat(pl, shot))
+                continue;
+
+            t.obj = shot;
+            t.j = j;
+            STORE(robot_threat_t, my_data->threats, my_data->num_threats,
+                  my_data->max_threats, t);
         }
+    }
+}
 
-        /*
-         * Self shots may be passive too...
-         */
-        if (shot->id == pl->id && options.selfImmunity)
-        {
+static void Robot_default_play_check_objects(int ind,
+                                             int *item_i, int *item_dist,
+                                             int *item_imp,
+                                             int *mine_i, int *mine_dist)
+{
+    player_t *pl = PlayersArray[ind];
+    int k, j;
+    object_t *shot;
+    int distance;
+    int dx, dy;
+    int shield_range;
+    robot_default_data_t *my_data = Robot_default_get_data(pl);
+
+    *item_i = my_data->item_i;
+    *item_dist = my_data->item_dist;
+    *item_imp = my_data->item_imp;
+
+    if (my_data->ball_seen)
+        SET_BIT(pl->used, HAS_CONNECTOR);
+
+    for (k = 0; k < my_data->num_threats; k++)
+    {
+        shot = my_data->threats[k].obj;
+        j = my_data->threats[k].j;
+
+        /* Ignore shots if shields already up - nothing else to do anyway */
+        if (BIT(shot->type, OBJ_SHOT | OBJ_CANNON_SHOT) && BIT(pl->used, HAS_SHIELD))
             continue;
-        }
+
+        dx = WRAP_DX(shot->pos.x - pl->pos.x);
+        dy = WRAP_DY(shot->pos.y - pl->pos.y);
 
         /* Find nearest missile/mine */
         if (BIT(shot->type, OBJ_TORPEDO | OBJ_SMART_SHOT | OBJ_ASTEROID | OBJ_HEAT_SHOT | OBJ_BALL | OBJ_CANNON_SHOT) || (BIT(shot->type, OBJ_SHOT) && !BIT(world->rules->mode, TIMING) && shot->id != pl->id && shot->id != NO_ID) || (BIT(shot->type, OBJ_MINE) && shot->id != pl->id) || (BIT(shot->type, OBJ_WRECKAGE) && !BIT(world->rules->mode, TIMING)))
@@ -1942,6 +2064,9 @@ static void Robot_default_play_check_objects(int ind,
                     pl->item[ITEM_HYPERJUMP]--;
                     Add_fuel(&(pl->fuel), ED_HYPERJUMP);
                     do_hyperjump(pl);
+                    /* What we saw from where we were is no use now. */
+                    Robot_default_think_map(pl, my_data);
+                    Robot_default_think_lasers(pl, my_data);
                     break;
                 }
             }
@@ -1974,10 +2099,10 @@ static void Robot_default_play_check_objects(int ind,
         }
     }
 
-    /* Convert *item_i from index in local obj_list[] to index in Obj[] */
+    /* Convert *item_i from index in local object list to index in Obj[] */
     if (*item_i >= 0)
     {
-        for (j = 0; (j < NumObjs) && (Obj[j]->id != obj_list[*item_i]->id); j++)
+        for (j = 0; (j < NumObjs) && (Obj[j]->id != my_data->item_obj->id); j++)
             ;
         if (j >= NumObjs)
         {
@@ -1990,12 +2115,41 @@ static void Robot_default_play_check_objects(int ind,
     }
 }
 
-static void Robot_default_play_check_lasers(int ind)
+/*
+ * Count the laser pulses which are about to hit us.
+ */
+static void Robot_default_think_lasers(player_t *pl,
+                                       robot_default_data_t *my_data)
 {
-    player_t *pl = PlayersArray[ind];
     int j;
     int dx, dy;
     int distance2;
+
+    my_data->num_laser_threats = 0;
+    if (BIT(pl->have, HAS_SHIELD) == 0)
+        return;
+
+    for (j = 0; j < NumPulses; j++)
+    {
+        pulse_t *pulse = Pulses[j];
+        if (pulse->id == pl->id && !pulse->refl)
+            continue;
+        if (Team_immune(pulse->id, pl->id))
+            continue;
+        if (pl->id == pulse->id && options.selfImmunity)
+            continue;
+        dx = (long)WRAP_DX(pl->pos.x - pulse->pos.x);
+        dy = (long)WRAP_DY(pl->pos.y - pulse->pos.y);
+        distance2 = sqr(dx) + sqr(dy);
+        if (distance2 < sqr(PULSE_LENGTH) || (distance2 < sqr(2 * PULSE_LENGTH) && ABS(findDir(dx, dy) - pulse->dir) < RES / 8))
+            my_data->num_laser_threats++;
+    }
+}
+
+static void Robot_default_play_check_lasers(int ind)
+{
+    player_t *pl = PlayersArray[ind];
+    int j;
     /* int                                shield_range; */
     robot_default_data_t *my_data = Robot_default_get_data(pl);
 
@@ -2006,20 +2160,9 @@ static void Robot_default_play_check_lasers(int ind)
     if (BIT(pl->used, HAS_SHIELD) == 0 && BIT(pl->have, HAS_SHIELD) != 0)
     {
         /* shield_range = 21 + SHIP_SZ; */
-        for (j = 0; j < NumPulses; j++)
+        for (j = 0; j < my_data->num_laser_threats; j++)
         {
-            pulse_t *pulse = Pulses[j];
-            if (pulse->id == pl->id && !pulse->refl)
-                continue;
-            if (Team_immune(pulse->id, pl->id))
-                continue;
-            if (pl->id == pulse->id && options.selfImmunity)
-                continue;
-            dx = (long)WRAP_DX(pl->pos.x - pulse->pos.x);
-            dy = (long)WRAP_DY(pl->pos.y - pulse->pos.y);
-            distance2 = sqr(dx) + sqr(dy);
-            if ((distance2 < sqr(PULSE_LENGTH) || (distance2 < sqr(2 * PULSE_LENGTH) && ABS(findDir(dx, dy) - pulse->dir) < RES / 8)) && (int)(rfrac() * 100) <
-                                                                                                                                             (85 + (my_data->defense / 7) - (my_data->attack / 50)))
+            if ((int)(rfrac() * 100) < (85 + (my_data->defense / 7) - (my_data->attack / 50)))
             {
                 SET_BIT(pl->used, HAS_SHIELD);
                 if (!options.cloakedShield)
@@ -2030,6 +2173,20 @@ static void Robot_default_play_check_lasers(int ind)
     }
 }
 
+/*
+ * Do the looking around for Robot_default_play(), which may be done
+ * on another thread.  Only our own private data is written here.
+ */
+static void Robot_default_think(int ind)
+{
+    player_t *pl = PlayersArray[ind];
+    robot_default_data_t *my_data = Robot_default_get_data(pl);
+
+    Robot_default_think_objects(ind, my_data);
+    Robot_default_think_lasers(pl, my_data);
+    Robot_default_think_map(pl, my_data);
+}
+
 static void Robot_default_play(int ind)
 {
     player_t *pl = PlayersArray[ind],
@@ -2039,8 +2196,9 @@ static void Robot_default_play(int ind)
         speed, x_speed, y_speed;
     int item_dist, mine_dist;
     int item_i, mine_i;
-    int j, ship_i, item_imp,
+    int j, k, num, ship_i, item_imp,
         enemy_i;
+    int *list;
     int dx, dy, x, y;
     bool harvest_checked;
     bool evade_checked;
@@ -2061,7 +2219,7 @@ static void Robot_default_play(int ind)
     navigate_checked = false;
 
     mine_i = -1;
-    mine_dist = SHIP_SZ + 200;
+    mine_dist = ROBOT_MINE_DIST;
     item_i = -1;
     item_dist = (int)Visibility_distance;
     item_imp = ROBOT_IGNORE_ITEM;
@@ -2099,9 +2257,15 @@ static void Robot_default_play(int ind)
     }
 
     if (pl->fuel.sum < pl->fuel.max * 0.80)
-        for (j = 0; j < world->NumFuels; j++)
+    {
+        /* the distance tests below truncate to whole pixels. */
+        num = Map_index_find(MAP_INDEX_FUEL, pl->pos.cx, pl->pos.cy,
+                             (90 + 2) * CLICK, &list);
+        CLR_BIT(pl->used, HAS_REFUEL);
+        for (k = 0; k < num; k++)
         {
             int dx, dy;
+            j = list[k];
             if (BIT(world->rules->mode, TEAM_PLAY) && options.teamFuel && world->fuel[j].team != pl->team)
             {
                 continue;
@@ -2116,11 +2280,8 @@ static void Robot_default_play(int ind)
                 SET_BIT(pl->used, HAS_REFUEL);
                 break;
             }
-            else
-            {
-                CLR_BIT(pl->used, HAS_REFUEL);
-            }
         }
+    }
 
     /* don't turn NEED_FUEL off until refueling stops */
     if (pl->fuel.sum < (BIT(world->rules->mode, TIMING) ? pl->fuel.l1 : pl->fuel.l3))
@@ -2134,8 +2295,11 @@ static void Robot_default_play(int ind)
 
     if (BIT(world->rules->mode, TEAM_PLAY))
     {
-        for (j = 0; j < world->NumTargets; j++)
+        num = Map_index_find(MAP_INDEX_TARGET, pl->pos.cx, pl->pos.cy,
+                             (90 + 2) * CLICK, &list);
+        for (k = 0; k < num; k++)
         {
+            j = list[k];
             if (world->targets[j].team == pl->team && world->targets[j].damage < TARGET_DAMAGE && world->targets[j].dead_time >= 0)
             {
                 int dx = (world->targets[j].blk_pos.x * BLOCK_SZ + BLOCK_SZ / 2) - pl->pos.x;
@@ -33,6 +33,11 @@
 #include <unistd.h>
 #include <sys/time.h>
 
+#ifdef HAVE_EPOLL_SCHED
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
 #define SERVER
 #include "version.h"
 #include "xpconfig.h"
@@ -55,6 +60,28 @@ static int ticks_till_second;
 
 typedef int FDTYPE;
 
+#ifdef HAVE_EPOLL_SCHED
+/*
+ * With epoll the frame timer is a timerfd which is polled together
+ * with the sockets, so no signals interrupt the main loop.
+ */
+static int epoll_fd = -1;
+static int timer_fd = -1;
+
+static void sched_init_epoll(void)
+{
+    if (epoll_fd != -1)
+    {
+        return;
+    }
+    if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    {
+        error("epoll_create1");
+        exit(1);
+    }
+}
+#endif
+
 /*
  * Block or unblock a single signal.
  */
@@ -89,6 +116,22 @@ void allow_timer(void)
     sig_ok(SIGALRM, 1);
 }
 
+/*
+ * Use timerResolution to increment timer_ticks.
+ */
+static void count_timer_tick(void)
+{
+    static unsigned int timer_count = 0;
+
+    timer_count += FPS;
+    if (timer_count >= (unsigned)options.timerResolution)
+    {
+        timer_count -= options.timerResolution;
+        timer_ticks++;
+    }
+}
+
+#ifndef HAVE_EPOLL_SCHED
 /*
  * Catch SIGALRM.
  * Simple timer ticker.
@@ -104,21 +147,93 @@ static void catch_timer_ticks(int signum)
  */
 static void catch_timer_counts(int signum)
 {
-    static unsigned int timer_count = 0;
-    // static unsigned int my_count = 0;
-
-    // if ((my_count % 1000) == 0)
-    //     printf("catch_timer_counts: my_count = %d\n", my_count);
-    // my_count++;
+    count_timer_tick();
+}
+#else
+/*
+ * The timerfd became readable.
+ * Account for all expirations since the last read.
+ */
+static void read_timer_fd(void)
+{
+    uint64_t expirations;
 
-    timer_count += FPS;
-    if (timer_count >= (unsigned)options.timerResolution)
+    if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
     {
-        timer_count -= options.timerResolution;
-        timer_ticks++;
+        if (errno != EAGAIN && errno != EINTR)
+        {
+            error("timerfd read");
+        }
+        return;
+    }
+    while (expirations-- > 0)
+    {
+        if (options.timerResolution > 0)
+        {
+            count_timer_tick();
+        }
+        else
+        {
+            timer_ticks++;
+        }
     }
 }
+#endif
 
+#ifdef HAVE_EPOLL_SCHED
+/*
+ * Setup the frame timer as a periodic timerfd on the monotonic clock
+ * and add it to the epoll set.
+ */
+static void setup_timer(void)
+{
+    struct itimerspec its;
+
+    if (timer_freq <= 0)
+    {
+        error("illegal timer frequency: %ld", timer_freq);
+        exit(1);
+    }
+
+    sched_init_epoll();
+    if (timer_fd == -1)
+    {
+        struct epoll_event ev;
+
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd == -1)
+        {
+            error("timerfd_create");
+            exit(1);
+        }
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = timer_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) == -1)
+        {
+            error("epoll_ctl add timerfd");
+            exit(1);
+        }
+    }
+
+    its.it_interval.tv_sec = 0;
+    its.it_interval.tv_nsec = 1000000000L / timer_freq;
+    if (its.it_interval.tv_nsec == 0)
+    {
+        its.it_interval.tv_nsec = 1;
+    }
+    its.it_value = its.it_interval;
+    if (timerfd_settime(timer_fd, 0, &its, NULL) == -1)
+    {
+        error("timerfd_settime");
+        exit(1);
+    }
+
+    timers_used = timer_ticks;
+    time(&current_time);
+    ticks_till_second = timer_freq;
+}
+#else
 /*
  * Setup the handling of the SIGALRM signal
  * and setup the real-time interval timer.
@@ -179,6 +294,7 @@ static void setup_timer(void)
      */
     allow_timer();
 }
+#endif
 
 /*
  * Configure timer tick callback.
@@ -330,8 +446,6 @@ static void timeout_chime(void)
     }
 }
 
-#define NUM_SELECT_FD ((int)sizeof(int) * 8)
-
 struct io_handler
 {
     int fd;
@@ -339,47 +453,93 @@ struct io_handler
     void *arg;
 };
 
-static struct io_handler input_handlers[NUM_SELECT_FD];
+/*
+ * Input handlers are indexed by file descriptor.
+ * The table grows as higher descriptors get installed.
+ */
+static struct io_handler *input_handlers;
+static int num_input_handlers;
+static int max_fd = -1;
+#ifndef HAVE_EPOLL_SCHED
 static fd_set input_mask;
-static int max_fd, min_fd;
 static int input_inited = false;
+#endif
 
 static void io_dummy(int fd, void *arg)
 {
     xpprintf("io_dummy called!  (%d, %p)\n", fd, arg);
 }
 
-void install_input(void (*func)(int, void *), int fd, void *arg)
+static void grow_input_handlers(int fd)
 {
-    int i;
+    int i, num = MAX(16, num_input_handlers);
+    struct io_handler *ioh;
+
+    while (num <= fd)
+    {
+        num *= 2;
+    }
+    ioh = (struct io_handler *)realloc(input_handlers, num * sizeof(*ioh));
+    if (!ioh)
+    {
+        error("Not enough memory for input handlers");
+        exit(1);
+    }
+    for (i = num_input_handlers; i < num; i++)
+    {
+        ioh[i].fd = -1;
+        ioh[i].func = io_dummy;
+        ioh[i].arg = 0;
+    }
+    input_handlers = ioh;
+    num_input_handlers = num;
+}
 
+void install_input(void (*func)(int, void *), int fd, void *arg)
+{
+#ifndef HAVE_EPOLL_SCHED
     if (input_inited == false)
     {
         input_inited = true;
         FD_ZERO(&input_mask);
-        min_fd = fd;
-        max_fd = fd;
-        for (i = 0; i < NELEM(input_handlers); i++)
-        {
-            input_handlers[i].fd = -1;
-            input_handlers[i].func = io_dummy;
-            input_handlers[i].arg = 0;
-        }
     }
-    if (fd < min_fd || fd >= min_fd + NUM_SELECT_FD)
+    if (fd < 0 || fd >= FD_SETSIZE)
+#else
+    if (fd < 0)
+#endif
     {
-        error("install illegal input handler fd %d (%d)", fd, min_fd);
+        error("install illegal input handler fd %d", fd);
         exit(1);
     }
-    if (FD_ISSET(fd, &input_mask))
+    if (fd >= num_input_handlers)
+    {
+        grow_input_handlers(fd);
+    }
+    if (input_handlers[fd].fd != -1)
     {
         error("input handler %d busy", fd);
         exit(1);
     }
-    input_handlers[fd - min_fd].fd = fd;
-    input_handlers[fd - min_fd].func = func;
-    input_handlers[fd - min_fd].arg = arg;
+#ifdef HAVE_EPOLL_SCHED
+    {
+        struct epoll_event ev;
+
+        sched_init_epoll();
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1)
+        {
+            error("epoll_ctl add %d", fd);
+            exit(1);
+        }
+    }
+#else
     FD_SET(fd, &input_mask);
+#endif
+    input_handlers[fd].fd = fd;
+    input_handlers[fd].func = func;
+    input_handlers[fd].arg = arg;
     if (fd > max_fd)
     {
         max_fd = fd;
@@ -388,24 +548,31 @@ void install_input(void (*func)(int, void *), int fd, void *arg)
 
 void remove_input(int fd)
 {
-    if (fd < min_fd || fd >= min_fd + NUM_SELECT_FD)
+    if (fd < 0 || fd >= num_input_handlers)
     {
-        error("remove illegal input handler fd %d (%d)", fd, min_fd);
+        error("remove illegal input handler fd %d", fd);
         exit(1);
     }
-    if (FD_ISSET(fd, &input_mask))
+    if (input_handlers[fd].fd == fd)
     {
-        input_handlers[fd - min_fd].fd = -1;
-        input_handlers[fd - min_fd].func = io_dummy;
-        input_handlers[fd - min_fd].arg = 0;
+        input_handlers[fd].fd = -1;
+        input_handlers[fd].func = io_dummy;
+        input_handlers[fd].arg = 0;
+#ifdef HAVE_EPOLL_SCHED
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL) == -1)
+        {
+            error("epoll_ctl del %d", fd);
+        }
+#else
         FD_CLR((FDTYPE)fd, &input_mask);
+#endif
         if (fd == max_fd)
         {
             int i = fd;
             max_fd = -1;
-            while (--i >= min_fd)
+            while (--i >= 0)
             {
-                if (FD_ISSET(i, &input_mask))
+                if (input_handlers[i].fd != -1)
                 {
                     max_fd = i;
                     break;
@@ -429,6 +596,104 @@ static void sched_select_error(void)
     End_game();
 }
 
+/*
+ * Call the timer handler and catch up on the timer ticks
+ * and timeouts that have passed since the last call.
+ */
+static void sched_timer_tick(void)
+{
+    if (timer_handler)
+    {
+        (*timer_handler)();
+    }
+
+    do
+    {
+        ++timers_used;
+        if (--ticks_till_second <= 0)
+        {
+            ticks_till_second += timer_freq;
+            current_time++;
+            timeout_chime();
+        }
+    } while (timers_used + 1 < timer_ticks);
+}
+
+#ifdef HAVE_EPOLL_SCHED
+
+#define SCHED_MAX_EVENTS 64
+
+/*
+ * I/O + timer dispatcher.
+ * The cost of a wakeup depends only on the number of ready sockets.
+ */
+void sched(void)
+{
+    int i, n, io_todo = 3;
+    struct epoll_event events[SCHED_MAX_EVENTS];
+
+    if (sched_running)
+    {
+        error("sched already running");
+        exit(1);
+    }
+
+    sched_running = 1;
+    sched_init_epoll();
+
+    while (sched_running)
+    {
+        if (io_todo == 0 && timers_used < timer_ticks)
+        {
+            io_todo = 1 + (timer_ticks - timers_used);
+            sched_timer_tick();
+        }
+        else
+        {
+            int num_io = 0;
+
+            n = epoll_wait(epoll_fd, events, SCHED_MAX_EVENTS,
+                           (io_todo > 0) ? 0 : -1);
+            if (n == -1 && errno != EINTR)
+            {
+                sched_select_error();
+            }
+            for (i = 0; i < n; i++)
+            {
+                int fd = events[i].data.fd;
+                struct io_handler *ioh;
+
+                if (fd == timer_fd)
+                {
+                    read_timer_fd();
+                    continue;
+                }
+                /*
+                 * An earlier handler in this batch may have
+                 * removed this one, e.g. by destroying a connection.
+                 */
+                if (fd >= num_input_handlers || input_handlers[fd].fd != fd)
+                {
+                    continue;
+                }
+                ioh = &input_handlers[fd];
+                (*(ioh->func))(ioh->fd, ioh->arg);
+                num_io++;
+            }
+            if (num_io == 0)
+            {
+                io_todo = 0;
+            }
+            else if (io_todo > 0)
+            {
+                io_todo--;
+            }
+        }
+    }
+}
+
+#else
+
 /*
  * I/O + timer dispatcher.
  * Windows pumps this one time
@@ -457,21 +722,7 @@ void sched(void)
             io_todo = 1 + (timer_ticks - timers_used);
             tvp = &tv;
 
-            if (timer_handler)
-            {
-                (*timer_handler)();
-            }
-
-            do
-            {
-                ++timers_used;
-                if (--ticks_till_second <= 0)
-                {
-                    ticks_till_second += timer_freq;
-                    current_time++;
-                    timeout_chime();
-                }
-            } while (timers_used + 1 < timer_ticks);
+            sched_timer_tick();
         }
         else
         {
@@ -488,12 +739,12 @@ void sched(void)
             }
             else
             {
-                for (i = max_fd; i >= min_fd; i--)
+                for (i = max_fd; i >= 0; i--)
                 {
                     if (FD_ISSET(i, &readmask))
                     {
                         struct io_handler *ioh;
-                        ioh = &input_handlers[i - min_fd];
+                        ioh = &input_handlers[i];
                         (*(ioh->func))(ioh->fd, ioh->arg);
                         if (--n == 0)
                         {
@@ -513,3 +764,5 @@ void sched(void)
         }
     }
 }
+
+#endif
@@ -66,6 +66,8 @@
 #include "server.h"
 #include "xpmath.h"
 #include "walls.h"
+#include "threadpool.h"
+#include "profile.h"
 
 char server_version[] = VERSION;
 
@@ -100,6 +102,8 @@ extern int login_in_progress;
 extern int NumQueuedPlayers;
 
 extern void Main_loop(void);
+
+#ifndef SERVER_BENCH
 static void Handle_signal(int sig_no);
 
 int main(int argc, char **argv)
@@ -133,21 +137,7 @@ int main(int argc, char **argv)
     }
 
     plock_server(options.pLockServer); /* Lock the server into memory */
-    Make_table();                      /* Make trigonometric tables */
-    Compute_gravity();
-    Find_base_direction();
-    Walls_init();
-
-    /* Allocate memory for players, shots and messages */
-    Alloc_players(world->NumBases + MAX_PSEUDO_PLAYERS);
-    Alloc_shots(MAX_TOTAL_SHOTS);
-    Alloc_cells();
-
-    Move_init();
-
-    Robot_init();
-
-    Treasure_init();
+    Game_init();
 
     /*
      * Get server's official name.
@@ -219,12 +209,38 @@ int main(int argc, char **argv)
 
     return 1;
 }
+#endif
+
+/*
+ * Build the world from the parsed options and allocate
+ * the memory the game needs.
+ */
+void Game_init(void)
+{
+    Make_table(); /* Make trigonometric tables */
+    Compute_gravity();
+    Find_base_direction();
+    Walls_init();
+
+    /* Allocate memory for players, shots and messages */
+    Alloc_players(world->NumBases + MAX_PSEUDO_PLAYERS);
+    Alloc_shots(MAX_TOTAL_SHOTS);
+    Alloc_cells();
+
+    Move_init();
+
+    Robot_init();
+
+    Treasure_init();
+}
 
 void Main_loop(void)
 {
     struct timeval tv1, tv2;
+    uint64_t tick_start, prof;
 
     gettimeofday(&tv1, NULL);
+    tick_start = Profile_start();
 
     main_loops++;
 
@@ -249,7 +265,9 @@ void Main_loop(void)
             ShutdownServer--;
     }
 
+    prof = Profile_start();
     Input();
+    Profile_stop(PROFILE_INPUT, prof);
 
     if (NumPlayers > NumRobots + NumPseudoPlayers || options.RawMode)
     {
@@ -268,7 +286,9 @@ void Main_loop(void)
 
         Update_objects();
 
+        prof = Profile_start();
         Frame_update();
+        Profile_stop(PROFILE_FRAMES, prof);
     }
 
     if (!options.NoQuit && NumPlayers == NumRobots + NumPseudoPlayers && !login_in_progress && !NumQueuedPlayers)
@@ -284,7 +304,9 @@ void Main_loop(void)
         }
     }
 
+    prof = Profile_start();
     Queue_loop();
+    Profile_stop(PROFILE_QUEUE, prof);
 
     {
         int s, us;
@@ -298,6 +320,9 @@ void Main_loop(void)
 
         mainLoopTime = us;
     }
+
+    Profile_stop(PROFILE_TICK, tick_start);
+    Profile_tick();
 }
 
 /*
@@ -337,6 +362,9 @@ void End_game(void)
 
     Contact_cleanup();
 
+    Threadpool_cleanup();
+    Profile_cleanup();
+
     Free_players();
     Free_shots();
     Free_map();
@@ -620,6 +648,7 @@ void Server_info(char *str, unsigned max_size)
     free(order);
 }
 
+#ifndef SERVER_BENCH
 static void Handle_signal(int sig_no)
 {
     errno = 0;
@@ -652,6 +681,7 @@ static void Handle_signal(int sig_no)
     }
     _exit(sig_no); /* just in case */
 }
+#endif
 
 void Log_game(const char *heading)
 {
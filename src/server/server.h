@@ -41,9 +41,11 @@ enum TeamPickType
  */
 void Free_cells(void);
 void Alloc_cells(void);
+void Cell_update(void);
 void Cell_init_object(object_t *obj);
 void Cell_add_object(object_t *obj);
 void Cell_remove_object(object_t *obj);
+int Cell_get_spans(int cx, int cy, int r, int max, cell_span_t **spans);
 void Cell_get_objects(int cx, int cy, int r, int max, object_t ***list, int *count);
 
 /*
@@ -116,6 +118,7 @@ void Add_fuel(pl_fuel_t *, long);
 void Update_tanks(pl_fuel_t *);
 void Place_item(int type, player_t *pl);
 int Choose_random_item(void);
+int Choose_item_by_fraction(double frac);
 void Tractor_beam(int ind);
 void General_tractor_beam(int ind, int cx, int cy,
                           int items, int target, bool pressor);
@@ -206,11 +209,21 @@ void Handle_player_command(player_t *pl, char *cmd);
 /*
  * Prototypes for robot.c
  */
+typedef struct
+{
+    long full;     /* robot turns played every loop */
+    long reduced;  /* robot turns played at a lower rate */
+    long skipped;  /* robot turns left out for the level of detail */
+    long deferred; /* robot turns put off to stay within the budget */
+} robot_lod_stats_t;
+
 void Parse_robot_file(void);
 void Robot_init(void);
+void Robot_create(void);
 void Robot_delete(int ind, int kicked);
 void Robot_destroy(int ind);
 void Robot_update(void);
+bool Robot_may_join(void);
 void Robot_invite(int ind, int inv_ind);
 void Robot_war(int ind, int killer);
 void Robot_reset_war(int ind);
@@ -218,6 +231,7 @@ int Robot_war_on_player(int ind);
 void Robot_go_home(int ind);
 void Robot_program(int ind, int victim_id);
 void Robot_message(int ind, const char *message);
+void Robot_get_lod_stats(robot_lod_stats_t *stats);
 
 /*
  * Prototypes for rules.c
@@ -242,6 +256,7 @@ void Game_Over(void);
 void Server_log_admin_message(int ind, const char *str);
 int plock_server(bool on);
 void Main_loop(void);
+void Game_init(void);
 
 /*
  * Prototypes for contact.c
@@ -266,7 +281,16 @@ void Meta_update(int change);
 /*
  * Prototypes for frame.c
  */
+typedef struct
+{
+    long frames;       /* frames sent */
+    long thinned;      /* frames sent with something left out */
+    long skipped_fps;  /* frames dropped for the player's frame rate */
+    long skipped_thin; /* frames dropped for congestion */
+} frame_shaping_stats_t;
+
 void Frame_update(void);
+void Frame_get_shaping_stats(frame_shaping_stats_t *stats);
 void Set_message(const char *message);
 void Set_player_message(player_t *pl, const char *message);
 
@@ -337,6 +361,13 @@ void Object_free_ind(int ind);
 void Object_free_ptr(object_t *obj);
 void Alloc_shots(int number);
 void Free_shots(void);
+ecm_t *Ecm_allocate(void);
+void Ecm_free(ecm_t *ecm);
+trans_t *Transporter_allocate(void);
+void Transporter_free(trans_t *trans);
+pulse_t *Pulse_allocate(void);
+void Pulse_free(pulse_t *pulse);
+void Pool_get_stats(int pool, pool_stats_t *stats);
 
 /*
  * Prototypes for showtime.c
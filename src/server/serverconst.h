@@ -159,15 +159,8 @@
 #define MAX_TOTAL_ECMS 64
 #define MAX_TOTAL_TRANSPORTERS (2 * 64)
 
-#define LG2_MAX_AFTERBURNER 4
-#define ALT_SPARK_MASS_FACT 4.2
 #define ALT_FUEL_FACT 3
-#define MAX_AFTERBURNER ((1 << LG2_MAX_AFTERBURNER) - 1)
 #define AFTER_BURN_SPARKS(s, n) (((s) * (n)) >> LG2_MAX_AFTERBURNER)
-#define AFTER_BURN_POWER_FACTOR(n) \
-        (1.0 + (n) * ((ALT_SPARK_MASS_FACT - 1.0) / (MAX_AFTERBURNER + 1.0)))
-#define AFTER_BURN_POWER(p, n) \
-        ((p) * AFTER_BURN_POWER_FACTOR(n))
 #define AFTER_BURN_FUEL(f, n) \
         (((f) * ((MAX_AFTERBURNER + 1) + (n) * (ALT_FUEL_FACT - 1))) / (MAX_AFTERBURNER + 1.0))
 
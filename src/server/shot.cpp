@@ -1444,7 +1444,7 @@ void Fire_general_laser(player_t *pl, unsigned short team, int cx, int cy,
 
     if (NumPulses >= MAX_TOTAL_PULSES)
         return;
-    Pulses[NumPulses] = (pulse_t *)malloc(sizeof(pulse_t));
+    Pulses[NumPulses] = Pulse_allocate();
     if (Pulses[NumPulses] == NULL)
         return;
 
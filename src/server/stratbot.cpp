@@ -96,7 +96,8 @@ static robot_type_t stratbot_type = {
     Stratbot_war_on_player,
     Stratbot_message,
     Stratbot_destroy,
-    Stratbot_invite};
+    Stratbot_invite,
+    NULL};
 
 /*
  * The only thing we export from this file.
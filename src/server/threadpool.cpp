@@ -0,0 +1,186 @@
+/*
+ * XPilot, a multiplayer gravity war game.  Copyright (C) 1991-2001 by
+ *
+ *      Bjørn Stabell
+ *      Ken Ronny Schouten
+ *      Bert Gijsbers
+ *      Dick Balaska
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <system_error>
+
+#define SERVER
+#include "xperror.h"
+#include "threadpool.h"
+
+/*
+ * The pool state lives on the heap and is never destroyed so that
+ * calling exit() while the workers are idle does not terminate
+ * the process through a destructor of a joinable std::thread.
+ */
+typedef struct
+{
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    unsigned long generation; /* bumped for each batch of jobs */
+    bool shutting_down;
+    int active_workers; /* workers taking part in this batch */
+    int busy_workers;   /* workers still running this batch */
+    std::atomic<int> next_job;
+    int num_jobs;
+    void (*func)(int, void *);
+    void *arg;
+} threadpool_t;
+
+static threadpool_t *pool;
+
+static void Threadpool_run_jobs(void)
+{
+    int job;
+
+    while ((job = pool->next_job.fetch_add(1)) < pool->num_jobs)
+    {
+        (*pool->func)(job, pool->arg);
+    }
+}
+
+/*
+ * seen is the batch before the worker was created.  Reading it in the
+ * new thread would miss the batch it was created for if that batch
+ * had already started.
+ */
+static void Threadpool_worker(int index, unsigned long seen)
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(pool->mutex);
+            pool->work_cv.wait(lock, [&]
+                               { return pool->shutting_down || pool->generation != seen; });
+            if (pool->shutting_down)
+            {
+                return;
+            }
+            seen = pool->generation;
+            if (index >= pool->active_workers)
+            {
+                continue;
+            }
+        }
+
+        Threadpool_run_jobs();
+
+        {
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            if (--pool->busy_workers == 0)
+            {
+                pool->done_cv.notify_one();
+            }
+        }
+    }
+}
+
+void Threadpool_run(int num_threads, int num_jobs,
+                    void (*func)(int job, void *arg), void *arg)
+{
+    int i, helpers;
+
+    helpers = ((num_threads < num_jobs) ? num_threads : num_jobs) - 1;
+    if (helpers <= 0)
+    {
+        for (i = 0; i < num_jobs; i++)
+        {
+            (*func)(i, arg);
+        }
+        return;
+    }
+
+    if (pool == NULL)
+    {
+        pool = new threadpool_t();
+    }
+    while ((int)pool->workers.size() < helpers)
+    {
+        try
+        {
+            pool->workers.emplace_back(Threadpool_worker,
+                                       (int)pool->workers.size(),
+                                       pool->generation);
+        }
+        catch (const std::system_error &)
+        {
+            error("Can't create worker thread");
+            break;
+        }
+    }
+    if (helpers > (int)pool->workers.size())
+    {
+        helpers = (int)pool->workers.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->func = func;
+        pool->arg = arg;
+        pool->num_jobs = num_jobs;
+        pool->next_job = 0;
+        pool->active_workers = helpers;
+        pool->busy_workers = helpers;
+        pool->generation++;
+    }
+    pool->work_cv.notify_all();
+
+    Threadpool_run_jobs();
+
+    {
+        std::unique_lock<std::mutex> lock(pool->mutex);
+        pool->done_cv.wait(lock, []
+                           { return pool->busy_workers == 0; });
+    }
+}
+
+int Threadpool_size(void)
+{
+    return (pool == NULL) ? 0 : (int)pool->workers.size();
+}
+
+void Threadpool_cleanup(void)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->shutting_down = true;
+    }
+    pool->work_cv.notify_all();
+    for (auto &worker : pool->workers)
+    {
+        worker.join();
+    }
+    delete pool;
+    pool = NULL;
+}
@@ -0,0 +1,40 @@
+/*
+ * XPilot, a multiplayer gravity war game.  Copyright (C) 1991-2001 by
+ *
+ *      Bjørn Stabell
+ *      Ken Ronny Schouten
+ *      Bert Gijsbers
+ *      Dick Balaska
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+/*
+ * A small pool of worker threads for splitting per-frame work.
+ * Threadpool_run() calls func(job, arg) once for each job in
+ * [0, num_jobs) using at most num_threads threads, the calling
+ * thread included, and returns when all jobs are done.
+ * Jobs must not call any code that can change the game state.
+ */
+void Threadpool_run(int num_threads, int num_jobs,
+                    void (*func)(int job, void *arg), void *arg);
+int Threadpool_size(void);
+void Threadpool_cleanup(void);
+
+#endif
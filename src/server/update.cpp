@@ -41,6 +41,8 @@
 #include "netserver.h"
 #include "xpmath.h"
 #include "walls.h"
+#include "profile.h"
+#include "navigate.h"
 
 #define update_object_speed(o_)                                                                  \
     if (BIT((o_)->status, GRAVITY))                                                              \
@@ -54,6 +56,12 @@
         (o_)->vel.y += (o_)->acc.y;                                                              \
     }
 
+/*
+ * Objects which need more than update_object_speed() and Move_object().
+ */
+#define SPECIAL_MOVE_OBJECTS \
+    (OBJ_MINE | OBJ_SMART_SHOT | OBJ_HEAT_SHOT | OBJ_TORPEDO | OBJ_BALL | OBJ_WRECKAGE | OBJ_ASTEROID)
+
 int roundtime = -1; /* time left this round */
 
 static char msg[MSG_LEN];
@@ -545,11 +553,14 @@ static void do_Autopilot(player_t *pl)
 void Update_objects(void)
 {
     object_t *obj;
+    uint64_t prof;
 
     /*
      * Update robots.
      */
+    prof = Profile_start();
     Robot_update();
+    Profile_stop(PROFILE_ROBOTS, prof);
 
     /*
      * Autorepeat fire, must unfortunately be done here, not in
@@ -593,7 +604,7 @@ void Update_objects(void)
                  */
                 continue;
 
-            world->fuel[i].conn_mask = 0;
+            Conn_mask_clear_all(&world->fuel[i].conn_mask);
             world->fuel[i].last_change = frame_loops;
         }
     }
@@ -601,10 +612,26 @@ void Update_objects(void)
     /*
      * Update shots.
      */
+    prof = Profile_start();
     for (int i = 0; i < NumObjs; i++)
     {
         obj = Obj[i];
 
+        if (!BIT(obj->type, SPECIAL_MOVE_OBJECTS))
+        {
+            /*
+             * Shots, debris, sparks and the like only need gravity
+             * and integration, move each run of them in one go.
+             */
+            int n = 1;
+
+            while (i + n < NumObjs && !BIT(Obj[i + n]->type, SPECIAL_MOVE_OBJECTS))
+                n++;
+            Move_simple_objects(i, n);
+            i += n - 1;
+            continue;
+        }
+
         if (BIT(obj->type, OBJ_MINE))
             Move_mine(i);
 
@@ -632,10 +659,14 @@ void Update_objects(void)
         }
     }
 
+    Profile_stop(PROFILE_SHOTS, prof);
+
     /*
      * Asteroids.
      */
+    prof = Profile_start();
     Asteroid_update();
+    Profile_stop(PROFILE_ASTEROIDS, prof);
 
     /*
      * Update ECM blasts
@@ -646,7 +677,7 @@ void Update_objects(void)
         {
             if (Ecms[i]->id != NO_ID)
                 PlayersArray[GetInd[Ecms[i]->id]]->ecmcount--;
-            free(Ecms[i]);
+            Ecm_free(Ecms[i]);
             --NumEcms;
             Ecms[i] = Ecms[NumEcms];
             i--;
@@ -660,7 +691,7 @@ void Update_objects(void)
     {
         if (--Transporters[i]->count <= 0)
         {
-            free(Transporters[i]);
+            Transporter_free(Transporters[i]);
             --NumTransporters;
             Transporters[i] = Transporters[NumTransporters];
             i--;
@@ -678,7 +709,8 @@ void Update_objects(void)
             if (!--cannon->dead_time)
             {
                 world->block[cannon->blk_pos.x][cannon->blk_pos.y] = CANNON;
-                cannon->conn_mask = 0;
+                Navigation_changed();
+                Conn_mask_clear_all(&cannon->conn_mask);
                 cannon->last_change = frame_loops;
             }
             continue;
@@ -756,8 +788,9 @@ void Update_objects(void)
             if (!--world->targets[i].dead_time)
             {
                 world->block[world->targets[i].blk_pos.x][world->targets[i].blk_pos.y] = TARGET;
-                world->targets[i].conn_mask = 0;
-                world->targets[i].update_mask = (unsigned)-1;
+                Navigation_changed();
+                Conn_mask_clear_all(&world->targets[i].conn_mask);
+                Conn_mask_set_all(&world->targets[i].update_mask);
                 world->targets[i].last_change = frame_loops;
 
                 if (options.targetSync)
@@ -770,8 +803,8 @@ void Update_objects(void)
                         {
                             world->block[world->targets[j].blk_pos.x]
                                         [world->targets[j].blk_pos.y] = TARGET;
-                            world->targets[j].conn_mask = 0;
-                            world->targets[j].update_mask = (unsigned)-1;
+                            Conn_mask_clear_all(&world->targets[j].conn_mask);
+                            Conn_mask_set_all(&world->targets[j].update_mask);
                             world->targets[j].last_change = frame_loops;
                             world->targets[j].dead_time = 0;
                             world->targets[j].damage = TARGET_DAMAGE;
@@ -798,7 +831,7 @@ void Update_objects(void)
              */
             continue;
         }
-        world->targets[i].conn_mask = 0;
+        Conn_mask_clear_all(&world->targets[i].conn_mask);
         world->targets[i].last_change = frame_loops;
     }
 
@@ -1010,7 +1043,7 @@ void Update_objects(void)
                     if (world->fuel[pl->fs].fuel > REFUEL_RATE)
                     {
                         world->fuel[pl->fs].fuel -= REFUEL_RATE;
-                        world->fuel[pl->fs].conn_mask = 0;
+                        Conn_mask_clear_all(&world->fuel[pl->fs].conn_mask);
                         world->fuel[pl->fs].last_change = frame_loops;
                         Add_fuel(&(pl->fuel), REFUEL_RATE);
                     }
@@ -1018,7 +1051,7 @@ void Update_objects(void)
                     {
                         Add_fuel(&(pl->fuel), world->fuel[pl->fs].fuel);
                         world->fuel[pl->fs].fuel = 0;
-                        world->fuel[pl->fs].conn_mask = 0;
+                        Conn_mask_clear_all(&world->fuel[pl->fs].conn_mask);
                         world->fuel[pl->fs].last_change = frame_loops;
                         CLR_BIT(pl->used, HAS_REFUEL);
                         break;
@@ -1051,7 +1084,7 @@ void Update_objects(void)
                     if (pl->fuel.tank[pl->fuel.current] > REFUEL_RATE)
                     {
                         targ->damage += TARGET_FUEL_REPAIR_PER_FRAME;
-                        targ->conn_mask = 0;
+                        Conn_mask_clear_all(&targ->conn_mask);
                         targ->last_change = frame_loops;
                         Add_fuel(&(pl->fuel), -REFUEL_RATE);
                         if (targ->damage > TARGET_DAMAGE)
@@ -1340,7 +1373,9 @@ void Update_objects(void)
     /*
      * Checking for collision, updating score etc. (see collision.c)
      */
+    prof = Profile_start();
     Check_collision();
+    Profile_stop(PROFILE_COLLISION, prof);
 
     /*
      * Update tanks, Kill players that ought to be killed.
@@ -27,6 +27,9 @@
 #include <cerrno>
 #include <cmath>
 #include <climits>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "const.h"
 
@@ -44,6 +47,7 @@
 #include "click.h"
 #include "object.h"
 #include "xpmath.h"
+#include "navigate.h"
 
 #define WALLDIST_MASK \
     (FILLED_BIT | REC_LU_BIT | REC_LD_BIT | REC_RU_BIT | REC_RD_BIT | FUEL_BIT | CANNON_BIT | TREASURE_BIT | TARGET_BIT | CHECK_BIT | WORMHOLE_BIT)
@@ -65,6 +69,67 @@ static char msg[MSG_LEN];
  */
 static uint8_t **walldist;
 
+static move_stats_t move_stats;
+
+/*
+ * From anywhere in a block a point can move (walldist - margin) / 2
+ * blocks along each axis without reaching a wall or another map
+ * feature, with a margin of 2 for points and 3 for ships.  Together
+ * those squares make up the block grown by that much on every side,
+ * so a straight move from a known position is free as long as it ends
+ * inside that box.  Returns false if walldist promises nothing.
+ */
+static inline bool Walldist_box(int cx, int cy, int margin,
+                                clpos_t *lo, clpos_t *hi)
+{
+    int bx = cx / BLOCK_CLICKS;
+    int by = cy / BLOCK_CLICKS;
+    int dist = walldist[bx][by];
+    int grow;
+
+    if (dist < margin)
+        return false;
+    grow = ((dist - margin) * BLOCK_CLICKS) >> 1;
+    lo->cx = bx * BLOCK_CLICKS - grow;
+    lo->cy = by * BLOCK_CLICKS - grow;
+    hi->cx = (bx + 1) * BLOCK_CLICKS - 1 + grow;
+    hi->cy = (by + 1) * BLOCK_CLICKS - 1 + grow;
+    return true;
+}
+
+/*
+ * How much of todo a point at pos can do without leaving the box:
+ * all of it, or as far as the straight line stays inside.
+ */
+static inline clvec_t Walldist_advance(clpos_t pos, clvec_t todo,
+                                       clpos_t lo, clpos_t hi)
+{
+    clvec_t done;
+    int room_x = (todo.cx < 0) ? pos.cx - lo.cx : hi.cx - pos.cx;
+    int room_y = (todo.cy < 0) ? pos.cy - lo.cy : hi.cy - pos.cy;
+    int len_x = ABS(todo.cx);
+    int len_y = ABS(todo.cy);
+
+    if (len_x <= room_x && len_y <= room_y)
+    {
+        /* entire movement is possible. */
+        done = todo;
+    }
+    else if (len_x > room_x && (long)room_x * len_y <= (long)room_y * len_x)
+    {
+        /* leaves the box through a left or right side. */
+        done.cx = (todo.cx < 0) ? -room_x : room_x;
+        done.cy = (int)((long)todo.cy * room_x / len_x);
+    }
+    else
+    {
+        /* leaves the box through the bottom or top. */
+        done.cx = (int)((long)todo.cx * room_y / len_y);
+        done.cy = (todo.cy < 0) ? -room_y : room_y;
+    }
+    return done;
+}
+
 /*
  * Allocate memory for the two dimensional "walldist" array.
  */
@@ -316,6 +381,11 @@ void Treasure_init(void)
     }
 }
 
+void Move_get_stats(move_stats_t *stats)
+{
+    *stats = move_stats;
+}
+
 void Move_init(void)
 {
     mp.click_width = PIXEL_TO_CLICK(world->width);
@@ -596,6 +666,7 @@ void Move_segment(move_state_t *ms)
     clpos_t offset;                        /* offset within block in clicks */
     clpos_t off2;                          /* last offset in block in clicks */
     clpos_t mid;                           /* the mean of (offset+off2)/2 */
+    clpos_t free_lo, free_hi;              /* box walldist says is free */
     const move_info_t *const mi = ms->mip; /* alias */
     int hole;                              /* which wormhole */
     ballobject_t *ball;
@@ -607,6 +678,7 @@ void Move_segment(move_state_t *ms)
     ms->bounce = NotABounce;
     ms->done.cx = 0;
     ms->done.cy = 0;
+    move_stats.segments++;
 
     enter = ms->pos;
     if (enter.cx < 0 || enter.cx >= mp.click_width || enter.cy < 0 || enter.cy >= mp.click_height)
@@ -656,36 +728,23 @@ void Move_segment(move_state_t *ms)
         ms->pos = enter;
     }
 
-    sign.x = (ms->vel.x < 0) ? -1 : 1;
-    sign.y = (ms->vel.y < 0) ? -1 : 1;
-    block.x = enter.cx / BLOCK_CLICKS;
-    block.y = enter.cy / BLOCK_CLICKS;
-    if (walldist[block.x][block.y] > 2)
+    if (Walldist_box(enter.cx, enter.cy, 2, &free_lo, &free_hi))
     {
-        int maxcl = ((walldist[block.x][block.y] - 2) * BLOCK_CLICKS) >> 1;
-        if (maxcl >= sign.x * ms->todo.cx && maxcl >= sign.y * ms->todo.cy)
-        {
-            /* entire movement is possible. */
-            ms->done.cx = ms->todo.cx;
-            ms->done.cy = ms->todo.cy;
-        }
-        else if (sign.x * ms->todo.cx > sign.y * ms->todo.cy)
+        ms->done = Walldist_advance(enter, ms->todo, free_lo, free_hi);
+        if (ms->done.cx | ms->done.cy)
         {
-            /* horizontal movement. */
-            ms->done.cx = sign.x * maxcl;
-            ms->done.cy = ms->todo.cy * maxcl / (sign.x * ms->todo.cx);
-        }
-        else
-        {
-            /* vertical movement. */
-            ms->done.cx = ms->todo.cx * maxcl / (sign.y * ms->todo.cy);
-            ms->done.cy = sign.y * maxcl;
+            ms->todo.cx -= ms->done.cx;
+            ms->todo.cy -= ms->done.cy;
+            move_stats.segments_fast++;
+            return;
         }
-        ms->todo.cx -= ms->done.cx;
-        ms->todo.cy -= ms->done.cy;
-        return;
     }
 
+    sign.x = (ms->vel.x < 0) ? -1 : 1;
+    sign.y = (ms->vel.y < 0) ? -1 : 1;
+    block.x = enter.cx / BLOCK_CLICKS;
+    block.y = enter.cy / BLOCK_CLICKS;
+
     offset.cx = enter.cx - block.x * BLOCK_CLICKS;
     offset.cy = enter.cy - block.y * BLOCK_CLICKS;
     inside = 1;
@@ -1827,8 +1886,9 @@ static void Cannon_dies(move_state_t *ms)
     player_t *pl = NULL;
 
     cannon->dead_time = options.cannonDeadTime;
-    cannon->conn_mask = 0;
+    Conn_mask_clear_all(&cannon->conn_mask);
     world->block[cannon->blk_pos.x][cannon->blk_pos.y] = SPACE;
+    Navigation_changed();
     Cannon_throw_items(ms->cannon);
     Cannon_init(ms->cannon);
     sound_play_sensors(cx, cy, CANNON_EXPLOSION_SOUND);
@@ -1964,12 +2024,12 @@ static void Object_hits_target(move_state_t *ms, long player_cost)
         break;
     }
 
-    targ->conn_mask = 0;
+    Conn_mask_clear_all(&targ->conn_mask);
     targ->last_change = frame_loops;
     if (targ->damage > 0)
         return;
 
-    targ->update_mask = (unsigned)-1;
+    Conn_mask_set_all(&targ->update_mask);
     targ->damage = TARGET_DAMAGE;
     targ->dead_time = options.targetDeadTime;
 
@@ -1980,6 +2040,7 @@ static void Object_hits_target(move_state_t *ms, long player_cost)
     x = targ->blk_pos.x;
     y = targ->blk_pos.y;
     world->block[x][y] = SPACE;
+    Navigation_changed();
 
     int cx = targ->clk_pos.cx;
     int cy = targ->clk_pos.cy;
@@ -2182,25 +2243,25 @@ static void Object_crash(move_state_t *ms)
 void Move_object(object_t *obj)
 {
     int nothing_done = 0;
-    int dist;
+    clpos_t lo, hi;
     move_info_t mi;
     move_state_t ms;
     bool pos_update = false;
 
     Object_position_remember(obj);
+    move_stats.object_moves++;
 
-    dist = walldist[OBJ_X_IN_BLOCKS(obj)][OBJ_Y_IN_BLOCKS(obj)];
-    if (dist > 2)
+    if (Walldist_box(obj->pos.cx, obj->pos.cy, 2, &lo, &hi))
     {
-        int max = ((dist - 2) * BLOCK_SZ) >> 1;
-        if (sqr(max) >= sqr(obj->vel.x) + sqr(obj->vel.y))
+        int cx = obj->pos.cx + FLOAT_TO_CLICK(obj->vel.x);
+        int cy = obj->pos.cy + FLOAT_TO_CLICK(obj->vel.y);
+        if (cx >= lo.cx && cx <= hi.cx && cy >= lo.cy && cy <= hi.cy)
         {
-            int cx = obj->pos.cx + FLOAT_TO_CLICK(obj->vel.x);
-            int cy = obj->pos.cy + FLOAT_TO_CLICK(obj->vel.y);
             cx = WRAP_XCLICK(cx);
             cy = WRAP_YCLICK(cy);
             Object_position_set_clicks(obj, cx, cy);
             Cell_add_object(obj);
+            move_stats.object_fast++;
             return;
         }
     }
@@ -2309,6 +2370,146 @@ void Move_object(object_t *obj)
     Cell_add_object(obj);
 }
 
+/*
+ * Hot fields of a batch of objects that only need gravity and
+ * integration.  Keeping them in arrays instead of in the objects
+ * lets the arithmetic be done for several objects at once, and the
+ * objects themselves are only touched to gather and scatter the fields.
+ */
+#define MOVE_BATCH 256
+
+static struct
+{
+    float vx[MOVE_BATCH], vy[MOVE_BATCH]; /* velocity */
+    float ax[MOVE_BATCH], ay[MOVE_BATCH]; /* acceleration plus gravity */
+    int cx[MOVE_BATCH], cy[MOVE_BATCH];   /* position, then new position */
+    int lo_x[MOVE_BATCH], hi_x[MOVE_BATCH]; /* box walldist says is free */
+    int lo_y[MOVE_BATCH], hi_y[MOVE_BATCH];
+    int fast[MOVE_BATCH];                 /* no wall can be reached */
+} batch;
+
+/*
+ * Integrate the first n objects of the batch.  Explosions fill it
+ * with hundreds of debris and sparks at a time, so with SSE2 four
+ * objects are done per step.  The scalar loop does the rest and
+ * gives the same results, as both use the same float arithmetic.
+ */
+static void Move_batch_integrate(int n)
+{
+    int k = 0;
+
+#if defined(__SSE2__)
+    const __m128 click = _mm_set1_ps((float)CLICK);
+
+    for (; k + 4 <= n; k += 4)
+    {
+        __m128 vx = _mm_add_ps(_mm_loadu_ps(&batch.vx[k]),
+                               _mm_loadu_ps(&batch.ax[k]));
+        __m128 vy = _mm_add_ps(_mm_loadu_ps(&batch.vy[k]),
+                               _mm_loadu_ps(&batch.ay[k]));
+        __m128i cx = _mm_loadu_si128((__m128i *)&batch.cx[k]);
+        __m128i cy = _mm_loadu_si128((__m128i *)&batch.cy[k]);
+        __m128i out;
+
+        _mm_storeu_ps(&batch.vx[k], vx);
+        _mm_storeu_ps(&batch.vy[k], vy);
+        cx = _mm_add_epi32(cx, _mm_cvttps_epi32(_mm_mul_ps(vx, click)));
+        cy = _mm_add_epi32(cy, _mm_cvttps_epi32(_mm_mul_ps(vy, click)));
+        _mm_storeu_si128((__m128i *)&batch.cx[k], cx);
+        _mm_storeu_si128((__m128i *)&batch.cy[k], cy);
+        out = _mm_or_si128(
+            _mm_or_si128(_mm_cmplt_epi32(cx, _mm_loadu_si128((__m128i *)&batch.lo_x[k])),
+                         _mm_cmpgt_epi32(cx, _mm_loadu_si128((__m128i *)&batch.hi_x[k]))),
+            _mm_or_si128(_mm_cmplt_epi32(cy, _mm_loadu_si128((__m128i *)&batch.lo_y[k])),
+                         _mm_cmpgt_epi32(cy, _mm_loadu_si128((__m128i *)&batch.hi_y[k]))));
+        _mm_storeu_si128((__m128i *)&batch.fast[k],
+                         _mm_andnot_si128(out, _mm_set1_epi32(-1)));
+    }
+#endif
+    for (; k < n; k++)
+    {
+        batch.vx[k] += batch.ax[k];
+        batch.vy[k] += batch.ay[k];
+        batch.cx[k] += FLOAT_TO_CLICK(batch.vx[k]);
+        batch.cy[k] += FLOAT_TO_CLICK(batch.vy[k]);
+        batch.fast[k] = (batch.cx[k] >= batch.lo_x[k] && batch.cx[k] <= batch.hi_x[k] && batch.cy[k] >= batch.lo_y[k] && batch.cy[k] <= batch.hi_y[k]);
+    }
+}
+
+/*
+ * Update the speed of and move the objects Obj[first] to
+ * Obj[first + num - 1], which must all be of a type that has no
+ * special movement code.  Does the same as update_object_speed()
+ * and Move_object() for each of them in turn, but does the
+ * arithmetic for a whole batch at once and only calls
+ * Move_object() for objects that may hit a wall.
+ */
+void Move_simple_objects(int first, int num)
+{
+    int i, k, n;
+    clpos_t lo, hi;
+    object_t *obj;
+
+    for (i = 0; i < num; i += n)
+    {
+        n = MIN(num - i, MOVE_BATCH);
+
+        for (k = 0; k < n; k++)
+        {
+            obj = Obj[first + i + k];
+            batch.vx[k] = obj->vel.x;
+            batch.vy[k] = obj->vel.y;
+            batch.cx[k] = obj->pos.cx;
+            batch.cy[k] = obj->pos.cy;
+            if (BIT(obj->status, GRAVITY))
+            {
+                batch.ax[k] = obj->acc.x + world->gravity[OBJ_X_IN_BLOCKS(obj)][OBJ_Y_IN_BLOCKS(obj)].x;
+                batch.ay[k] = obj->acc.y + world->gravity[OBJ_X_IN_BLOCKS(obj)][OBJ_Y_IN_BLOCKS(obj)].y;
+            }
+            else
+            {
+                batch.ax[k] = obj->acc.x;
+                batch.ay[k] = obj->acc.y;
+            }
+            if (Walldist_box(obj->pos.cx, obj->pos.cy, 2, &lo, &hi))
+            {
+                batch.lo_x[k] = lo.cx;
+                batch.hi_x[k] = hi.cx;
+                batch.lo_y[k] = lo.cy;
+                batch.hi_y[k] = hi.cy;
+            }
+            else
+            {
+                /* an empty box, nothing is inside it. */
+                batch.lo_x[k] = INT_MAX;
+                batch.hi_x[k] = INT_MIN;
+                batch.lo_y[k] = INT_MAX;
+                batch.hi_y[k] = INT_MIN;
+            }
+        }
+
+        Move_batch_integrate(n);
+
+        for (k = 0; k < n; k++)
+        {
+            obj = Obj[first + i + k];
+            obj->vel.x = batch.vx[k];
+            obj->vel.y = batch.vy[k];
+            if (!batch.fast[k])
+            {
+                Move_object(obj);
+                continue;
+            }
+            Object_position_remember(obj);
+            Object_position_set_clicks(obj, WRAP_XCLICK(batch.cx[k]),
+                                       WRAP_YCLICK(batch.cy[k]));
+            Cell_add_object(obj);
+            move_stats.object_moves++;
+            move_stats.object_fast++;
+        }
+    }
+}
+
 static void Player_crash(move_state_t *ms, int pt, bool turning)
 {
     player_t *pl = ms->mip->pl;
@@ -2493,7 +2694,6 @@ void Move_player(int ind)
     player_t *pl = PlayersArray[ind];
     int nothing_done = 0;
     int i;
-    int dist;
     move_info_t mi;
     move_state_t ms[RES];
     int worst = 0;
@@ -2506,8 +2706,7 @@ void Move_player(int ind)
     clvec_t done;
     vector_t vel;
     vector_t r[RES];
-    ivec_t sign;  /* sign (-1 or 1) of direction */
-    ipos_t block; /* block index */
+    clpos_t lo, hi; /* box walldist says is free */
     bool pos_update = false;
     double fric;
     double oldvx, oldvy;
@@ -2555,19 +2754,19 @@ void Move_player(int ind)
     pl->vel.y = (1.0f - fric) * (oldvy * tcos(cor_res) - oldvx * tsin(cor_res));
 
     Player_position_remember(pl);
+    move_stats.player_moves++;
 
-    dist = walldist[OBJ_X_IN_BLOCKS(pl)][OBJ_Y_IN_BLOCKS(pl)];
-    if (dist > 3)
+    if (Walldist_box(pl->pos.cx, pl->pos.cy, 3, &lo, &hi))
     {
-        int max = ((dist - 3) * BLOCK_SZ) >> 1;
-        if (max >= pl->velocity)
+        pos.cx = pl->pos.cx + FLOAT_TO_CLICK(pl->vel.x);
+        pos.cy = pl->pos.cy + FLOAT_TO_CLICK(pl->vel.y);
+        if (pos.cx >= lo.cx && pos.cx <= hi.cx && pos.cy >= lo.cy && pos.cy <= hi.cy)
         {
-            pos.cx = pl->pos.cx + FLOAT_TO_CLICK(pl->vel.x);
-            pos.cy = pl->pos.cy + FLOAT_TO_CLICK(pl->vel.y);
             pos.cx = WRAP_XCLICK(pos.cx);
             pos.cy = WRAP_YCLICK(pos.cy);
             Player_position_set_clicks(pl, pos.cx, pos.cy);
             pl->velocity = VECTOR_LENGTH(pl->vel);
+            move_stats.player_fast++;
             return;
         }
     }
@@ -2605,35 +2804,18 @@ void Move_player(int ind)
         pos.cy = ms[0].pos.cy - FLOAT_TO_CLICK(pl->ship->pts[0][ms[0].dir].y);
         pos.cx = WRAP_XCLICK(pos.cx);
         pos.cy = WRAP_YCLICK(pos.cy);
-        block.x = pos.cx / BLOCK_CLICKS;
-        block.y = pos.cy / BLOCK_CLICKS;
 
-        if (walldist[block.x][block.y] > 3)
+        todo = ms[0].todo;
+        if (Walldist_box(pos.cx, pos.cy, 3, &lo, &hi))
+            done = Walldist_advance(pos, todo, lo, hi);
+        else
+            done.cx = done.cy = 0;
+        if (done.cx | done.cy)
         {
-            int maxcl = ((walldist[block.x][block.y] - 3) * BLOCK_CLICKS) >> 1;
-            todo = ms[0].todo;
-            sign.x = (todo.cx < 0) ? -1 : 1;
-            sign.y = (todo.cy < 0) ? -1 : 1;
-            if (maxcl >= sign.x * todo.cx && maxcl >= sign.y * todo.cy)
-            {
-                /* entire movement is possible. */
-                done.cx = todo.cx;
-                done.cy = todo.cy;
-            }
-            else if (sign.x * todo.cx > sign.y * todo.cy)
-            {
-                /* horizontal movement. */
-                done.cx = sign.x * maxcl;
-                done.cy = todo.cy * maxcl / (sign.x * todo.cx);
-            }
-            else
-            {
-                /* vertical movement. */
-                done.cx = todo.cx * maxcl / (sign.y * todo.cy);
-                done.cy = sign.y * maxcl;
-            }
             todo.cx -= done.cx;
             todo.cy -= done.cy;
+            move_stats.segments++;
+            move_stats.segments_fast++;
             for (i = 0; i < pl->ship->num_points; i++)
             {
                 ms[i].pos.cx += done.cx;
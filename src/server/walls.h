@@ -117,6 +117,20 @@ struct move_parameters
 
 extern unsigned SPACE_BLOCKS;
 
+/*
+ * How often movement could be done in one step because walldist
+ * showed there was nothing to hit, instead of going block by block.
+ */
+typedef struct
+{
+    long object_moves;  /* objects moved */
+    long object_fast;   /* of which in one step */
+    long player_moves;  /* playing ships moved */
+    long player_fast;   /* of which in one step */
+    long segments;      /* movement steps of objects and ship points */
+    long segments_fast; /* of which without looking at the blocks */
+} move_stats_t;
+
 /*
  * Prototypes for walls.cpp
  */
@@ -124,8 +138,10 @@ void Walls_init(void);
 void Treasure_init(void);
 void Move_init(void);
 void Move_object(object_t *obj);
+void Move_simple_objects(int first, int num);
 void Move_player(int ind);
 void Turn_player(player_t *pl);
 void Move_segment(move_state_t *ms);
+void Move_get_stats(move_stats_t *stats);
 
 #endif